@@ -5,10 +5,28 @@ const net = require('net');
 const fs = require('fs');
 
 let socket_name = '';
+let session_name = '';
+
+function wrapSession(buffer) {
+  if (session_name.length == 0)
+    return buffer;
+
+  // A shared crash handler finds the session of a message in its envelope
+  const name = Buffer.from(session_name + '\0');
+  const header = Buffer.alloc(5);
+  header.writeUInt8(7, 0);
+  header.writeUInt32LE(name.length, 1);
+  return Buffer.concat([header, name, buffer]);
+}
 
 function tryConnect(buffer, attempt = 5, waitMs = 100) {
+  buffer = wrapSession(buffer);
+  sendBuffer(buffer, attempt, waitMs);
+}
+
+function sendBuffer(buffer, attempt, waitMs) {
   try {
-    if (process.platform === "win32") {
+    if (process.platform === "win32" || process.platform === "linux") {
       const socket = net.createConnection({
         path: socket_name,
         readable: false,
@@ -19,7 +37,7 @@ function tryConnect(buffer, attempt = 5, waitMs = 100) {
       socket.on('error', function () {
         if (attempt > 0) {
           setTimeout(() => {
-            tryConnect(buffer, attempt - 1, waitMs * 2);
+            sendBuffer(buffer, attempt - 1, waitMs * 2);
           }, waitMs);
         }
       });
@@ -33,7 +51,7 @@ function tryConnect(buffer, attempt = 5, waitMs = 100) {
   } catch (error) {
     if (attempt > 0) {
       setTimeout(() => {
-        tryConnect(buffer, attempt - 1, waitMs * 2);
+        sendBuffer(buffer, attempt - 1, waitMs * 2);
       }, waitMs);
     }
   }
@@ -60,6 +78,38 @@ function unregisterProcess(pid) {
     tryConnect(buffer);
 }
 
+let connection = null;
+
+// Registers the calling process for as long as its connection stays open, on Linux only.
+// The crash handler sees the connection close the moment the process dies.
+function registerProcessConnection(isCritial = false) {
+    if (process.platform !== "linux" || connection)
+        return false;
+
+    console.log('[crash-handler] Register process connection ' + process.pid);
+    const buffer = new Buffer.alloc(2);
+    buffer.writeUInt8(8, 0);
+    buffer.writeUInt8(isCritial, 1);
+
+    connection = net.createConnection({ path: socket_name });
+    connection.on('connect', function () {
+      connection.write(wrapSession(buffer));
+    });
+    connection.on('error', function () {
+      connection = null;
+    });
+    return true;
+}
+
+function unregisterProcessConnection() {
+    if (!connection)
+        return;
+
+    console.log('[crash-handler] Unregister process connection ' + process.pid);
+    connection.end(Buffer.from([1]));
+    connection = null;
+}
+
 async function terminateCrashHandler(pid) {
     const buffer = new Buffer.alloc(5);
     let offset = 0;
@@ -68,7 +118,7 @@ async function terminateCrashHandler(pid) {
     tryConnect(buffer);
 }
 
-function startCrashHandler(workingDirectory, version, isDevEnv, cachePath = "", socket_prefix = "") {
+function startCrashHandler(workingDirectory, version, isDevEnv, cachePath = "", socket_prefix = "", options = []) {
     console.log('[crash-handler] Spawn crash handler');
     const { spawn } = require('child_process');
 
@@ -82,9 +132,15 @@ function startCrashHandler(workingDirectory, version, isDevEnv, cachePath = "",
       '/tmp/slobs-crash-handler'
     }
 
-    try {
-      fs.unlinkSync(socket_name);
-    } catch (error) {}
+    // Instances sharing a crash handler as sessions keep the socket of the running one
+    const session = options.find((option) => option.startsWith('--session='));
+    session_name = session ? session.substring('--session='.length) : '';
+
+    if (session_name.length == 0) {
+      try {
+        fs.unlinkSync(socket_name);
+      } catch (error) {}
+    }
 
     const processPath = workingDirectory.replace('app.asar', 'app.asar.unpacked') +
     '/node_modules/crash-handler';
@@ -95,6 +151,7 @@ function startCrashHandler(workingDirectory, version, isDevEnv, cachePath = "",
       spawnArguments.push( cachePath );
 
     spawnArguments.push( socket_name );
+    spawnArguments.push( ...options );
 
     const subprocess = spawn(processPath +
       '/crash-handler-process', spawnArguments, {
@@ -113,6 +170,8 @@ function startCrashHandler(workingDirectory, version, isDevEnv, cachePath = "",
 exports.startCrashHandler = startCrashHandler;
 exports.registerProcess = registerProcess;
 exports.unregisterProcess = unregisterProcess;
+exports.registerProcessConnection = registerProcessConnection;
+exports.unregisterProcessConnection = unregisterProcessConnection;
 exports.terminateCrashHandler = terminateCrashHandler;
 
 exports = crash_handler;
\ No newline at end of file
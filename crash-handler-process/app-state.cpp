@@ -0,0 +1,230 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "app-state.hpp"
+#include "logger.hpp"
+#include "options.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+#if defined(WIN32)
+const std::wstring appStateFileName = L"\\appState";
+#else
+const std::wstring appStateFileName = L"/appState";
+#endif
+const std::string detectedMember = "detected";
+const std::string freezeFlag = "window_unresponsive";
+const std::string noncriticalFlag = "crashed_noncritically";
+
+size_t skipString(const std::string &document, size_t index)
+{
+	for (index++; index < document.size(); index++) {
+		if (document[index] == '\\')
+			index++;
+		else if (document[index] == '"')
+			return index + 1;
+	}
+	return std::string::npos;
+}
+
+size_t skipSpaces(const std::string &document, size_t index)
+{
+	while (index < document.size() && isspace(static_cast<unsigned char>(document[index])))
+		index++;
+	return index;
+}
+
+// Finds the value of a member of the top level object, without parsing the rest of the document
+bool findMember(const std::string &document, const std::string &name, size_t &begin, size_t &end)
+{
+	size_t index = skipSpaces(document, 0);
+	if (index >= document.size() || document[index] != '{')
+		return false;
+
+	int depth = 0;
+	while (index < document.size()) {
+		const char c = document[index];
+		if (c == '"') {
+			const size_t next = skipString(document, index);
+			if (next == std::string::npos)
+				return false;
+			const size_t colon = skipSpaces(document, next);
+			if (depth == 1 && colon < document.size() && document[colon] == ':' && document.compare(index + 1, next - index - 2, name) == 0) {
+				begin = skipSpaces(document, colon + 1);
+				if (begin < document.size() && document[begin] == '"') {
+					end = skipString(document, begin);
+					return end != std::string::npos;
+				}
+				// Not a string, the whole value up to the next member is replaced
+				int nested = 0;
+				for (end = begin; end < document.size(); end++) {
+					if (document[end] == '"') {
+						const size_t closing = skipString(document, end);
+						if (closing == std::string::npos)
+							return false;
+						end = closing - 1;
+					} else if (document[end] == '{' || document[end] == '[') {
+						nested++;
+					} else if (document[end] == '}' || document[end] == ']') {
+						if (nested-- == 0)
+							break;
+					} else if (document[end] == ',' && nested == 0) {
+						break;
+					}
+				}
+				while (end > begin && isspace(static_cast<unsigned char>(document[end - 1])))
+					end--;
+				return true;
+			}
+			index = next;
+			continue;
+		}
+		if (c == '{' || c == '[')
+			depth++;
+		else if (c == '}' || c == ']')
+			depth--;
+		index++;
+	}
+	return false;
+}
+
+void setMember(std::string &document, const std::string &name, const std::string &value)
+{
+	const std::string quoted = "\"" + value + "\"";
+	size_t begin = 0, end = 0;
+	if (findMember(document, name, begin, end)) {
+		document.replace(begin, end - begin, quoted);
+		return;
+	}
+
+	const size_t close = document.rfind('}');
+	if (close == std::string::npos)
+		return;
+	const size_t last = document.find_last_not_of(" \t\r\n", close - 1);
+	const bool empty = last == std::string::npos || document[last] == '{';
+	document.insert(empty ? close : last + 1, (empty ? "\"" : ",\"") + name + "\":" + quoted);
+}
+
+} // namespace
+
+AppStateStore::AppStateStore(const std::wstring &cachePath) : path(cachePath + appStateFileName) {}
+
+bool AppStateStore::read(std::string &content) const
+{
+#if defined(WIN32)
+	std::ifstream state_file(path, std::ios::in);
+#else // for __APPLE__ and other
+	std::ifstream state_file(std::string(path.begin(), path.end()), std::ios::in);
+#endif
+	if (!state_file.is_open())
+		return false;
+
+	std::ostringstream buffer;
+	buffer << state_file.rdbuf();
+	content = buffer.str();
+	content.erase(content.find_last_not_of(" \t\r\n") + 1);
+	return content.find('{') != std::string::npos;
+}
+
+bool AppStateStore::load()
+{
+	if (loaded)
+		return true;
+
+	// The application may not have written it yet, it is read again on the next change
+	if (!read(document)) {
+		if (!document.empty())
+			log_info << "App state file is not an object, ignored" << std::endl;
+		return false;
+	}
+
+	size_t begin = 0, end = 0;
+	persisted.clear();
+	if (findMember(document, detectedMember, begin, end) && document[begin] == '"')
+		persisted = document.substr(begin + 1, end - begin - 2);
+	detected = persisted;
+	loaded = true;
+	return true;
+}
+
+void AppStateStore::update(Util::AppState state)
+{
+	if (!load())
+		return;
+
+	if (state == Util::AppState::Unresponsive) {
+		if (detected.empty())
+			detected = freezeFlag;
+	} else if (state == Util::AppState::Responsive) {
+		if (detected == freezeFlag)
+			detected.clear();
+	} else if (state == Util::AppState::NoncriticallyDead) {
+		detected = noncriticalFlag;
+		// The handler may exit right after a crash, this one is written at once
+		pending = true;
+		flush();
+		return;
+	}
+
+	if (detected == persisted) {
+		// Flipped back within the debounce period, nothing to write
+		pending = false;
+	} else if (!pending) {
+		pending = true;
+		dueAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(Options::get().appStateDebounceMs);
+	}
+}
+
+void AppStateStore::persistIfDue(std::chrono::steady_clock::time_point now)
+{
+	if (pending && now >= dueAt)
+		flush();
+}
+
+std::chrono::milliseconds AppStateStore::timeUntilDue(std::chrono::steady_clock::time_point now, std::chrono::milliseconds limit) const
+{
+	if (!pending)
+		return limit;
+	if (now >= dueAt)
+		return std::chrono::milliseconds(0);
+	return std::min(limit, std::chrono::ceil<std::chrono::milliseconds>(dueAt - now));
+}
+
+void AppStateStore::flush()
+{
+	if (!pending)
+		return;
+	pending = false;
+
+	// The application keeps writing its own members, only the detected one is replaced in what it wrote last
+	std::string updated;
+	if (!read(updated))
+		updated = document;
+	setMember(updated, detectedMember, detected);
+	if (!Util::writeFileAtomically(path, updated + "\n")) {
+		log_error << "Failed to write the app state file" << std::endl;
+		return;
+	}
+	document = updated;
+	persisted = detected;
+}
@@ -0,0 +1,58 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef APP_STATE_H
+#define APP_STATE_H
+
+#include <chrono>
+#include <string>
+
+#include "util.hpp"
+
+// The appState file of a cache directory, created by the application. The
+// handler owns only its detected member; state changes are coalesced for the
+// debounce period so a flapping window does not rewrite the file, and each
+// write reads the file again, replaces that member and goes to a temporary
+// file that replaces the state file once synced. Only used by the monitor
+// thread of its process manager.
+class AppStateStore {
+public:
+	AppStateStore(const std::wstring &cachePath);
+
+	void update(Util::AppState detected);
+
+	// Writes a pending change once the debounce period is over
+	void persistIfDue(std::chrono::steady_clock::time_point now);
+	std::chrono::milliseconds timeUntilDue(std::chrono::steady_clock::time_point now, std::chrono::milliseconds limit) const;
+	void flush();
+
+private:
+	std::wstring path;
+	bool loaded = false;
+	std::string document;
+	// Value of the detected member in the file, and the one to write
+	std::string persisted;
+	std::string detected;
+	bool pending = false;
+	std::chrono::steady_clock::time_point dueAt;
+
+	bool read(std::string &content) const;
+	bool load();
+};
+
+#endif
@@ -0,0 +1,348 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "crash-client.h"
+#include "../crash-context.hpp"
+#include "../message.hpp"
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+
+#define CRASH_CLIENT_SIGNALS 6
+#define CRASH_CLIENT_STACK_SIZE (64 * 1024)
+#define CRASH_CLIENT_REPLY_TIMEOUT_MS 2000
+
+namespace {
+
+const int crashSignals[CRASH_CLIENT_SIGNALS] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT, SIGTRAP};
+
+struct ClientState {
+	std::string socketPath;
+	std::string session;
+	int32_t pid = 0;
+	CrashContext *context = nullptr;
+	int event = -1;
+	struct sigaction previous[CRASH_CLIENT_SIGNALS];
+	bool installed = false;
+};
+
+ClientState client;
+
+// The alternate signal stack of a thread, the kernel keeps one per thread
+struct ThreadStack {
+	void *base = nullptr;
+
+	bool install()
+	{
+		if (base)
+			return true;
+		void *mapped = mmap(nullptr, CRASH_CLIENT_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapped == MAP_FAILED)
+			return false;
+		stack_t stack = {};
+		stack.ss_sp = mapped;
+		stack.ss_size = CRASH_CLIENT_STACK_SIZE;
+		if (sigaltstack(&stack, nullptr) != 0) {
+			munmap(mapped, CRASH_CLIENT_STACK_SIZE);
+			return false;
+		}
+		base = mapped;
+		return true;
+	}
+	void remove()
+	{
+		if (!base)
+			return;
+		stack_t disable = {};
+		disable.ss_flags = SS_DISABLE;
+		sigaltstack(&disable, nullptr);
+		munmap(base, CRASH_CLIENT_STACK_SIZE);
+		base = nullptr;
+	}
+	~ThreadStack() { remove(); }
+};
+
+thread_local ThreadStack threadStack;
+
+std::vector<char> wrapSession(const std::vector<char> &message)
+{
+	if (client.session.empty())
+		return message;
+
+	// A shared crash handler finds the session of a message in its envelope
+	const uint32_t length = static_cast<uint32_t>(client.session.size() + 1);
+	std::vector<char> buffer;
+	buffer.push_back(static_cast<char>(Action::SESSIONMESSAGE));
+	buffer.insert(buffer.end(), reinterpret_cast<const char *>(&length), reinterpret_cast<const char *>(&length) + sizeof(length));
+	buffer.insert(buffer.end(), client.session.c_str(), client.session.c_str() + length);
+	buffer.insert(buffer.end(), message.begin(), message.end());
+	return buffer;
+}
+
+std::vector<char> pidMessage(Action action)
+{
+	std::vector<char> message(1 + sizeof(int32_t));
+	message[0] = static_cast<char>(action);
+	memcpy(&message[1], &client.pid, sizeof(int32_t));
+	return message;
+}
+
+int connectHandler()
+{
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (client.socketPath.size() >= sizeof(addr.sun_path))
+		return -1;
+	strncpy(addr.sun_path, client.socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+		close(fd);
+		fd = -1;
+	}
+	return fd;
+}
+
+// The handler reads one message per connection
+bool sendMessage(const std::vector<char> &message)
+{
+	const int fd = connectHandler();
+	if (fd < 0)
+		return false;
+
+	const std::vector<char> buffer = wrapSession(message);
+	const bool sent = send(fd, buffer.data(), buffer.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(buffer.size());
+	close(fd);
+	return sent;
+}
+
+// Asks for the crash context page, answered with a status and the page and eventfd descriptors
+bool requestCrashContext(int &page, int &event)
+{
+	const int fd = connectHandler();
+	if (fd < 0)
+		return false;
+
+	const std::vector<char> buffer = wrapSession(pidMessage(Action::REGISTERCRASHCONTEXT));
+	timeval timeout = {CRASH_CLIENT_REPLY_TIMEOUT_MS / 1000, (CRASH_CLIENT_REPLY_TIMEOUT_MS % 1000) * 1000};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	if (send(fd, buffer.data(), buffer.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(buffer.size())) {
+		close(fd);
+		return false;
+	}
+
+	int32_t status = -1;
+	iovec iov = {&status, sizeof(status)};
+	msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	const ssize_t received = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+	close(fd);
+
+	int descriptors[2] = {-1, -1};
+	cmsghdr *cmsg = received > 0 ? CMSG_FIRSTHDR(&msg) : nullptr;
+	if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(descriptors)))
+		memcpy(descriptors, CMSG_DATA(cmsg), sizeof(descriptors));
+	if (received != sizeof(status) || status != 0 || descriptors[0] < 0 || descriptors[1] < 0) {
+		for (int descriptor : descriptors) {
+			if (descriptor >= 0)
+				close(descriptor);
+		}
+		return false;
+	}
+	page = descriptors[0];
+	event = descriptors[1];
+	return true;
+}
+
+void fillRegisters(CrashContext *context, const void *ucontext)
+{
+	const ucontext_t *uc = static_cast<const ucontext_t *>(ucontext);
+#if defined(__x86_64__)
+	static_assert(NGREG <= CRASH_CONTEXT_REGISTERS, "x86_64 registers fit in the page");
+	context->architecture = CRASH_CONTEXT_ARCH_X86_64;
+	for (int i = 0; i < NGREG; i++)
+		context->registers[i] = static_cast<uint64_t>(uc->uc_mcontext.gregs[i]);
+	context->register_count = NGREG;
+	context->instruction_pointer = static_cast<uint64_t>(uc->uc_mcontext.gregs[REG_RIP]);
+	context->stack_pointer = static_cast<uint64_t>(uc->uc_mcontext.gregs[REG_RSP]);
+#elif defined(__aarch64__)
+	// x0 to x30, then sp, pc and pstate
+	context->architecture = CRASH_CONTEXT_ARCH_AARCH64;
+	for (int i = 0; i < 31; i++)
+		context->registers[i] = uc->uc_mcontext.regs[i];
+	context->registers[31] = uc->uc_mcontext.sp;
+	context->registers[32] = uc->uc_mcontext.pc;
+	context->registers[33] = uc->uc_mcontext.pstate;
+	context->register_count = 34;
+	context->instruction_pointer = uc->uc_mcontext.pc;
+	context->stack_pointer = uc->uc_mcontext.sp;
+#else
+	context->architecture = CRASH_CONTEXT_ARCH_UNKNOWN;
+	context->register_count = 0;
+#endif
+}
+
+// Runs in the crashing thread: no allocation, no lock, and no syscall but gettid and the write that wakes the handler
+void crashSignal(int signal, siginfo_t *info, void *ucontext)
+{
+	CrashContext *context = client.context;
+	uint32_t expected = CRASH_CONTEXT_EMPTY;
+	if (context && context->state.compare_exchange_strong(expected, CRASH_CONTEXT_WRITING, std::memory_order_acquire)) {
+		context->tid = static_cast<int32_t>(syscall(SYS_gettid));
+		context->signal = signal;
+		context->code = info->si_code;
+		// si_addr only holds an address for signals raised by the kernel
+		context->address = info->si_code > 0 ? reinterpret_cast<uint64_t>(info->si_addr) : 0;
+		fillRegisters(context, ucontext);
+		context->state.store(CRASH_CONTEXT_WRITTEN, std::memory_order_release);
+
+		// Nothing more can be done from here when the handler is gone
+		const uint64_t wake = 1;
+		const ssize_t woken = write(client.event, &wake, sizeof(wake));
+		(void)woken;
+	}
+
+	// SA_RESETHAND restored the default disposition on entry. A previous handler is called as the kernel would have.
+	for (int i = 0; i < CRASH_CLIENT_SIGNALS; i++) {
+		if (crashSignals[i] != signal)
+			continue;
+
+		const struct sigaction &previous = client.previous[i];
+		if (previous.sa_flags & SA_SIGINFO) {
+			if (previous.sa_sigaction) {
+				previous.sa_sigaction(signal, info, ucontext);
+				return;
+			}
+		} else if (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN) {
+			previous.sa_handler(signal);
+			return;
+		}
+	}
+
+	// A fault happens again once the handler returns, a signal that was sent has to be raised again
+	if (info->si_code <= 0)
+		raise(signal);
+}
+
+bool installHandlers()
+{
+	// A stack overflow leaves no stack to run the handler on, the registering thread gets an alternate one
+	threadStack.install();
+
+	struct sigaction action = {};
+	action.sa_sigaction = crashSignal;
+	action.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+	sigemptyset(&action.sa_mask);
+	for (int i = 0; i < CRASH_CLIENT_SIGNALS; i++) {
+		if (sigaction(crashSignals[i], &action, &client.previous[i]) != 0) {
+			while (i-- > 0)
+				sigaction(crashSignals[i], &client.previous[i], nullptr);
+			return false;
+		}
+	}
+	client.installed = true;
+	return true;
+}
+
+void release()
+{
+	if (client.context) {
+		munmap(client.context, CRASH_CONTEXT_SIZE);
+		client.context = nullptr;
+	}
+	if (client.event >= 0) {
+		close(client.event);
+		client.event = -1;
+	}
+	threadStack.remove();
+}
+
+// The handler monitors the process from REGISTER on, a registration that could not be completed is withdrawn
+int abandonRegistration()
+{
+	sendMessage(pidMessage(Action::UNREGISTER));
+	release();
+	return -1;
+}
+
+} // namespace
+
+int crash_client_register(const char *socket_path, const char *session, int critical)
+{
+	if (client.installed || !socket_path)
+		return -1;
+
+	client.socketPath = socket_path;
+	client.session = session ? session : "";
+	client.pid = static_cast<int32_t>(getpid());
+
+	std::vector<char> registration(2 + sizeof(int32_t));
+	registration[0] = static_cast<char>(Action::REGISTER);
+	registration[1] = critical ? 1 : 0;
+	memcpy(&registration[2], &client.pid, sizeof(int32_t));
+	if (!sendMessage(registration))
+		return -1;
+
+	int page = -1;
+	if (!requestCrashContext(page, client.event))
+		return abandonRegistration();
+
+	void *mapped = mmap(nullptr, CRASH_CONTEXT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, page, 0);
+	close(page);
+	if (mapped == MAP_FAILED || static_cast<CrashContext *>(mapped)->magic != CRASH_CONTEXT_MAGIC ||
+	    static_cast<CrashContext *>(mapped)->version != CRASH_CONTEXT_VERSION) {
+		if (mapped != MAP_FAILED)
+			munmap(mapped, CRASH_CONTEXT_SIZE);
+		return abandonRegistration();
+	}
+	client.context = static_cast<CrashContext *>(mapped);
+
+	if (!installHandlers())
+		return abandonRegistration();
+	return 0;
+}
+
+int crash_client_register_thread(void)
+{
+	return threadStack.install() ? 0 : -1;
+}
+
+void crash_client_unregister(void)
+{
+	if (!client.installed)
+		return;
+
+	for (int i = 0; i < CRASH_CLIENT_SIGNALS; i++)
+		sigaction(crashSignals[i], &client.previous[i], nullptr);
+	client.installed = false;
+
+	sendMessage(pidMessage(Action::UNREGISTER));
+	release();
+}
@@ -0,0 +1,56 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef CRASH_CLIENT_H
+#define CRASH_CLIENT_H
+
+// Client side of the crash handler for Linux processes. Registering maps the
+// crash context page the handler creates for the process and installs
+// handlers for the fatal signals. A crashing thread copies its registers, the
+// faulting address and its thread id into the page and wakes the handler with
+// one write to an eventfd, without allocating. The signal then takes its
+// previous disposition, so the process dies or the previous handler runs as
+// if the client was not there.
+//
+// A stack overflow leaves no stack to run the signal handler on. The handler
+// runs on an alternate stack, which is per thread: registering gives one to
+// the registering thread only, other threads that may overflow their stack
+// call crash_client_register_thread. Without one, the overflow of a thread
+// kills the process before the crash is reported.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Registers the calling process with the handler listening on socket_path.
+// session names the session of a shared handler, NULL otherwise.
+// Returns 0 once the signal handlers are installed, -1 otherwise.
+int crash_client_register(const char *socket_path, const char *session, int critical);
+
+// Gives the calling thread an alternate signal stack, freed when the thread exits.
+// Returns 0 once the stack is set, -1 otherwise.
+int crash_client_register_thread(void);
+
+// Restores the previous signal handlers and unregisters the process
+void crash_client_unregister(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
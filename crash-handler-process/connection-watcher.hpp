@@ -0,0 +1,50 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef CONNECTION_WATCHER_H
+#define CONNECTION_WATCHER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+// Watches the connections of processes registered for the lifetime of their
+// connection. The kernel closes the connection of a process that dies, so
+// its hangup is reported as soon as it happens, without polling the pid.
+class ConnectionWatcher {
+public:
+	enum class Close {
+		// The process sent UNREGISTER on its connection
+		Unregistered,
+		Exited,
+		// The connection was closed by a process that is still running
+		Detached,
+	};
+	typedef std::function<void(int32_t pid, Close reason)> close_callback;
+
+	// Returns nullptr on platforms where processes register by pid only
+	static std::unique_ptr<ConnectionWatcher> create(close_callback on_close);
+
+	virtual ~ConnectionWatcher(){};
+
+	// Takes ownership of the connection and of the pidfd the process passed, -1 when none.
+	// Returns the pid of the peer, or 0 when the connection can not be watched.
+	virtual int32_t watch(int connection, int pidfd) = 0;
+};
+
+#endif
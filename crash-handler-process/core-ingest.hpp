@@ -0,0 +1,49 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef CORE_INGEST_H
+#define CORE_INGEST_H
+
+#include <cstdint>
+#include <string>
+
+// The crash the kernel reports when the handler runs as the core_pattern pipe
+struct CoreCrash {
+	int32_t pid = 0;
+	int32_t tid = 0;
+	int32_t signal = 0;
+	// Faulting address, from the signal information in the core
+	uint64_t address = 0;
+};
+
+// Reads an ELF core streamed on input, once and in order, and writes only
+// the threads, their stacks, the loaded modules and the signal as a
+// compressed minidump in directory. Nothing of the core is kept on disk.
+// The crash is completed with what the core records of it. Returns false
+// when no minidump was written.
+bool core_ingest(int input, CoreCrash &crash, const std::wstring &directory, std::wstring &written);
+
+// The core pattern runs the handler as root for every process of the system. Only
+// a process of the user owning directory is taken, and the handler then drops to
+// that user before anything is written, starting with a new log, created without
+// following links. An unknown uid or gid stands for the user the handler runs as
+// and the group of directory. Returns false when the core is not taken, nothing
+// can be logged then.
+bool core_take_ownership(uint32_t uid, uint32_t gid, const std::wstring &directory, const std::wstring &log);
+
+#endif
@@ -0,0 +1,84 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef CRASH_CONTEXT_H
+#define CRASH_CONTEXT_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+// Layout of the crash context page. The crash handler creates one page and
+// one eventfd per process in reply to Action::REGISTERCRASHCONTEXT. The
+// client library maps the page, and its signal handler fills it and wakes
+// the handler with a single write to the eventfd. The page is written once,
+// by the first thread that crashes.
+
+#define CRASH_CONTEXT_MAGIC 0x58434843 // "CHCX"
+#define CRASH_CONTEXT_VERSION 1
+#define CRASH_CONTEXT_SIZE 4096
+#define CRASH_CONTEXT_REGISTERS 40
+
+#define CRASH_CONTEXT_EMPTY 0
+#define CRASH_CONTEXT_WRITING 1
+#define CRASH_CONTEXT_WRITTEN 2
+
+#define CRASH_CONTEXT_ARCH_UNKNOWN 0
+#define CRASH_CONTEXT_ARCH_X86_64 1
+#define CRASH_CONTEXT_ARCH_AARCH64 2
+
+struct CrashContext {
+	uint32_t magic;
+	uint32_t version;
+	std::atomic<uint32_t> state;
+	int32_t pid;
+	int32_t tid;
+	int32_t signal;
+	// si_code of the signal
+	int32_t code;
+	uint32_t architecture;
+	// Faulting address for memory errors, si_addr
+	uint64_t address;
+	uint64_t instruction_pointer;
+	uint64_t stack_pointer;
+	// General purpose registers in the order of the architecture's ucontext
+	uint32_t register_count;
+	uint64_t registers[CRASH_CONTEXT_REGISTERS];
+};
+
+static_assert(sizeof(CrashContext) <= CRASH_CONTEXT_SIZE, "the crash context fits in one page");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "the state is shared between processes");
+
+// Serves the crash context pages of the processes of one handler
+class CrashContextChannel {
+public:
+	// Called with a copy of the page once its process has written it
+	typedef std::function<void(int32_t pid, const CrashContext &context)> report_callback;
+
+	// Returns nullptr on platforms where processes have no crash context page
+	static std::unique_ptr<CrashContextChannel> create(report_callback on_report);
+
+	virtual ~CrashContextChannel(){};
+
+	// Fills the page and eventfd descriptors to pass to the process, they stay owned by the channel
+	virtual bool attach(int32_t pid, int &page, int &event) = 0;
+	virtual void detach(int32_t pid) = 0;
+};
+
+#endif
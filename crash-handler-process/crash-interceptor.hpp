@@ -0,0 +1,80 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef CRASH_INTERCEPTOR_H
+#define CRASH_INTERCEPTOR_H
+
+#include "crash-context.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct CrashThreadState {
+	int32_t tid = 0;
+	uint64_t instruction_pointer = 0;
+	uint64_t stack_pointer = 0;
+	uint32_t register_count = 0;
+	uint64_t registers[CRASH_CONTEXT_REGISTERS] = {};
+};
+
+// State of a process stopped on its fatal signal
+struct CrashSnapshot {
+	// The faulting thread, laid out as the client library writes it
+	CrashContext context = {};
+	std::vector<CrashThreadState> threads;
+	// Memory of the faulting thread from its stack pointer up
+	uint64_t stack_address = 0;
+	std::vector<uint8_t> stack;
+};
+
+// Call chain of a thread, innermost frame first, each frame named module+offset
+struct ThreadStack {
+	int32_t tid = 0;
+	std::string name;
+	std::vector<std::string> frames;
+};
+
+// Traces processes without stopping them until a fatal signal is delivered.
+// The process is then held at the faulting instruction while the snapshot is
+// taken and reported, and let die of its signal afterwards.
+class CrashInterceptor {
+public:
+	// Runs on the tracer thread while the process is still held
+	typedef std::function<void(int32_t pid, const CrashSnapshot &snapshot)> crash_callback;
+
+	// Returns nullptr on platforms without process tracing
+	static std::unique_ptr<CrashInterceptor> create(crash_callback on_crash);
+
+	virtual ~CrashInterceptor(){};
+
+	virtual bool attach(int32_t pid) = 0;
+	virtual void detach(int32_t pid) = 0;
+
+	// Holds every thread of the process just long enough to read its registers and stack, and writes
+	// them as a minidump without any other memory. Works whether the process is traced or not.
+	virtual bool snapshot(int32_t pid, const std::string &path) = 0;
+
+	// Holds the threads only to copy their registers and the top of their stacks,
+	// then walks their frame pointers in the copies once the process runs again.
+	virtual bool sample(int32_t pid, std::vector<ThreadStack> &stacks) = 0;
+};
+
+#endif
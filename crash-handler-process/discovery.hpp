@@ -0,0 +1,42 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef DISCOVERY_H
+#define DISCOVERY_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+// Reports processes forked by watched processes, so helpers spawned by
+// plugins are monitored without sending REGISTER themselves.
+class ProcessDiscovery {
+public:
+	typedef std::function<void(int32_t parent, int32_t child)> fork_callback;
+	typedef std::function<void(int32_t pid, int32_t exit_code, int32_t term_signal)> exit_callback;
+
+	// Returns nullptr on platforms without discovery
+	static std::unique_ptr<ProcessDiscovery> create(fork_callback on_fork, exit_callback on_exit);
+
+	virtual ~ProcessDiscovery(){};
+
+	virtual void watch(int32_t pid) = 0;
+	virtual void unwatch(int32_t pid) = 0;
+};
+
+#endif
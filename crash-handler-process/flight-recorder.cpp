@@ -0,0 +1,286 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "flight-recorder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#if defined(WIN32)
+#include <windows.h>
+#include <process.h>
+#else // for __APPLE__ and other
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#if defined(WIN32)
+void *mapFile(HANDLE file, size_t size, HANDLE &section)
+{
+	section = CreateFileMappingW(file, NULL, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), NULL);
+	if (section == NULL)
+		return nullptr;
+
+	void *view = MapViewOfFile(section, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (view == NULL) {
+		CloseHandle(section);
+		section = NULL;
+	}
+	return view;
+}
+
+void unmapFile(void *view, HANDLE section)
+{
+	UnmapViewOfFile(view);
+	CloseHandle(section);
+}
+#else
+void *mapFile(int file, size_t size)
+{
+	void *view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	return view == MAP_FAILED ? nullptr : view;
+}
+#endif
+
+} // namespace
+
+FlightRecorder::~FlightRecorder()
+{
+#if defined(WIN32)
+	if (mapping)
+		unmapFile(mapping, section);
+	if (file) {
+		CloseHandle(file);
+		DeleteFileW(path.c_str());
+	}
+#else
+	if (mapping)
+		munmap(mapping, size);
+	if (file >= 0) {
+		// Removed while still locked, so no starting handler reads it back
+		const std::string file_path(path.begin(), path.end());
+		unlink(file_path.c_str());
+		close(file);
+	}
+#endif
+}
+
+std::unique_ptr<FlightRecorder> FlightRecorder::open(const std::wstring &path, size_t size, std::vector<FlightRecovery> &recovered)
+{
+	std::unique_ptr<FlightRecorder> recorder(new FlightRecorder());
+	size = std::max<size_t>(size, 4 * FLIGHT_SLOT_SIZE) / FLIGHT_SLOT_SIZE * FLIGHT_SLOT_SIZE;
+
+	// <path>.<pid> of every handler, and <path> itself as older versions named their ring
+#if defined(WIN32)
+	const std::filesystem::path base(path);
+	const std::wstring name = base.filename().wstring();
+	recorder->path = path + L"." + std::to_wstring(_getpid());
+#else
+	const std::filesystem::path base(std::string(path.begin(), path.end()));
+	const std::string name = base.filename().string();
+	recorder->path = path + L"." + std::to_wstring(getpid());
+#endif
+	std::error_code error;
+	const std::filesystem::path directory = base.has_parent_path() ? base.parent_path() : std::filesystem::path(".");
+	for (const auto &entry : std::filesystem::directory_iterator(directory, error)) {
+#if defined(WIN32)
+		const std::wstring entryName = entry.path().filename().wstring();
+		const bool numbered = entryName.size() > name.size() + 1 && entryName.compare(0, name.size() + 1, name + L".") == 0 &&
+				      entryName.find_first_not_of(L"0123456789", name.size() + 1) == std::wstring::npos;
+#else
+		const std::string entryName = entry.path().filename().string();
+		const bool numbered = entryName.size() > name.size() + 1 && entryName.compare(0, name.size() + 1, name + ".") == 0 &&
+				      entryName.find_first_not_of("0123456789", name.size() + 1) == std::string::npos;
+#endif
+		if (entryName == name || numbered)
+			recoverFile(entry.path(), recovered);
+	}
+
+#if defined(WIN32)
+	// Not shared, a starting handler then knows the ring is in use
+	HANDLE file = CreateFileW(recorder->path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return nullptr;
+	recorder->file = file;
+
+	LARGE_INTEGER target = {};
+	target.QuadPart = size;
+	if (!SetFilePointerEx(file, target, NULL, FILE_BEGIN) || !SetEndOfFile(file))
+		return nullptr;
+	recorder->size = size;
+	recorder->mapping = mapFile(file, size, recorder->section);
+#else // for __APPLE__ and other
+	const std::string file_path(recorder->path.begin(), recorder->path.end());
+	recorder->file = ::open(file_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0644);
+	if (recorder->file < 0)
+		return nullptr;
+	// Held until the handler is gone, a starting handler then knows the ring is in use
+	if (flock(recorder->file, LOCK_EX | LOCK_NB) != 0 || ftruncate(recorder->file, size) != 0)
+		return nullptr;
+	recorder->size = size;
+	recorder->mapping = mapFile(recorder->file, size);
+#endif
+	if (!recorder->mapping)
+		return nullptr;
+
+	recorder->reset();
+	return recorder;
+}
+
+void FlightRecorder::recoverFile(const std::filesystem::path &path, std::vector<FlightRecovery> &recovered)
+{
+	std::vector<uint8_t> data;
+#if defined(WIN32)
+	// Fails while the handler that owns the ring runs, it is removed once read otherwise
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | DELETE, 0, NULL, OPEN_EXISTING, FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	LARGE_INTEGER existing = {};
+	if (GetFileSizeEx(file, &existing) && existing.QuadPart > 0) {
+		data.resize(static_cast<size_t>(existing.QuadPart));
+		DWORD read = 0;
+		if (!ReadFile(file, data.data(), static_cast<DWORD>(data.size()), &read, NULL))
+			read = 0;
+		data.resize(read);
+	}
+	CloseHandle(file);
+#else
+	int file = ::open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+	if (file < 0)
+		return;
+	// The lock is held while the handler that owns the ring runs. A ring another starting handler already read is unlinked.
+	struct stat st = {};
+	if (flock(file, LOCK_EX | LOCK_NB) != 0 || fstat(file, &st) != 0 || st.st_nlink == 0) {
+		close(file);
+		return;
+	}
+	data.resize(static_cast<size_t>(st.st_size));
+	ssize_t read = 0;
+	for (size_t done = 0; done < data.size(); done += static_cast<size_t>(read)) {
+		read = pread(file, data.data() + done, data.size() - done, static_cast<off_t>(done));
+		if (read <= 0) {
+			data.resize(done);
+			break;
+		}
+	}
+	unlink(path.c_str());
+	close(file);
+#endif
+
+	FlightRecovery recovery;
+	recover(data, recovery);
+	if (!recovery.lines.empty())
+		recovered.push_back(std::move(recovery));
+}
+
+void FlightRecorder::reset()
+{
+	memset(mapping, 0, size);
+	header = static_cast<FlightHeader *>(mapping);
+	slots = reinterpret_cast<FlightSlot *>(header + 1);
+
+	memcpy(header->magic, FLIGHT_RECORDER_MAGIC, sizeof(header->magic));
+	header->version = FLIGHT_RECORDER_VERSION;
+	header->slot_count = static_cast<uint32_t>(size / FLIGHT_SLOT_SIZE - 1);
+#if defined(WIN32)
+	header->pid = static_cast<uint32_t>(_getpid());
+#else
+	header->pid = static_cast<uint32_t>(getpid());
+#endif
+	header->next.store(0, std::memory_order_relaxed);
+	header->flushed.store(0, std::memory_order_release);
+}
+
+void FlightRecorder::recover(const std::vector<uint8_t> &data, FlightRecovery &recovery)
+{
+	if (data.size() < 2 * FLIGHT_SLOT_SIZE)
+		return;
+	const FlightHeader *previous = reinterpret_cast<const FlightHeader *>(data.data());
+	if (memcmp(previous->magic, FLIGHT_RECORDER_MAGIC, sizeof(previous->magic)) != 0 || previous->version != FLIGHT_RECORDER_VERSION)
+		return;
+	if ((static_cast<uint64_t>(previous->slot_count) + 1) * FLIGHT_SLOT_SIZE > data.size())
+		return;
+
+	const FlightSlot *previousSlots = reinterpret_cast<const FlightSlot *>(previous + 1);
+	const uint64_t flushed = previous->flushed.load(std::memory_order_acquire);
+	recovery.pid = previous->pid;
+
+	// Slots still being written when the handler died have no sequence and are skipped
+	std::vector<std::pair<uint64_t, const FlightSlot *>> written;
+	for (uint32_t i = 0; i < previous->slot_count; i++) {
+		const uint64_t sequence = previousSlots[i].sequence.load(std::memory_order_acquire);
+		if (sequence > flushed)
+			written.push_back({sequence, &previousSlots[i]});
+	}
+	std::sort(written.begin(), written.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+	// A line is kept only when all its slots survived, in order
+	std::string line;
+	bool inLine = false;
+	uint64_t expected = 0;
+	for (const auto &entry : written) {
+		const FlightSlot *slot = entry.second;
+		if (slot->flags & FLIGHT_SLOT_FIRST) {
+			line.clear();
+			inLine = true;
+		} else if (!inLine || entry.first != expected) {
+			inLine = false;
+			continue;
+		}
+
+		line.append(slot->data, std::min<size_t>(slot->length, sizeof(slot->data)));
+		expected = entry.first + 1;
+		if (!(slot->flags & FLIGHT_SLOT_CONTINUED)) {
+			recovery.lines.push_back(line);
+			inLine = false;
+		}
+	}
+}
+
+uint64_t FlightRecorder::write(const std::string &line)
+{
+	const size_t payload = sizeof(FlightSlot::data);
+	size_t count = std::max<size_t>(1, (line.size() + payload - 1) / payload);
+	// Lines longer than half the ring are cut
+	count = std::min<size_t>(count, header->slot_count / 2);
+
+	const uint64_t first = header->next.fetch_add(count, std::memory_order_relaxed);
+	for (size_t i = 0; i < count; i++) {
+		FlightSlot &slot = slots[(first + i) % header->slot_count];
+		slot.sequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		const size_t offset = i * payload;
+		const size_t length = offset < line.size() ? std::min<size_t>(payload, line.size() - offset) : 0;
+		memcpy(slot.data, line.data() + offset, length);
+		slot.length = static_cast<uint16_t>(length);
+		slot.flags = (i == 0 ? FLIGHT_SLOT_FIRST : 0) | (i + 1 < count ? FLIGHT_SLOT_CONTINUED : 0);
+		slot.sequence.store(first + i + 1, std::memory_order_release);
+	}
+	return first + count;
+}
+
+void FlightRecorder::markFlushed(uint64_t sequence)
+{
+	header->flushed.store(sequence, std::memory_order_release);
+}
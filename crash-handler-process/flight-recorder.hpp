@@ -0,0 +1,104 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Fixed-size circular log file mapped in memory. A line is copied into one or
+// more consecutive slots and published by storing its sequence number last,
+// so the pages the kernel keeps after the crash handler dies hold every line
+// that was completely written. The next start reads the ordered tail back.
+// Each crash handler has its own ring, locked for as long as it runs, so a
+// handler handing over keeps writing its ring while the next one starts.
+
+#define FLIGHT_RECORDER_MAGIC "CHFLIGHT"
+#define FLIGHT_RECORDER_VERSION 1
+#define FLIGHT_SLOT_SIZE 128
+
+#define FLIGHT_SLOT_FIRST 0x1
+#define FLIGHT_SLOT_CONTINUED 0x2
+
+struct alignas(FLIGHT_SLOT_SIZE) FlightHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t slot_count;
+	uint32_t pid;
+	// Sequence of the next slot to write
+	std::atomic<uint64_t> next;
+	// Lines before this sequence are known to be in the log file
+	std::atomic<uint64_t> flushed;
+};
+
+struct alignas(FLIGHT_SLOT_SIZE) FlightSlot {
+	// Sequence + 1 once the slot is written, 0 while it is being written
+	std::atomic<uint64_t> sequence;
+	uint16_t length;
+	uint8_t flags;
+	char data[FLIGHT_SLOT_SIZE - 16];
+};
+
+static_assert(sizeof(FlightHeader) == FLIGHT_SLOT_SIZE, "the header takes one slot");
+static_assert(sizeof(FlightSlot) == FLIGHT_SLOT_SIZE, "slots must have a fixed size");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "sequences are stored in mapped memory");
+
+// Lines a crash handler that is gone left in its ring without flushing them to the log
+struct FlightRecovery {
+	uint32_t pid = 0;
+	std::vector<std::string> lines;
+};
+
+class FlightRecorder {
+public:
+	// The ring is removed, every line it holds was flushed to the log by then
+	~FlightRecorder();
+
+	// Maps <path>.<pid>, after reading back and removing the rings next to it that no running handler holds
+	static std::unique_ptr<FlightRecorder> open(const std::wstring &path, size_t size, std::vector<FlightRecovery> &recovered);
+
+	// Returns the sequence after the line
+	uint64_t write(const std::string &line);
+	void markFlushed(uint64_t sequence);
+
+private:
+	FlightRecorder() = default;
+
+	std::wstring path;
+	void *mapping = nullptr;
+	size_t size = 0;
+#if defined(WIN32)
+	void *file = nullptr;
+	void *section = nullptr;
+#else
+	int file = -1;
+#endif
+	FlightHeader *header = nullptr;
+	FlightSlot *slots = nullptr;
+
+	static void recoverFile(const std::filesystem::path &path, std::vector<FlightRecovery> &recovered);
+	static void recover(const std::vector<uint8_t> &data, FlightRecovery &recovery);
+	void reset();
+};
+
+#endif
@@ -0,0 +1,50 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef HEARTBEAT_H
+#define HEARTBEAT_H
+
+#include <atomic>
+#include <cstdint>
+
+// Layout of the shared heartbeat segment. The crash handler creates it and
+// hands the descriptor to a process in reply to Action::REGISTERHEARTBEAT,
+// together with the index of the slot that process owns. The process maps
+// the segment and increments its counter from its main loop.
+
+#define HEARTBEAT_SLOTS 64
+#define HEARTBEAT_CACHE_LINE 64
+
+struct alignas(HEARTBEAT_CACHE_LINE) HeartbeatSlot {
+	std::atomic<uint64_t> counter;
+	std::atomic<uint32_t> pid;
+};
+
+struct HeartbeatSegment {
+	HeartbeatSlot slots[HEARTBEAT_SLOTS];
+};
+
+static_assert(sizeof(HeartbeatSlot) == HEARTBEAT_CACHE_LINE, "heartbeat slots must not share a cache line");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "heartbeat counters must be lock free to be shared between processes");
+
+inline void heartbeat_beat(HeartbeatSegment *segment, uint32_t slot)
+{
+	segment->slots[slot].counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+#endif
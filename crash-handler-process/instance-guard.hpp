@@ -0,0 +1,46 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef INSTANCE_GUARD_H
+#define INSTANCE_GUARD_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Keeps a single crash handler per pid file. The running instance holds a
+// lock on the file and listens for the next instance, which asks it to hand
+// over: the running instance stops monitoring and passes its registered
+// processes on instead of being killed.
+class InstanceGuard {
+public:
+	// Returns the state to pass on and stops the instance, or returns false to refuse
+	typedef std::function<bool(std::vector<char> &state)> handover_callback;
+
+	// Returns nullptr where Util::check_pid_file kills the previous instance instead
+	static std::unique_ptr<InstanceGuard> create(const std::string &pidPath);
+
+	virtual ~InstanceGuard(){};
+
+	// Takes the lock, after a handover when another instance holds it. Returns false when it could not be taken in time.
+	virtual bool acquire(std::vector<char> &handedOver) = 0;
+	virtual void serve(handover_callback handover) = 0;
+};
+
+#endif
@@ -0,0 +1,66 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <cstdint>
+
+// Layout of the binary log, shared by the logger and crash-handler-logdecode.
+//
+// A file is a sequence of segments, one per time it was opened for writing:
+//   segment     "CHBL", uint8 version, uint32 pid
+//   descriptor  'D', uint32 id, uint8 level, uint32 line, str file, str format, str types
+//   event       'E', uint32 id, uint64 microseconds since epoch, arguments
+// A descriptor is written once per segment, before the first event of its
+// call site. The format holds the literal text of the call site with {} in
+// place of each argument, and {{ and }} for literal braces. Types holds one
+// character per argument, encoded as:
+//   b uint8, c char, i int64, u uint64, f double, s str
+// where str is a uint32 byte length followed by the bytes. Integers are
+// little endian.
+
+#define LOG_FORMAT_MAGIC "CHBL"
+#define LOG_FORMAT_MAGIC_SIZE 4
+#define LOG_FORMAT_VERSION 1
+
+enum class LogLevel : uint8_t { Info = 0, Debug = 1, Error = 2 };
+
+#define LOG_RECORD_DESCRIPTOR 'D'
+#define LOG_RECORD_EVENT 'E'
+
+#define LOG_ARG_BOOL 'b'
+#define LOG_ARG_CHAR 'c'
+#define LOG_ARG_SIGNED 'i'
+#define LOG_ARG_UNSIGNED 'u'
+#define LOG_ARG_DOUBLE 'f'
+#define LOG_ARG_STRING 's'
+
+inline const char *log_level_prefix(LogLevel level)
+{
+	switch (level) {
+	case LogLevel::Debug:
+		return "DBG";
+	case LogLevel::Error:
+		return "ERR";
+	default:
+		return "INF";
+	}
+}
+
+#endif
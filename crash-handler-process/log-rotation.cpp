@@ -0,0 +1,260 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "log-rotation.hpp"
+#include "metrics.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if !defined(WIN32)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+#if defined(HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(HAVE_ZLIB)
+const std::wstring generation_extension = L".gz";
+#else
+const std::wstring generation_extension = L"";
+#endif
+
+uint64_t log_file_size(const std::wstring &path)
+{
+#if defined(WIN32)
+	struct _stat64 st = {};
+	if (_wstat64(path.c_str(), &st) != 0)
+		return 0;
+#else // for __APPLE__ and other
+	struct stat st = {};
+	if (stat(std::string(path.begin(), path.end()).c_str(), &st) != 0)
+		return 0;
+#endif
+	return static_cast<uint64_t>(st.st_size);
+}
+
+bool log_file_rename(const std::wstring &from, const std::wstring &to)
+{
+#if defined(WIN32)
+	return _wrename(from.c_str(), to.c_str()) == 0;
+#else
+	return rename(std::string(from.begin(), from.end()).c_str(), std::string(to.begin(), to.end()).c_str()) == 0;
+#endif
+}
+
+void log_file_remove(const std::wstring &path)
+{
+#if defined(WIN32)
+	_wremove(path.c_str());
+#else
+	remove(std::string(path.begin(), path.end()).c_str());
+#endif
+}
+
+int log_file_share(const std::wstring &path)
+{
+#if defined(WIN32)
+	return -1;
+#else
+	int share = open(std::string(path.begin(), path.end()).c_str(), O_RDONLY | O_CLOEXEC);
+	if (share >= 0 && flock(share, LOCK_SH | LOCK_NB) != 0) {
+		close(share);
+		share = -1;
+	}
+	return share;
+#endif
+}
+
+void log_file_unshare(int &share)
+{
+#if !defined(WIN32)
+	if (share >= 0)
+		close(share);
+#endif
+	share = -1;
+}
+
+namespace {
+
+#define LOG_ROTATION_WRITER_WAIT_MS 5000
+
+// Gives up after a while, a handler stuck on its way out must not hold the archives back
+void waitForWriters(const std::wstring &path)
+{
+#if !defined(WIN32)
+	int fd = open(std::string(path.begin(), path.end()).c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(LOG_ROTATION_WRITER_WAIT_MS);
+	while (flock(fd, LOCK_EX | LOCK_NB) != 0 && std::chrono::steady_clock::now() < deadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	close(fd);
+#endif
+}
+
+bool compressFile(const std::wstring &source, const std::wstring &destination)
+{
+#if defined(HAVE_ZLIB)
+#if defined(WIN32)
+	std::ifstream input(source, std::ios::in | std::ios::binary);
+	gzFile output = gzopen_w(destination.c_str(), "wb6");
+#else
+	std::ifstream input(std::string(source.begin(), source.end()), std::ios::in | std::ios::binary);
+	gzFile output = gzopen(std::string(destination.begin(), destination.end()).c_str(), "wb6");
+#endif
+	if (!input.is_open() || output == NULL) {
+		if (output != NULL)
+			gzclose(output);
+		return false;
+	}
+
+	std::vector<char> buffer(64 * 1024);
+	bool written = true;
+	while (input) {
+		input.read(buffer.data(), buffer.size());
+		const std::streamsize count = input.gcount();
+		if (count > 0 && gzwrite(output, buffer.data(), static_cast<unsigned>(count)) != count) {
+			written = false;
+			break;
+		}
+	}
+	written &= gzclose(output) == Z_OK;
+	if (written) {
+		static MetricCounter &compressed = Metrics::getInstance()->counter("crash_handler_compressed_bytes_total", "Bytes compressed into archives and rotated logs");
+		compressed.add(log_file_size(source));
+	}
+	if (!written)
+		log_file_remove(destination);
+	return written;
+#else
+	return log_file_rename(source, destination);
+#endif
+}
+
+} // namespace
+
+LogRotator *LogRotator::getInstance()
+{
+	static LogRotator instance;
+	return &instance;
+}
+
+LogRotator::~LogRotator()
+{
+	stop();
+}
+
+LogRotationPolicy LogRotator::getPolicy()
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	return policy;
+}
+
+void LogRotator::setPolicy(const LogRotationPolicy &policy)
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	this->policy = policy;
+	if (this->policy.generations == 0)
+		this->policy.generations = 1;
+}
+
+static MetricGauge &queueDepth()
+{
+	static MetricGauge &depth = Metrics::getInstance()->gauge("crash_handler_log_rotation_queue_depth", "Rotated logs waiting to be archived");
+	return depth;
+}
+
+void LogRotator::submit(const std::wstring &logPath, const std::wstring &pendingPath)
+{
+	queueDepth().add(1);
+	{
+		const std::lock_guard<std::mutex> lock(mtx);
+		queue.push_back({logPath, pendingPath});
+		if (!worker && !stopping)
+			worker = new std::thread(&LogRotator::worker_fnc, this);
+	}
+	event.notify_one();
+}
+
+void LogRotator::stop()
+{
+	std::thread *stopped = nullptr;
+	{
+		const std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+		stopped = worker;
+		worker = nullptr;
+	}
+	event.notify_one();
+
+	if (stopped) {
+		if (stopped->joinable())
+			stopped->join();
+		delete stopped;
+	}
+
+	// Submitted after the thread was gone
+	std::unique_lock<std::mutex> lock(mtx);
+	while (!queue.empty()) {
+		Pending pending = queue.front();
+		queue.pop_front();
+		const uint32_t generations = policy.generations;
+		lock.unlock();
+		archive(pending, generations);
+		lock.lock();
+	}
+}
+
+void LogRotator::worker_fnc()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		event.wait(lock, [this] { return stopping || !queue.empty(); });
+		if (queue.empty())
+			break;
+
+		Pending pending = queue.front();
+		queue.pop_front();
+		const uint32_t generations = policy.generations;
+
+		lock.unlock();
+		archive(pending, generations);
+		lock.lock();
+	}
+}
+
+void LogRotator::archive(const Pending &pending, uint32_t generations)
+{
+	static MetricHistogram &duration = Metrics::getInstance()->histogram("crash_handler_log_rotation_seconds", "Time to archive a rotated log", 1e-6);
+	MetricTimer timer(duration);
+	queueDepth().add(-1);
+	auto generation = [&pending](uint32_t index) { return pending.logPath + L"." + std::to_wstring(index) + generation_extension; };
+
+	log_file_remove(generation(generations));
+	for (uint32_t index = generations; index > 1; index--)
+		log_file_rename(generation(index - 1), generation(index));
+
+	waitForWriters(pending.pendingPath);
+	if (compressFile(pending.pendingPath, generation(1)))
+		log_file_remove(pending.pendingPath);
+}
@@ -0,0 +1,82 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef LOG_ROTATION_H
+#define LOG_ROTATION_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// When a log file is rotated, shared by every log output
+struct LogRotationPolicy {
+	uint64_t maxBytes = 1 * 1024 * 1024;
+	// Zero when logs are rotated on size only
+	std::chrono::minutes maxAge{0};
+	uint32_t generations = 3;
+	// Off until the handler serving the application sets the policy, the log may still be written by the previous one
+	bool enabled = false;
+};
+
+// Shifts rotated logs into numbered generations, <log>.1.gz being the newest,
+// and compresses them. A log output only renames its file aside and reopens
+// it, the rest happens on the rotator thread.
+class LogRotator {
+public:
+	static LogRotator *getInstance();
+
+	LogRotationPolicy getPolicy();
+	void setPolicy(const LogRotationPolicy &policy);
+
+	void submit(const std::wstring &logPath, const std::wstring &pendingPath);
+	// Archives what was submitted so far and stops the thread
+	void stop();
+
+private:
+	LogRotator() = default;
+	~LogRotator();
+
+	struct Pending {
+		std::wstring logPath;
+		std::wstring pendingPath;
+	};
+
+	LogRotationPolicy policy;
+	std::thread *worker = nullptr;
+	std::deque<Pending> queue;
+	bool stopping = false;
+	std::mutex mtx;
+	std::condition_variable event;
+
+	void worker_fnc();
+	void archive(const Pending &pending, uint32_t generations);
+};
+
+uint64_t log_file_size(const std::wstring &path);
+bool log_file_rename(const std::wstring &from, const std::wstring &to);
+void log_file_remove(const std::wstring &path);
+// A writer holds the log shared so a rotated file is archived only once every handler closed it,
+// a handler that handed over may still write its last lines. Windows refuses to rename an open log.
+int log_file_share(const std::wstring &path);
+void log_file_unshare(int &share);
+
+#endif
@@ -25,6 +25,7 @@
 #include <iomanip>
 #include <sys/types.h>
 #include <stdlib.h>
+#include <string.h>
 #if defined(WIN32)
 #include <filesystem>
 #include <process.h>
@@ -36,8 +37,15 @@
 bool log_output_working = false;
 
 std::wstring log_output_path;
-std::ofstream log_output_file;
+LogOutput log_output_file;
+thread_local LogOutput *log_thread_output = nullptr;
 static int pid = 0;
+static std::atomic<uint32_t> log_site_count{0};
+
+// Room for the lines of a batch, so the stream never flushes on its own
+#define LOG_BUFFER_SIZE (64 * 1024)
+#define LOG_FLUSH_BYTES (32 * 1024)
+#define LOG_FLUSH_LINES 64
 
 const std::string getTimeStamp()
 {
@@ -60,43 +68,12 @@ void logging_start(std::wstring &log_path)
 	if (!log_output_working && log_path.length()) {
 #if defined(WIN32)
 		pid = _getpid();
-		try {
-			std::uintmax_t size = std::filesystem::file_size(log_path);
-			if (size > 1 * 1024 * 1024) {
-				std::filesystem::path log_file = log_path;
-				std::filesystem::path log_file_old = log_file;
-				log_file_old.replace_extension("log.old");
-
-				std::filesystem::remove_all(log_file_old);
-				std::filesystem::rename(log_file, log_file_old);
-			}
-		} catch (...) {
-		}
-		log_output_file.open(log_path, std::ios_base::out | std::ios_base::app);
 #else // for __APPLE__ and other
 		pid = getpid();
-
-		FILE *fp = NULL;
-		long size = 0;
-		std::string log_file = std::string(log_path.begin(), log_path.end());
-		// ! IMPORTANT !
-		// macOS 10.13 and older not support cpp filesystem functionality
-		fp = fopen(log_file.c_str(), "r");
-		if (fp != NULL) {
-			if (fseek(fp, 0, SEEK_END) != -1) {
-				size = ftell(fp);
-			}
-			fclose(fp);
-		}
-
-		if (size > 1 * 1024 * 1024) {
-			std::string log_file_old = log_file + ".old";
-			remove(log_file_old.c_str());
-			rename(log_file.c_str(), log_file_old.c_str());
-		}
-		log_output_file.open(log_file, std::ios_base::out | std::ios_base::app);
 #endif
-		if (log_output_file.is_open()) {
+		// A log left over the size limit by the previous run is rotated once the rotation policy is set
+		log_output_file.open(log_path, false);
+		if (log_output_file.isOpen()) {
 			log_output_working = true;
 		} else {
 			std::cout << "Failed to open log file, error = " << strerror(errno) << std::endl;
@@ -106,10 +83,290 @@ void logging_start(std::wstring &log_path)
 	log_output_path = log_path;
 }
 
+void logging_use_binary()
+{
+	if (!log_output_working || log_output_file.isBinary())
+		return;
+
+	const std::wstring binary_path = log_output_path + L".bin";
+	log_info << "Log continues in binary format in " << std::string(binary_path.begin(), binary_path.end()) << std::endl;
+	log_output_file.close();
+	log_output_working = log_output_file.open(binary_path, true);
+}
+
+void logging_use_flight_recorder(size_t size)
+{
+	if (!log_output_working)
+		return;
+	if (log_output_file.isBinary()) {
+		log_info << "Flight recorder is not used with a binary log" << std::endl;
+		return;
+	}
+
+	std::vector<FlightRecovery> recovered;
+	const std::wstring recorder_path = log_output_path + L".flight";
+	std::unique_ptr<FlightRecorder> recorder = FlightRecorder::open(recorder_path, size, recovered);
+	if (!recorder) {
+		log_error << "Failed to open flight recorder " << std::string(recorder_path.begin(), recorder_path.end()) << std::endl;
+		return;
+	}
+
+	for (const FlightRecovery &recovery : recovered) {
+		log_info << "Recovered " << recovery.lines.size() << " lines not flushed by crash handler " << recovery.pid << std::endl;
+		for (const std::string &line : recovery.lines)
+			log_output_file.writeLine(line);
+		log_info << "End of recovered lines" << std::endl;
+	}
+	log_output_file.attachRecorder(std::move(recorder));
+}
+
+void logging_set_rotation(const LogRotationPolicy &policy)
+{
+	LogRotator::getInstance()->setPolicy(policy);
+	log_output_file.setRotation(LogRotator::getInstance()->getPolicy());
+}
+
+std::unique_ptr<LogOutput> logging_open(const std::wstring &log_path)
+{
+	auto output = std::make_unique<LogOutput>();
+	const bool binary = log_output_file.isBinary();
+	if (!output->open(binary ? log_path + L".bin" : log_path, binary))
+		return nullptr;
+	return output;
+}
+
 void logging_end()
 {
-	if (!log_output_working) {
+	if (log_output_working) {
 		log_output_working = false;
 		log_output_file.close();
 	}
+	LogRotator::getInstance()->stop();
+}
+
+LogSite::LogSite(LogLevel level, const char *file, uint32_t line) : level(level), file(file), line(line), id(log_site_count++) {}
+
+namespace {
+
+void putString(std::string &buffer, const std::string &value)
+{
+	const uint32_t size = static_cast<uint32_t>(value.size());
+	buffer.append(reinterpret_cast<const char *>(&size), sizeof(size));
+	buffer.append(value);
+}
+
+template<typename T> void putValue(std::string &buffer, T value)
+{
+	buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+} // namespace
+
+LogOutput::~LogOutput()
+{
+	close();
+}
+
+bool LogOutput::open(const std::wstring &path, bool binary)
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	this->path = path;
+	this->binary = binary;
+	rotation = LogRotator::getInstance()->getPolicy();
+	return openFile();
+}
+
+bool LogOutput::openFile()
+{
+	buffer.resize(LOG_BUFFER_SIZE);
+	file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+	const std::ios_base::openmode mode = std::ios_base::out | std::ios_base::app | (binary ? std::ios_base::binary : std::ios_base::openmode());
+#if defined(WIN32)
+	file.open(path, mode);
+#else // for __APPLE__ and other
+	file.open(std::string(path.begin(), path.end()), mode);
+#endif
+	described.clear();
+	if (file.is_open())
+		share = log_file_share(path);
+	written = log_file_size(path);
+	openedAt = std::chrono::steady_clock::now();
+	if (!file.is_open())
+		return false;
+
+	if (binary) {
+		// Descriptors are only valid within the segment that declares them
+		std::string segment(LOG_FORMAT_MAGIC, LOG_FORMAT_MAGIC_SIZE);
+		putValue<uint8_t>(segment, LOG_FORMAT_VERSION);
+		putValue<uint32_t>(segment, static_cast<uint32_t>(pid));
+		file.write(segment.data(), segment.size());
+		file.flush();
+	}
+	return true;
+}
+
+void LogOutput::close()
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	if (!file.is_open())
+		return;
+
+	flush();
+	file.close();
+	log_file_unshare(share);
+}
+
+void LogOutput::attachRecorder(std::unique_ptr<FlightRecorder> recorder)
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	flush();
+	this->recorder = std::move(recorder);
+}
+
+void LogOutput::setRotation(const LogRotationPolicy &policy)
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	rotation = policy;
+}
+
+void LogOutput::rotateIfNeeded()
+{
+	if (!rotation.enabled)
+		return;
+	const bool tooLarge = written >= rotation.maxBytes;
+	const bool tooOld = rotation.maxAge.count() && std::chrono::steady_clock::now() - openedAt >= rotation.maxAge;
+	if (!tooLarge && !tooOld)
+		return;
+
+	// Only a rename and a reopen happen here, archiving is left to the rotator thread. The pid keeps
+	// the name apart from files a previous run left pending.
+	static std::atomic<uint32_t> rotations{0};
+	flush();
+	file.close();
+	log_file_unshare(share);
+	const std::wstring pending = path + L".rotating." + std::to_wstring(pid) + L"." + std::to_wstring(rotations++);
+	const bool renamed = log_file_rename(path, pending);
+	if (renamed)
+		LogRotator::getInstance()->submit(path, pending);
+	openFile();
+	if (!renamed) {
+		// The file keeps growing, the next attempt waits for another full period instead of the next line
+		written = 0;
+		openedAt = std::chrono::steady_clock::now();
+	}
+}
+
+void LogOutput::flush()
+{
+	file.flush();
+	if (recorder)
+		recorder->markFlushed(recorded);
+	unflushedLines = 0;
+	unflushedBytes = 0;
+}
+
+void LogOutput::writeLine(const std::string &line)
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	rotateIfNeeded();
+	file << line;
+	written += line.size();
+	if (!recorder) {
+		file.flush();
+		return;
+	}
+
+	// The recorder keeps the lines still buffered when the handler dies
+	recorded = recorder->write(line);
+	unflushedBytes += line.size();
+	if (++unflushedLines >= LOG_FLUSH_LINES || unflushedBytes >= LOG_FLUSH_BYTES)
+		flush();
+}
+
+void LogOutput::writeRecord(LogSite &site, uint64_t time_us, const std::string &args)
+{
+	std::string record;
+	const std::lock_guard<std::mutex> lock(mtx);
+	rotateIfNeeded();
+
+	if (site.id >= described.size())
+		described.resize(site.id + 1, false);
+	if (!described[site.id]) {
+		const std::lock_guard<std::mutex> siteLock(site.mtx);
+		putValue<uint8_t>(record, LOG_RECORD_DESCRIPTOR);
+		putValue<uint32_t>(record, site.id);
+		putValue<uint8_t>(record, static_cast<uint8_t>(site.level));
+		putValue<uint32_t>(record, site.line);
+		putString(record, site.file);
+		putString(record, site.format);
+		putString(record, site.types);
+		described[site.id] = true;
+	}
+
+	putValue<uint8_t>(record, LOG_RECORD_EVENT);
+	putValue<uint32_t>(record, site.id);
+	putValue<uint64_t>(record, time_us);
+	record.append(args);
+
+	// Flushed in batches like the lines of a recorded text log, errors are written out at once
+	file.write(record.data(), record.size());
+	written += record.size();
+	unflushedBytes += record.size();
+	if (++unflushedLines >= LOG_FLUSH_LINES || unflushedBytes >= LOG_FLUSH_BYTES || site.level == LogLevel::Error)
+		flush();
+}
+
+LogRecord::LogRecord(LogSite &site)
+	: site(site), output(log_thread_output ? log_thread_output : &log_output_file), learning(!site.learned.load(std::memory_order_acquire))
+{
+	time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	if (!output->isBinary())
+		text << log_level_prefix(site.level) << ":" << getTimeStamp() << ": ";
+}
+
+LogRecord::~LogRecord()
+{
+	if (learning) {
+		const std::lock_guard<std::mutex> lock(site.mtx);
+		if (!site.learned.load(std::memory_order_relaxed)) {
+			site.format = std::move(format);
+			site.types = std::move(types);
+			site.learned.store(true, std::memory_order_release);
+		}
+	}
+
+	if (output->isBinary())
+		output->writeRecord(site, time_us, args);
+	else
+		output->writeLine(text.str());
+}
+
+void LogRecord::appendLiteral(const char *value, size_t size)
+{
+	if (learning) {
+		for (size_t i = 0; i < size; i++) {
+			format += value[i];
+			if (value[i] == '{' || value[i] == '}')
+				format += value[i];
+		}
+	}
+	if (!output->isBinary())
+		text.write(value, size);
+}
+
+void LogRecord::appendString(const std::string &value)
+{
+	if (learning) {
+		format += "{}";
+		types += LOG_ARG_STRING;
+	}
+	if (!output->isBinary()) {
+		text << value;
+	} else if (formatted && text.width()) {
+		text.str("");
+		text << value;
+		putString(args, text.str());
+	} else {
+		putString(args, value);
+	}
 }
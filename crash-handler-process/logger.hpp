@@ -19,27 +19,216 @@
 #pragma once
 
 #include <iostream>
+#include <iomanip>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <type_traits>
+
+#include "log-format.hpp"
+#include "flight-recorder.hpp"
+#include "log-rotation.hpp"
 
 const std::string getTimeStamp();
 
+// A log call site. Its format is learned from the first line logged there and
+// written to a binary log once, the records that follow carry only arguments.
+struct LogSite {
+	LogSite(LogLevel level, const char *file, uint32_t line);
+
+	const LogLevel level;
+	const char *const file;
+	const uint32_t line;
+	const uint32_t id;
+
+	std::atomic<bool> learned{false};
+	std::mutex mtx;
+	std::string format;
+	std::string types;
+};
+
+// A log file, written as text lines or as binary records (see log-format.hpp)
+class LogOutput {
+public:
+	~LogOutput();
+
+	bool open(const std::wstring &path, bool binary);
+	bool isOpen() const { return file.is_open(); }
+	bool isBinary() const { return binary; }
+	void close();
+
+	// Lines are then copied to the recorder and the file is flushed in batches
+	void attachRecorder(std::unique_ptr<FlightRecorder> recorder);
+	void setRotation(const LogRotationPolicy &policy);
+
+	void writeLine(const std::string &line);
+	void writeRecord(LogSite &site, uint64_t time_us, const std::string &args);
+
+private:
+	std::ofstream file;
+	std::vector<char> buffer;
+	std::wstring path;
+	int share = -1;
+	bool binary = false;
+	std::vector<bool> described;
+	std::mutex mtx;
+
+	std::unique_ptr<FlightRecorder> recorder;
+	uint64_t recorded = 0;
+	size_t unflushedLines = 0;
+	size_t unflushedBytes = 0;
+
+	LogRotationPolicy rotation;
+	uint64_t written = 0;
+	std::chrono::steady_clock::time_point openedAt;
+
+	bool openFile();
+	void flush();
+	void rotateIfNeeded();
+};
+
 extern std::wstring log_output_path;
-extern std::ofstream log_output_file;
+extern LogOutput log_output_file;
 extern bool log_output_working;
 
-#define log_info                   \
-	if (!log_output_working) { \
-	} else                     \
-		log_output_file << "INF:" << getTimeStamp() << ": "
-#define log_debug                  \
-	if (!log_output_working) { \
-	} else                     \
-		log_output_file << "DBG:" << getTimeStamp() << ": "
-#define log_error                  \
-	if (!log_output_working) { \
-	} else                     \
-		log_output_file << "ERR:" << getTimeStamp() << ": "
+// A session log set for the current thread takes precedence over the process log
+extern thread_local LogOutput *log_thread_output;
+
+struct LogScope {
+	LogOutput *previous;
+	LogScope(LogOutput *output) : previous(log_thread_output) { log_thread_output = output; }
+	~LogScope() { log_thread_output = previous; }
+};
+
+// std::setw and the other manipulators taking an argument, whose types are unspecified
+template<typename T>
+constexpr bool is_log_manipulator_v = std::is_same_v<T, decltype(std::setw(0))> || std::is_same_v<T, decltype(std::setprecision(0))> ||
+				      std::is_same_v<T, decltype(std::setfill('0'))> || std::is_same_v<T, decltype(std::setbase(0))>;
+
+// One logged line, written when the statement ends
+class LogRecord {
+public:
+	LogRecord(LogSite &site);
+	~LogRecord();
+
+	// Literal text belongs to the format of the call site, everything else is an argument
+	template<size_t N> LogRecord &operator<<(const char (&text)[N])
+	{
+		appendLiteral(text, N - 1);
+		return *this;
+	}
+	LogRecord &operator<<(const std::string &value)
+	{
+		appendString(value);
+		return *this;
+	}
+	LogRecord &operator<<(std::ostream &(*manipulator)(std::ostream &))
+	{
+		// std::endl and friends, a record ends with the statement anyway
+		if (learning && manipulator == static_cast<std::ostream &(*)(std::ostream &)>(std::endl))
+			format += "\n";
+		if (!output->isBinary())
+			text << manipulator;
+		return *this;
+	}
+	// std::hex and friends change how the values that follow are written, see appendValue
+	LogRecord &operator<<(std::ios_base &(*manipulator)(std::ios_base &))
+	{
+		text << manipulator;
+		formatted = true;
+		return *this;
+	}
+	template<typename T> LogRecord &operator<<(const T &value)
+	{
+		if constexpr (is_log_manipulator_v<T>) {
+			text << value;
+			formatted = true;
+		} else if constexpr (std::is_same_v<T, bool>)
+			appendValue(LOG_ARG_BOOL, value, static_cast<uint8_t>(value));
+		else if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>)
+			appendValue(LOG_ARG_CHAR, value, static_cast<uint8_t>(value));
+		else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+			appendValue(LOG_ARG_SIGNED, value, static_cast<int64_t>(value));
+		else if constexpr (std::is_integral_v<T>)
+			appendValue(LOG_ARG_UNSIGNED, value, static_cast<uint64_t>(value));
+		else if constexpr (std::is_floating_point_v<T>)
+			appendValue(LOG_ARG_DOUBLE, value, static_cast<double>(value));
+		else if constexpr (std::is_convertible_v<T, const char *>)
+			appendString(value ? std::string(value) : std::string("(null)"));
+		else {
+			std::ostringstream rendered;
+			rendered << value;
+			appendString(rendered.str());
+		}
+		return *this;
+	}
+
+private:
+	LogSite &site;
+	LogOutput *output;
+	bool learning;
+	// A manipulator was applied, values are then written to a binary record as rendered text
+	bool formatted = false;
+	uint64_t time_us;
+	std::ostringstream text;
+	std::string args;
+	std::string format;
+	std::string types;
+
+	void appendLiteral(const char *value, size_t size);
+	void appendString(const std::string &value);
+	template<typename T, typename E> void appendValue(char type, const T &value, E encoded)
+	{
+		if (formatted && output->isBinary()) {
+			// The stream of a binary record holds only the state set by the manipulators
+			text.str("");
+			text << value;
+			appendString(text.str());
+			return;
+		}
+		if (learning) {
+			format += "{}";
+			types += type;
+		}
+		if (output->isBinary())
+			args.append(reinterpret_cast<const char *>(&encoded), sizeof(E));
+		else
+			text << value;
+	}
+};
+
+// Every expansion is its own lambda, so every call site gets its own static descriptor
+#define LOG_SITE(level)                                        \
+	([]() -> LogSite & {                                   \
+		static LogSite site(level, __FILE__, __LINE__); \
+		return site;                                   \
+	}())
+
+#define log_info                                         \
+	if (!log_output_working && !log_thread_output) { \
+	} else                                           \
+		LogRecord(LOG_SITE(LogLevel::Info))
+#define log_debug                                        \
+	if (!log_output_working && !log_thread_output) { \
+	} else                                           \
+		LogRecord(LOG_SITE(LogLevel::Debug))
+#define log_error                                        \
+	if (!log_output_working && !log_thread_output) { \
+	} else                                           \
+		LogRecord(LOG_SITE(LogLevel::Error))
 
 void logging_start(std::wstring &log_path);
+// Continues the process log, and opens session logs, as binary records
+void logging_use_binary();
+// Mirrors the process log in a mapped ring of the given size, written back to the log by the next start
+void logging_use_flight_recorder(size_t size);
+// Applies to the process log, and to the session logs opened afterwards
+void logging_set_rotation(const LogRotationPolicy &policy);
+// Opens a session log in the format of the process log
+std::unique_ptr<LogOutput> logging_open(const std::wstring &log_path);
 void logging_end();
\ No newline at end of file
@@ -19,27 +19,80 @@
 #include "logger.hpp"
 #include "process-manager.hpp"
 #include "util.hpp"
+#include "options.hpp"
+#include "session-manager.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include "instance-guard.hpp"
+#include "core-ingest.hpp"
+#include <algorithm>
 #include <codecvt>
+#include <cstdlib>
+#include <cstring>
+#include <locale>
+#include <thread>
 
 #if defined(WIN32)
 const std::string log_file_name = "\\crash-handler.log";
 #else // for __APPLE__ and other
 const std::wstring log_file_name = L"/crash-handler.log";
+
+// A core pipe instance runs while the handler of the application may still write its log, it logs to
+// <log>.core-<pid> instead. Options are only parsed once the log is open, so the arguments are looked at here.
+static std::string core_pipe_log_suffix(int argc, char **argv)
+{
+	bool corePipe = false;
+	std::string pid = "0";
+	for (int i = 6; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "--core-pipe")
+			corePipe = true;
+		else if (arg.rfind("--core-pid=", 0) == 0)
+			pid = arg.substr(strlen("--core-pid="));
+	}
+	return corePipe ? ".core-" + pid : std::string();
+}
+
+// Looked at before the log is opened for the same reason, the core is only taken for the user owning the cache path
+static bool core_pipe_taken(int argc, char **argv, const std::wstring &cache_path, const std::wstring &log_path)
+{
+	uint32_t uid = static_cast<uint32_t>(-1);
+	uint32_t gid = static_cast<uint32_t>(-1);
+	for (int i = 6; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg.rfind("--core-uid=", 0) == 0)
+			uid = static_cast<uint32_t>(strtoul(arg.c_str() + strlen("--core-uid="), nullptr, 10));
+		else if (arg.rfind("--core-gid=", 0) == 0)
+			gid = static_cast<uint32_t>(strtoul(arg.c_str() + strlen("--core-gid="), nullptr, 10));
+	}
+	return core_take_ownership(uid, gid, cache_path, log_path);
+}
 #endif
 
+// Only called once this instance serves the application. The previous handler
+// is stopped by then, or has handed over and only adds its last lines, archived once it closed the log.
+static void take_over_log()
+{
+	LogRotationPolicy rotation;
+	rotation.maxBytes = static_cast<uint64_t>(std::max<uint32_t>(Options::get().logMaxKb, 1)) * 1024;
+	rotation.maxAge = std::chrono::minutes(Options::get().logMaxAgeMin);
+	rotation.generations = std::max<uint32_t>(Options::get().logGenerations, 1);
+	rotation.enabled = true;
+	logging_set_rotation(rotation);
+
+	if (Options::get().flightRecorderKb)
+		logging_use_flight_recorder(static_cast<size_t>(Options::get().flightRecorderKb) * 1024);
+}
+
 int main(int argc, char **argv)
 {
 	Util::setupLocale();
 
-	std::string pid_path(Util::get_temp_directory());
-	pid_path.append("crash-handler.pid");
-	Util::check_pid_file(pid_path);
-	Util::write_pid_file(pid_path);
-
 	std::wstring path;
 	std::wstring version;
 	std::wstring isDevEnv;
 	std::wstring ipc_path;
+	std::wstring app_cache_path;
 
 	std::cout << "Launched with number of arguments = " << argc << std::endl;
 #if defined(WIN32)
@@ -64,13 +117,19 @@ int main(int argc, char **argv)
 		std::wstring w_cache_path = converter.from_bytes(cache_path.c_str());
 		logging_start(w_log_path);
 		log_info << "=== Started CrashHandler ===" << std::endl;
-		Util::setCachePath(w_cache_path);
+		app_cache_path = w_cache_path;
 	}
 	if (nArgs >= 6) {
 		ipc_path = szArglist[5];
 		log_info << "ipc path option recieve : " << converter.to_bytes(ipc_path) << std::endl;
 		Socket::set_ipc_path(ipc_path);
 	}
+	if (nArgs >= 7) {
+		std::vector<std::string> options;
+		for (int i = 6; i < nArgs; i++)
+			options.push_back(converter.to_bytes(szArglist[i]));
+		Options::get().parse(options);
+	}
 #else // for __APPLE__ and other
 	static thread_local std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
 	// Frontend passes as non-unicode
@@ -82,26 +141,105 @@ int main(int argc, char **argv)
 		isDevEnv = converter.from_bytes(argv[3]);
 	if (argc >= 5) {
 		std::wstring cache_path = converter.from_bytes(argv[4]);
-		std::wstring log_path = cache_path + log_file_name;
+		const std::string core_suffix = core_pipe_log_suffix(argc, argv);
+		std::wstring log_path = cache_path + log_file_name + converter.from_bytes(core_suffix);
+		if (!core_suffix.empty() && !core_pipe_taken(argc, argv, cache_path, log_path))
+			return 0;
 		std::cout << "Path for logging = " << std::string(log_path.begin(), log_path.end()) << std::endl;
 		logging_start(log_path);
 		log_info << "=== Started CrashHandler ===" << std::endl;
-		Util::setCachePath(cache_path);
+		app_cache_path = cache_path;
 	}
 	if (argc >= 6) {
 		ipc_path = converter.from_bytes(argv[5]);
 		log_info << "ipc path option recieve : " << std::string(ipc_path.begin(), ipc_path.end()) << std::endl;
 		Socket::set_ipc_path(ipc_path);
 	}
+	if (argc >= 7)
+		Options::get().parse(std::vector<std::string>(argv + 6, argv + argc));
 
 #endif
-	ProcessManager *pm = new ProcessManager();
-	pm->runWatcher();
+	if (Options::get().binaryLog)
+		logging_use_binary();
+
+	if (Options::get().corePipe) {
+		// Started by the kernel for a crashed process, the core is streamed on stdin
+		CoreCrash crash;
+		crash.pid = static_cast<int32_t>(Options::get().corePid);
+		crash.tid = static_cast<int32_t>(Options::get().coreTid);
+		crash.signal = static_cast<int32_t>(Options::get().coreSignal);
+		std::wstring minidump;
+		if (core_ingest(0, crash, app_cache_path, minidump) && !ipc_path.empty()) {
+			// A running crash handler monitoring the process learns of the crash before its exit is noticed
+			std::vector<char> buffer;
+			buffer.push_back(static_cast<char>(Action::CRASHWITHCODE));
+			const uint32_t pid = static_cast<uint32_t>(crash.pid);
+			const uint32_t code = static_cast<uint32_t>(crash.signal);
+			buffer.insert(buffer.end(), reinterpret_cast<const char *>(&pid), reinterpret_cast<const char *>(&pid) + sizeof(pid));
+			buffer.insert(buffer.end(), reinterpret_cast<const char *>(&code), reinterpret_cast<const char *>(&code) + sizeof(code));
+			buffer.insert(buffer.end(), reinterpret_cast<const char *>(&crash.address), reinterpret_cast<const char *>(&crash.address) + sizeof(crash.address));
+			Socket::forward(buffer);
+		}
+		log_info << "=== Terminating CrashHandler ===" << std::endl;
+		logging_end();
+		return 0;
+	}
+
+	// Catalogs are only needed by dialogs, the socket is served before they are loaded
+	std::thread translations(&Util::loadTranslations);
+
+	if (Options::get().trace) {
+		Tracer::getInstance()->enable();
+		Tracer::getInstance()->setThreadName("main");
+	}
+
+	std::unique_ptr<MetricsEndpoint> metrics;
+	if (!Options::get().metricsSocket.empty())
+		metrics = MetricsEndpoint::start(Options::get().metricsSocket);
+
+	const std::string &session = Options::get().session;
+	if (!session.empty()) {
+		// A handler already serving another instance of the application takes this one as a new session
+		if (SessionManager::forwardSession(session, app_cache_path, path)) {
+			log_info << "Session " << session << " handed to the running crash handler" << std::endl;
+		} else {
+			take_over_log();
+			SessionManager sessions;
+			if (sessions.openSession(session, app_cache_path, path))
+				sessions.run();
+		}
+	} else {
+		std::string pid_path(Util::get_temp_directory());
+		pid_path.append("crash-handler.pid");
 
-	if (pm->m_applicationCrashed)
-		pm->handleCrash(path);
+		// A running instance hands its processes over where it can and keeps serving otherwise, Windows kills it instead
+		std::vector<char> handedOver;
+		std::unique_ptr<InstanceGuard> guard = InstanceGuard::create(pid_path);
+		if (!guard) {
+			Util::check_pid_file(pid_path);
+			Util::write_pid_file(pid_path);
+		} else if (!guard->acquire(handedOver)) {
+			log_info << "Running without the single instance guard" << std::endl;
+		}
+		take_over_log();
 
-	delete pm;
+		ProcessManager *pm = new ProcessManager(app_cache_path);
+		if (guard)
+			guard->serve([pm](std::vector<char> &state) { return pm->handOver(state); });
+		pm->adoptProcesses(handedOver);
+		pm->runWatcher();
+		guard.reset();
+
+		if (pm->m_applicationCrashed)
+			pm->handleCrash(path);
+
+		delete pm;
+	}
+	if (translations.joinable())
+		translations.join();
+	metrics.reset();
+	if (Options::get().metricsLog)
+		log_info << "Metrics on exit:\n" << Metrics::getInstance()->render() << std::endl;
 	log_info << "=== Terminating CrashHandler ===" << std::endl;
 	logging_end();
 	return 0;
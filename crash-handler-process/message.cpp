@@ -18,6 +18,8 @@
 
 #include "message.hpp"
 
+#include <cstring>
+
 Message::Message(std::vector<char> buffer)
 {
 	m_buffer = buffer;
@@ -77,4 +79,14 @@ std::wstring Message::readWstring()
 std::string Message::readString()
 {
 	return readStringImpl<std::string>(m_buffer, this->index);
-}
\ No newline at end of file
+}
+
+std::vector<char> Message::readRemaining()
+{
+	if (this->index >= m_buffer.size())
+		return std::vector<char>();
+
+	std::vector<char> value(m_buffer.begin() + this->index, m_buffer.end());
+	this->index = m_buffer.size();
+	return value;
+}
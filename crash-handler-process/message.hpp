@@ -28,6 +28,11 @@ enum class Action : uint8_t {
 	REGISTERMEMORYDUMP = 2,
 	CRASHWITHCODE = 3,
 	CRASHED_MODULE_INFO = 4,
+	REGISTERHEARTBEAT = 5,
+	OPENSESSION = 6,
+	SESSIONMESSAGE = 7,
+	REGISTERCONNECTION = 8,
+	REGISTERCRASHCONTEXT = 9,
 };
 
 class Message {
@@ -46,6 +51,8 @@ public:
 	uint8_t readUInt8();
 	std::wstring readWstring();
 	std::string readString();
+	// Bytes left after what was read, the wrapped message of a session envelope
+	std::vector<char> readRemaining();
 };
 
 #endif
\ No newline at end of file
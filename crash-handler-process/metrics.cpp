@@ -0,0 +1,248 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "metrics.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#if !defined(WIN32)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+void MetricHistogram::record(uint64_t value)
+{
+	buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+	total.fetch_add(1, std::memory_order_relaxed);
+	valueSum.fetch_add(value, std::memory_order_relaxed);
+}
+
+size_t MetricHistogram::bucketOf(uint64_t value)
+{
+	if (value < METRIC_HISTOGRAM_SUB_BUCKETS)
+		return static_cast<size_t>(value);
+
+	const int exponent = std::bit_width(value) - 1;
+	const size_t sub = static_cast<size_t>(value >> (exponent - METRIC_HISTOGRAM_SUB_BITS)) & (METRIC_HISTOGRAM_SUB_BUCKETS - 1);
+	const size_t bucket = (exponent - METRIC_HISTOGRAM_SUB_BITS + 1) * METRIC_HISTOGRAM_SUB_BUCKETS + sub;
+	return std::min<size_t>(bucket, METRIC_HISTOGRAM_BUCKETS - 1);
+}
+
+uint64_t MetricHistogram::upperBound(size_t bucket)
+{
+	if (bucket < METRIC_HISTOGRAM_SUB_BUCKETS)
+		return bucket;
+
+	const int shift = static_cast<int>(bucket / METRIC_HISTOGRAM_SUB_BUCKETS) - 1;
+	const uint64_t sub = bucket % METRIC_HISTOGRAM_SUB_BUCKETS;
+	return ((METRIC_HISTOGRAM_SUB_BUCKETS + sub) << shift) + (uint64_t(1) << shift) - 1;
+}
+
+Metrics *Metrics::getInstance()
+{
+	static Metrics instance;
+	return &instance;
+}
+
+Metrics::Metric &Metrics::find(Kind kind, const std::string &name, const std::string &help, double unit)
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	for (auto &metric : metrics) {
+		if (metric->name == name)
+			return *metric;
+	}
+
+	metrics.push_back(std::make_unique<Metric>());
+	Metric &metric = *metrics.back();
+	metric.kind = kind;
+	metric.name = name;
+	metric.help = help;
+	metric.unit = unit;
+	if (kind == Kind::Histogram)
+		metric.histogram = std::make_unique<MetricHistogram>();
+	return metric;
+}
+
+MetricCounter &Metrics::counter(const std::string &name, const std::string &help)
+{
+	return find(Kind::Counter, name, help, 1).counter;
+}
+
+MetricGauge &Metrics::gauge(const std::string &name, const std::string &help)
+{
+	return find(Kind::Gauge, name, help, 1).gauge;
+}
+
+MetricHistogram &Metrics::histogram(const std::string &name, const std::string &help, double unit)
+{
+	Metric &metric = find(Kind::Histogram, name, help, unit);
+	if (!metric.histogram)
+		metric.histogram = std::make_unique<MetricHistogram>();
+	return *metric.histogram;
+}
+
+std::string Metrics::render()
+{
+	std::ostringstream text;
+	text.precision(12);
+
+	const std::lock_guard<std::mutex> lock(mtx);
+	for (auto &metric : metrics) {
+		text << "# HELP " << metric->name << " " << metric->help << "\n";
+		switch (metric->kind) {
+		case Kind::Counter:
+			text << "# TYPE " << metric->name << " counter\n" << metric->name << " " << metric->counter.get() << "\n";
+			break;
+		case Kind::Gauge:
+			text << "# TYPE " << metric->name << " gauge\n" << metric->name << " " << metric->gauge.get() << "\n";
+			break;
+		case Kind::Histogram: {
+			const MetricHistogram &histogram = *metric->histogram;
+			text << "# TYPE " << metric->name << " histogram\n";
+
+			// Every bucket is listed so the set of series stays the same from one scrape to the next
+			uint64_t cumulative = 0;
+			for (size_t i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+				cumulative += histogram.bucketCount(i);
+				text << metric->name << "_bucket{le=\"" << MetricHistogram::upperBound(i) * metric->unit << "\"} " << cumulative << "\n";
+			}
+			text << metric->name << "_bucket{le=\"+Inf\"} " << histogram.count() << "\n";
+			text << metric->name << "_sum " << histogram.sum() * metric->unit << "\n";
+			text << metric->name << "_count " << histogram.count() << "\n";
+			break;
+		}
+		}
+	}
+	return text.str();
+}
+
+#if defined(WIN32)
+
+MetricsEndpoint::~MetricsEndpoint() {}
+
+std::unique_ptr<MetricsEndpoint> MetricsEndpoint::start(const std::string &path)
+{
+	log_info << "Metrics endpoint is not available on this platform" << std::endl;
+	return nullptr;
+}
+
+void MetricsEndpoint::worker_fnc() {}
+
+void MetricsEndpoint::serve(int client) {}
+
+#else // for __APPLE__ and other
+
+#if defined(__APPLE__)
+// SO_NOSIGPIPE is set on the client instead
+#define SOCK_CLOEXEC 0
+#define MSG_NOSIGNAL 0
+#define accept4(fd, addr, len, flags) accept(fd, addr, len)
+#endif
+
+MetricsEndpoint::~MetricsEndpoint()
+{
+	stopping = true;
+	if (worker) {
+		if (worker->joinable())
+			worker->join();
+		delete worker;
+	}
+	if (listener >= 0) {
+		close(listener);
+		unlink(path.c_str());
+	}
+}
+
+std::unique_ptr<MetricsEndpoint> MetricsEndpoint::start(const std::string &path)
+{
+	sockaddr_un addr = {};
+	if (path.size() >= sizeof(addr.sun_path)) {
+		log_error << "Metrics socket path is too long " << path << std::endl;
+		return nullptr;
+	}
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	std::unique_ptr<MetricsEndpoint> endpoint(new MetricsEndpoint());
+	endpoint->path = path;
+	endpoint->listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (endpoint->listener < 0)
+		return nullptr;
+
+	// A socket left by a handler that was killed is replaced
+	unlink(path.c_str());
+	if (bind(endpoint->listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(endpoint->listener, 4) < 0) {
+		log_error << "Could not create the metrics socket " << path << ": " << strerror(errno) << std::endl;
+		return nullptr;
+	}
+
+	endpoint->worker = new std::thread(&MetricsEndpoint::worker_fnc, endpoint.get());
+	log_info << "Metrics served on " << path << std::endl;
+	return endpoint;
+}
+
+void MetricsEndpoint::worker_fnc()
+{
+	while (!stopping) {
+		pollfd pending = {listener, POLLIN, 0};
+		if (poll(&pending, 1, 500) <= 0)
+			continue;
+
+		int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+		if (client < 0)
+			continue;
+		serve(client);
+		close(client);
+	}
+}
+
+void MetricsEndpoint::serve(int client)
+{
+	// Plain readers send nothing, the request of an HTTP client arrives right after connecting
+#if defined(__APPLE__)
+	int one = 1;
+	setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+	char request[1024];
+	ssize_t received = 0;
+	pollfd readable = {client, POLLIN, 0};
+	if (poll(&readable, 1, 100) > 0)
+		received = recv(client, request, sizeof(request), 0);
+
+	std::string response = Metrics::getInstance()->render();
+	if (received >= 4 && memcmp(request, "GET ", 4) == 0) {
+		response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(response.size()) +
+			   "\r\nConnection: close\r\n\r\n" + response;
+	}
+
+	size_t sent = 0;
+	while (sent < response.size()) {
+		ssize_t written = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+		if (written <= 0)
+			break;
+		sent += static_cast<size_t>(written);
+	}
+}
+
+#endif
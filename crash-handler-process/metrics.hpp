@@ -0,0 +1,150 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// In-process metrics, rendered in the Prometheus text format. Updates are
+// relaxed atomics so instrumented paths never take a lock; only registering
+// a metric and rendering them do. Call sites keep a function-local static
+// reference to their metric:
+//   static MetricCounter &crashes = Metrics::getInstance()->counter("crash_handler_crashes_total", "...");
+
+// Each power of two is split in this many buckets, bounding the relative error of a bucket to 25%
+#define METRIC_HISTOGRAM_SUB_BITS 2
+#define METRIC_HISTOGRAM_SUB_BUCKETS (1 << METRIC_HISTOGRAM_SUB_BITS)
+// Values up to 2^40 get their own bucket, about 12 days in microseconds or 1 TB in bytes
+#define METRIC_HISTOGRAM_MAX_BITS 40
+#define METRIC_HISTOGRAM_BUCKETS ((METRIC_HISTOGRAM_MAX_BITS - METRIC_HISTOGRAM_SUB_BITS + 1) * METRIC_HISTOGRAM_SUB_BUCKETS)
+
+class MetricCounter {
+public:
+	void add(uint64_t count = 1) { value.fetch_add(count, std::memory_order_relaxed); }
+	uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> value{0};
+};
+
+class MetricGauge {
+public:
+	void set(int64_t level) { value.store(level, std::memory_order_relaxed); }
+	void add(int64_t delta) { value.fetch_add(delta, std::memory_order_relaxed); }
+	int64_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<int64_t> value{0};
+};
+
+// Log-linear buckets in the manner of HdrHistogram, recorded without locking
+class MetricHistogram {
+public:
+	void record(uint64_t value);
+
+	static size_t bucketOf(uint64_t value);
+	// Largest value falling in the bucket
+	static uint64_t upperBound(size_t bucket);
+
+	uint64_t bucketCount(size_t bucket) const { return buckets[bucket].load(std::memory_order_relaxed); }
+	uint64_t count() const { return total.load(std::memory_order_relaxed); }
+	uint64_t sum() const { return valueSum.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> buckets[METRIC_HISTOGRAM_BUCKETS] = {};
+	std::atomic<uint64_t> total{0};
+	std::atomic<uint64_t> valueSum{0};
+};
+
+// Records the microseconds elapsed in its scope
+class MetricTimer {
+public:
+	MetricTimer(MetricHistogram &histogram) : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+	~MetricTimer()
+	{
+		histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+
+private:
+	MetricHistogram &histogram;
+	std::chrono::steady_clock::time_point start;
+};
+
+class Metrics {
+public:
+	static Metrics *getInstance();
+
+	// Names follow the Prometheus conventions; registering a name twice returns the first metric
+	MetricCounter &counter(const std::string &name, const std::string &help);
+	MetricGauge &gauge(const std::string &name, const std::string &help);
+	// Values are multiplied by unit when rendered, 1e-6 for durations recorded by MetricTimer into a _seconds histogram
+	MetricHistogram &histogram(const std::string &name, const std::string &help, double unit = 1);
+
+	std::string render();
+
+private:
+	Metrics() = default;
+
+	enum class Kind { Counter, Gauge, Histogram };
+	struct Metric {
+		Kind kind;
+		std::string name;
+		std::string help;
+		double unit = 1;
+		MetricCounter counter;
+		MetricGauge gauge;
+		std::unique_ptr<MetricHistogram> histogram;
+	};
+
+	std::mutex mtx;
+	std::vector<std::unique_ptr<Metric>> metrics;
+
+	Metric &find(Kind kind, const std::string &name, const std::string &help, double unit);
+};
+
+// Serves the rendered metrics to every client connecting to a local socket.
+// A client sending an HTTP request gets an HTTP response, so both
+// "curl --unix-socket <path> http://localhost/metrics" and a plain read of the socket work.
+class MetricsEndpoint {
+public:
+	~MetricsEndpoint();
+
+	// Returns nullptr when the socket can not be created or on platforms without local sockets
+	static std::unique_ptr<MetricsEndpoint> start(const std::string &path);
+
+private:
+	MetricsEndpoint() = default;
+
+	std::string path;
+	int listener = -1;
+	std::atomic<bool> stopping{false};
+	std::thread *worker = nullptr;
+
+	void worker_fnc();
+	void serve(int client);
+};
+
+#endif
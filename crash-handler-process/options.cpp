@@ -0,0 +1,87 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "options.hpp"
+#include "logger.hpp"
+
+#include <unordered_map>
+
+Options &Options::get()
+{
+	static Options instance;
+	return instance;
+}
+
+void Options::parse(const std::vector<std::string> &args)
+{
+	for (const std::string &arg : args) {
+		if (arg.rfind("--", 0) != 0)
+			continue;
+
+		const size_t separator = arg.find('=');
+		const std::string name = arg.substr(2, separator == std::string::npos ? std::string::npos : separator - 2);
+		const std::string value = separator == std::string::npos ? "" : arg.substr(separator + 1);
+
+		const std::unordered_map<std::string, uint32_t *> numbers = {
+			{"terminate-deadline-ms", &terminateDeadlineMs}, {"liveness-period-ms", &livenessPeriodMs},
+			{"responsiveness-period-ms", &responsivenessPeriodMs}, {"telemetry-period-ms", &telemetryPeriodMs},
+			{"validation-delay-ms", &validationDelayMs}, {"flight-recorder-kb", &flightRecorderKb},
+			{"log-max-kb", &logMaxKb}, {"log-max-age-min", &logMaxAgeMin}, {"log-generations", &logGenerations},
+			{"app-state-debounce-ms", &appStateDebounceMs}, {"core-pid", &corePid}, {"core-tid", &coreTid},
+			{"core-signal", &coreSignal}, {"core-uid", &coreUid}, {"core-gid", &coreGid},
+			{"hang-snapshot-interval-s", &hangSnapshotIntervalS}, {"hang-profile-ms", &hangProfileMs},
+			{"hang-profile-period-ms", &hangProfilePeriodMs}, {"thread-activity-period-ms", &threadActivityPeriodMs},
+		};
+		auto number = numbers.find(name);
+
+		if (name == "discover-children") {
+			discoverChildren = true;
+		} else if (name == "binary-log") {
+			binaryLog = true;
+		} else if (name == "session" && !value.empty()) {
+			session = value;
+		} else if (name == "metrics-socket" && !value.empty()) {
+			metricsSocket = value;
+		} else if (name == "freeze-cgroup" && !value.empty()) {
+			freezeCgroup = value;
+		} else if (name == "metrics-log") {
+			metricsLog = true;
+		} else if (name == "trace") {
+			trace = true;
+		} else if (name == "intercept-crashes") {
+			interceptCrashes = true;
+		} else if (name == "hang-snapshots") {
+			hangSnapshots = true;
+		} else if (name == "thread-activity") {
+			threadActivity = true;
+		} else if (name == "core-pipe") {
+			corePipe = true;
+		} else if (number != numbers.end() && !value.empty()) {
+			try {
+				*number->second = static_cast<uint32_t>(std::stoul(value));
+			} catch (...) {
+				log_info << "Invalid value for option " << arg << std::endl;
+				continue;
+			}
+		} else {
+			log_info << "Unknown option " << arg << std::endl;
+			continue;
+		}
+		log_info << "Option " << name << (value.empty() ? "" : " = " + value) << std::endl;
+	}
+}
@@ -0,0 +1,81 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Optional switches passed after the positional arguments as --name or --name=value
+class Options {
+public:
+	static Options &get();
+
+	void parse(const std::vector<std::string> &args);
+
+	bool discoverChildren = false;
+	bool binaryLog = false;
+	// Set when several application instances share one crash handler, each as a named session
+	std::string session;
+	// Local socket serving the metrics in the Prometheus text format, none when empty
+	std::string metricsSocket;
+	// Whether the metrics are written to the log on exit
+	bool metricsLog = false;
+	// Records spans of crash handling, written as <log>.trace.json after a crash
+	bool trace = false;
+	// Traces critical processes on Linux to capture their state when a fatal signal is delivered
+	bool interceptCrashes = false;
+	// Delegated cgroup v2 directory where registered processes are grouped, to be frozen together on a critical crash
+	std::string freezeCgroup;
+	// Writes the registers and stacks of a process found unresponsive, at most once per interval for each process
+	bool hangSnapshots = false;
+	uint32_t hangSnapshotIntervalS = 600;
+	// Stack sampling of a process after its hang snapshot, none when the duration is 0
+	uint32_t hangProfileMs = 2000;
+	uint32_t hangProfilePeriodMs = 10;
+	// Classifies the threads of registered processes from their kernel statistics, named in hang reports
+	bool threadActivity = false;
+	uint32_t threadActivityPeriodMs = 1000;
+	// Run by the kernel as the core_pattern pipe: converts the core on stdin to a minidump and exits
+	bool corePipe = false;
+	uint32_t corePid = 0;
+	uint32_t coreTid = 0;
+	uint32_t coreSignal = 0;
+	// Owner of the crashed process, from %u and %g, unknown when -1
+	uint32_t coreUid = static_cast<uint32_t>(-1);
+	uint32_t coreGid = static_cast<uint32_t>(-1);
+	uint32_t terminateDeadlineMs = 3000;
+	// Size of the mapped ring mirroring the log, 0 when not used
+	uint32_t flightRecorderKb = 0;
+	// Log rotation, a log older than logMaxAgeMin is rotated too unless it is 0
+	uint32_t logMaxKb = 1024;
+	uint32_t logMaxAgeMin = 0;
+	uint32_t logGenerations = 3;
+
+	// Monitoring cadences, each check is scheduled on its own
+	uint32_t livenessPeriodMs = 50;
+	uint32_t responsivenessPeriodMs = 5000;
+	uint32_t telemetryPeriodMs = 1000;
+	uint32_t validationDelayMs = 7000;
+	// App state changes reverted within this delay are not written
+	uint32_t appStateDebounceMs = 1000;
+};
+
+#endif
@@ -0,0 +1,300 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../connection-watcher.hpp"
+#include "../message.hpp"
+#include "../logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+// Files of a dying process are closed before it can be waited for, its pidfd becomes readable shortly after the hangup
+#define CONNECTION_EXIT_WAIT_MS 200
+
+class ConnectionWatcher_LINUX : public ConnectionWatcher {
+public:
+	ConnectionWatcher_LINUX(close_callback on_close);
+	virtual ~ConnectionWatcher_LINUX();
+
+	virtual int32_t watch(int connection, int pidfd) override;
+
+private:
+	struct Connection {
+		int32_t pid = 0;
+		int fd = -1;
+		int pidfd = -1;
+		bool unregistered = false;
+	};
+	// A lost connection whose pidfd is watched until the process is gone or the wait is over
+	struct Exiting {
+		Connection connection;
+		std::chrono::steady_clock::time_point deadline;
+	};
+
+	close_callback on_close;
+	int epoll_fd = -1;
+	int wake_fd[2] = {-1, -1};
+	std::atomic<bool> stopping{false};
+	std::thread *worker = nullptr;
+	std::mutex mtx;
+	std::unordered_map<int, Connection> connections;
+	// By pidfd, only used by the worker
+	std::unordered_map<int, Exiting> exiting;
+
+	static int pidfdOpen(int32_t pid) { return static_cast<int>(syscall(SYS_pidfd_open, pid, 0)); }
+	static int32_t pidfdPid(int pidfd);
+	void worker_fnc();
+	void closed(int fd);
+	void finish(const Connection &entry, Close reason);
+	int exitWaitTimeout() const;
+	void expireExiting();
+};
+
+std::unique_ptr<ConnectionWatcher> ConnectionWatcher::create(close_callback on_close)
+{
+	return std::make_unique<ConnectionWatcher_LINUX>(on_close);
+}
+
+ConnectionWatcher_LINUX::ConnectionWatcher_LINUX(close_callback on_close) : on_close(on_close)
+{
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0 || pipe2(wake_fd, O_CLOEXEC) != 0) {
+		log_error << "Failed to create the connection watcher " << strerror(errno) << std::endl;
+		return;
+	}
+
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = wake_fd[0];
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd[0], &event);
+	worker = new std::thread(&ConnectionWatcher_LINUX::worker_fnc, this);
+}
+
+ConnectionWatcher_LINUX::~ConnectionWatcher_LINUX()
+{
+	stopping = true;
+	if (wake_fd[1] >= 0) {
+		const char wake = 0;
+		if (::write(wake_fd[1], &wake, 1) < 0)
+			log_info << "Failed to wake the connection watcher" << std::endl;
+	}
+	if (worker) {
+		if (worker->joinable())
+			worker->join();
+		delete worker;
+	}
+
+	for (auto &entry : connections) {
+		close(entry.second.fd);
+		if (entry.second.pidfd >= 0)
+			close(entry.second.pidfd);
+	}
+	for (auto &entry : exiting)
+		close(entry.first);
+	for (int fd : wake_fd) {
+		if (fd >= 0)
+			close(fd);
+	}
+	if (epoll_fd >= 0)
+		close(epoll_fd);
+}
+
+int32_t ConnectionWatcher_LINUX::pidfdPid(int pidfd)
+{
+	std::ifstream info("/proc/self/fdinfo/" + std::to_string(pidfd));
+	std::string line;
+	while (std::getline(info, line)) {
+		if (line.rfind("Pid:", 0) == 0)
+			return static_cast<int32_t>(atoi(line.c_str() + 4));
+	}
+	return 0;
+}
+
+int32_t ConnectionWatcher_LINUX::watch(int connection, int pidfd)
+{
+	ucred credentials = {};
+	socklen_t length = sizeof(credentials);
+	if (!worker || getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0 || credentials.pid <= 0) {
+		close(connection);
+		if (pidfd >= 0)
+			close(pidfd);
+		return 0;
+	}
+
+	// A pidfd passed by the process pins the process that connected, even if its pid is reused later
+	if (pidfd >= 0 && pidfdPid(pidfd) != credentials.pid) {
+		log_info << "Passed pidfd does not belong to pid " << credentials.pid << ", ignored" << std::endl;
+		close(pidfd);
+		pidfd = -1;
+	}
+	// The process is connected, so alive, the pid can not have been reused yet
+	if (pidfd < 0)
+		pidfd = pidfdOpen(credentials.pid);
+
+	Connection entry;
+	entry.pid = credentials.pid;
+	entry.fd = connection;
+	entry.pidfd = pidfd;
+	{
+		const std::lock_guard<std::mutex> lock(mtx);
+		connections[connection] = entry;
+	}
+
+	epoll_event event = {};
+	event.events = EPOLLIN | EPOLLRDHUP;
+	event.data.fd = connection;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection, &event) != 0) {
+		const std::lock_guard<std::mutex> lock(mtx);
+		connections.erase(connection);
+		close(connection);
+		if (pidfd >= 0)
+			close(pidfd);
+		return 0;
+	}
+	return credentials.pid;
+}
+
+void ConnectionWatcher_LINUX::worker_fnc()
+{
+	epoll_event events[16];
+	while (!stopping) {
+		int count = epoll_wait(epoll_fd, events, 16, exitWaitTimeout());
+		if (count < 0 && errno != EINTR)
+			break;
+
+		for (int i = 0; i < count && !stopping; i++) {
+			const int fd = events[i].data.fd;
+			if (fd == wake_fd[0])
+				continue;
+
+			auto pending = exiting.find(fd);
+			if (pending != exiting.end()) {
+				// The pidfd became readable, the process is gone
+				const Connection entry = pending->second.connection;
+				exiting.erase(pending);
+				finish(entry, Close::Exited);
+				continue;
+			}
+
+			bool hangup = events[i].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR);
+			if (events[i].events & EPOLLIN) {
+				// The only message expected on a kept connection is an orderly UNREGISTER
+				char buffer[64];
+				ssize_t received = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+				if (received == 0) {
+					hangup = true;
+				} else if (received > 0 && static_cast<Action>(buffer[0]) == Action::UNREGISTER) {
+					const std::lock_guard<std::mutex> lock(mtx);
+					auto it = connections.find(fd);
+					if (it != connections.end())
+						it->second.unregistered = true;
+					hangup = true;
+				}
+			}
+			if (hangup)
+				closed(fd);
+		}
+		expireExiting();
+	}
+}
+
+void ConnectionWatcher_LINUX::closed(int fd)
+{
+	Connection entry;
+	{
+		const std::lock_guard<std::mutex> lock(mtx);
+		auto it = connections.find(fd);
+		if (it == connections.end())
+			return;
+		entry = it->second;
+		connections.erase(it);
+	}
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+	close(fd);
+
+	if (entry.unregistered) {
+		finish(entry, Close::Unregistered);
+		return;
+	}
+	// Without a pidfd a lost connection can only be taken as a death
+	if (entry.pidfd < 0) {
+		finish(entry, Close::Exited);
+		return;
+	}
+
+	// The pidfd joins the epoll set instead of being waited for here, other connections are served meanwhile
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = entry.pidfd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, entry.pidfd, &event) != 0) {
+		pollfd exited = {entry.pidfd, POLLIN, 0};
+		finish(entry, poll(&exited, 1, 0) == 0 ? Close::Detached : Close::Exited);
+		return;
+	}
+	exiting[entry.pidfd] = {entry, std::chrono::steady_clock::now() + std::chrono::milliseconds(CONNECTION_EXIT_WAIT_MS)};
+}
+
+void ConnectionWatcher_LINUX::finish(const Connection &entry, Close reason)
+{
+	if (entry.pidfd >= 0) {
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, entry.pidfd, nullptr);
+		close(entry.pidfd);
+	}
+	on_close(entry.pid, reason);
+}
+
+int ConnectionWatcher_LINUX::exitWaitTimeout() const
+{
+	if (exiting.empty())
+		return -1;
+
+	auto deadline = exiting.begin()->second.deadline;
+	for (auto &entry : exiting)
+		deadline = std::min(deadline, entry.second.deadline);
+	const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+	return static_cast<int>(std::max<int64_t>(left.count(), 0));
+}
+
+void ConnectionWatcher_LINUX::expireExiting()
+{
+	// Still running once the wait is over, the process only closed its connection
+	const auto now = std::chrono::steady_clock::now();
+	for (auto it = exiting.begin(); it != exiting.end();) {
+		if (it->second.deadline > now) {
+			++it;
+			continue;
+		}
+		const Connection entry = it->second.connection;
+		it = exiting.erase(it);
+		finish(entry, Close::Detached);
+	}
+}
@@ -0,0 +1,388 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../core-ingest.hpp"
+#include "../logger.hpp"
+#include "minidump-linux.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/procfs.h>
+#include <sys/stat.h>
+#include <sys/user.h>
+#if defined(HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+// Kept of each thread stack, from a red zone below the stack pointer up
+#define CORE_STACK_BYTES (64 * 1024)
+#define CORE_RED_ZONE_BYTES 128
+// The first page of a module holds its ELF and program headers, with the build id note
+#define CORE_MODULE_HEADER_BYTES 4096
+#define CORE_MAX_NOTES_BYTES (16 * 1024 * 1024)
+
+#if defined(__x86_64__)
+static_assert(sizeof(elf_gregset_t) == sizeof(user_regs_struct), "prstatus registers are laid out as user_regs_struct");
+
+namespace {
+
+// A range of a PT_LOAD segment to copy out of the core
+struct CoreRead {
+	uint64_t offset;
+	size_t size;
+	std::vector<uint8_t> *into;
+};
+
+// The core is read once, in order, as the kernel writes it into the pipe
+class CoreStream {
+public:
+	CoreStream(int input) : input(input) {}
+
+	uint64_t position() const { return offset; }
+
+	bool read(void *buffer, size_t size)
+	{
+		char *out = static_cast<char *>(buffer);
+		while (size > 0) {
+			const ssize_t count = ::read(input, out, size);
+			if (count < 0 && errno == EINTR)
+				continue;
+			if (count <= 0)
+				return false;
+			out += count;
+			size -= count;
+			offset += count;
+		}
+		return true;
+	}
+
+	bool skipTo(uint64_t target)
+	{
+		char discard[64 * 1024];
+		while (offset < target) {
+			if (!read(discard, static_cast<size_t>(std::min<uint64_t>(sizeof(discard), target - offset))))
+				return false;
+		}
+		return offset == target;
+	}
+
+private:
+	int input;
+	uint64_t offset = 0;
+};
+
+// NT_FILE lists every file mapping, a module starts at the mapping of its offset 0
+void parseFiles(const uint8_t *data, size_t size, std::vector<MinidumpModule> &modules)
+{
+	uint64_t count = 0;
+	if (size < 16)
+		return;
+	memcpy(&count, data, sizeof(count));
+	if (count > (size - 16) / 24)
+		return;
+
+	const char *name = reinterpret_cast<const char *>(data + 16 + count * 24);
+	const char *end = reinterpret_cast<const char *>(data + size);
+	std::unordered_map<std::string, size_t> byPath;
+	for (uint64_t i = 0; i < count && name < end; i++) {
+		uint64_t entry[3];
+		memcpy(entry, data + 16 + i * 24, sizeof(entry));
+		const std::string path(name, strnlen(name, end - name));
+		name += path.size() + 1;
+
+		auto it = byPath.find(path);
+		if (it != byPath.end()) {
+			modules[it->second].end = std::max(modules[it->second].end, entry[1]);
+		} else if (entry[2] == 0) {
+			byPath[path] = modules.size();
+			modules.push_back({entry[0], entry[1], path, {}});
+		}
+	}
+}
+
+void parseNotes(const std::vector<uint8_t> &notes, std::vector<MinidumpThread> &threads, std::vector<MinidumpModule> &modules, siginfo_t &info, bool &hasInfo)
+{
+	elf_for_each_note(notes.data(), notes.size(), [&](std::string_view name, uint32_t type, const uint8_t *desc, size_t size) {
+		if (name != "CORE")
+			return;
+
+		if (type == NT_PRSTATUS && size >= sizeof(elf_prstatus)) {
+			elf_prstatus status;
+			memcpy(&status, desc, sizeof(status));
+			MinidumpThread thread;
+			thread.tid = status.pr_pid;
+			memcpy(&thread.regs, status.pr_reg, sizeof(thread.regs));
+			threads.push_back(thread);
+		} else if (type == NT_FPREGSET && size >= sizeof(user_fpregs_struct) && !threads.empty()) {
+			// Floating point registers follow the prstatus of their thread
+			memcpy(&threads.back().floats, desc, sizeof(user_fpregs_struct));
+			threads.back().hasFloats = true;
+		} else if (type == NT_SIGINFO && size >= sizeof(siginfo_t)) {
+			memcpy(&info, desc, sizeof(info));
+			hasInfo = true;
+		} else if (type == NT_FILE) {
+			parseFiles(desc, size, modules);
+		}
+	});
+}
+
+// Picks the part of the segment holding address the range is to be read from
+void planRead(const std::vector<Elf64_Phdr> &loads, uint64_t address, uint64_t below, uint64_t above, std::vector<uint8_t> &into, uint64_t &start, std::vector<CoreRead> &reads)
+{
+	for (const Elf64_Phdr &load : loads) {
+		if (address < load.p_vaddr || address >= load.p_vaddr + load.p_filesz)
+			continue;
+
+		start = address - std::min(below, address - load.p_vaddr);
+		const uint64_t end = std::min(address + above, load.p_vaddr + load.p_filesz);
+		reads.push_back({load.p_offset + (start - load.p_vaddr), static_cast<size_t>(end - start), &into});
+		return;
+	}
+}
+
+std::vector<uint8_t> buildMinidump(int32_t pid, const std::vector<MinidumpThread> &threads, const std::vector<MinidumpModule> &modules, int32_t crashedTid,
+				   const siginfo_t &info, int32_t signal)
+{
+	const bool crashed = std::any_of(threads.begin(), threads.end(), [crashedTid](const MinidumpThread &t) { return t.tid == crashedTid; });
+	if (!crashed)
+		crashedTid = threads.front().tid;
+
+	std::string maps;
+	std::ifstream mapsFile("/proc/" + std::to_string(pid) + "/maps");
+	if (mapsFile.is_open())
+		maps.assign(std::istreambuf_iterator<char>(mapsFile), std::istreambuf_iterator<char>());
+
+	MinidumpWriter dump(maps.empty() ? 5 : 6);
+
+	const std::vector<uint32_t> contexts = minidump_add_threads(dump, threads);
+	uint32_t crashedContext = 0;
+	for (size_t i = 0; i < threads.size(); i++) {
+		if (threads[i].tid == crashedTid)
+			crashedContext = contexts[i];
+	}
+	minidump_add_modules(dump, modules);
+
+	uint32_t rva = dump.begin();
+	dump.put(static_cast<uint32_t>(crashedTid));
+	dump.put(static_cast<uint32_t>(0));
+	dump.put(static_cast<uint32_t>(signal));
+	dump.put(static_cast<uint32_t>(info.si_code));
+	dump.put(static_cast<uint64_t>(0));
+	dump.put(static_cast<uint64_t>(info.si_code > 0 ? reinterpret_cast<uintptr_t>(info.si_addr) : 0));
+	dump.zeros(8 + 15 * 8);
+	dump.put(static_cast<uint32_t>(MD_CONTEXT_AMD64_SIZE));
+	dump.put(crashedContext);
+	dump.addStream(MD_EXCEPTION_STREAM, rva);
+
+	minidump_add_system_info(dump);
+
+	// The process is still there while the kernel writes the core, its maps help the processor
+	if (!maps.empty()) {
+		rva = dump.appendBlob(maps.data(), maps.size());
+		dump.addStream(MD_LINUX_MAPS, rva);
+	}
+
+	dump.finish(static_cast<uint32_t>(time(nullptr)));
+	return dump.data();
+}
+
+bool writeMinidump(const std::vector<uint8_t> &minidump, const std::string &path)
+{
+	// Never through a link or into a file already there, the rename then replaces a link at path and not its target
+	const std::string temporary = path + ".tmp";
+	const int file = open(temporary.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+	if (file < 0)
+		return false;
+#if defined(HAVE_ZLIB)
+	gzFile output = gzdopen(file, "wb6");
+	if (output == NULL) {
+		close(file);
+		remove(temporary.c_str());
+		return false;
+	}
+	bool written = true;
+	for (size_t at = 0; at < minidump.size() && written; at += 1024 * 1024) {
+		const unsigned count = static_cast<unsigned>(std::min<size_t>(1024 * 1024, minidump.size() - at));
+		written = gzwrite(output, minidump.data() + at, count) == static_cast<int>(count);
+	}
+	written &= gzclose(output) == Z_OK;
+#else
+	bool written = true;
+	for (size_t at = 0; at < minidump.size() && written;) {
+		const ssize_t count = write(file, minidump.data() + at, minidump.size() - at);
+		written = count > 0;
+		at += written ? static_cast<size_t>(count) : 0;
+	}
+	written &= close(file) == 0;
+#endif
+	if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+		remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+} // namespace
+
+bool core_ingest(int input, CoreCrash &crash, const std::wstring &directory, std::wstring &written)
+{
+	const auto started = std::chrono::steady_clock::now();
+	CoreStream core(input);
+
+	Elf64_Ehdr ehdr;
+	if (!core.read(&ehdr, sizeof(ehdr)) || memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 || ehdr.e_ident[EI_CLASS] != ELFCLASS64 || ehdr.e_type != ET_CORE) {
+		log_error << "Core of process " << crash.pid << " is not a 64 bit ELF core" << std::endl;
+		return false;
+	}
+	if (ehdr.e_machine != EM_X86_64) {
+		log_error << "Core of process " << crash.pid << " is for machine " << ehdr.e_machine << ", only x86_64 is converted" << std::endl;
+		return false;
+	}
+	// With more than 0xffff segments the count is in a section header at the end of the core, out of reach of the pipe
+	if (ehdr.e_phnum == PN_XNUM || ehdr.e_phentsize != sizeof(Elf64_Phdr)) {
+		log_error << "Core of process " << crash.pid << " has too many segments to be streamed" << std::endl;
+		return false;
+	}
+
+	std::vector<Elf64_Phdr> headers(ehdr.e_phnum);
+	if (!core.skipTo(ehdr.e_phoff) || !core.read(headers.data(), headers.size() * sizeof(Elf64_Phdr))) {
+		log_error << "Core of process " << crash.pid << " ends before its program headers" << std::endl;
+		return false;
+	}
+
+	std::vector<Elf64_Phdr> loads;
+	std::vector<uint8_t> notes;
+	std::sort(headers.begin(), headers.end(), [](const Elf64_Phdr &a, const Elf64_Phdr &b) { return a.p_offset < b.p_offset; });
+	for (const Elf64_Phdr &header : headers) {
+		if (header.p_type == PT_LOAD && header.p_filesz > 0) {
+			loads.push_back(header);
+		} else if (header.p_type == PT_NOTE && notes.empty() && header.p_filesz <= CORE_MAX_NOTES_BYTES) {
+			notes.resize(header.p_filesz);
+			if (!core.skipTo(header.p_offset) || !core.read(notes.data(), notes.size())) {
+				log_error << "Core of process " << crash.pid << " ends in its notes" << std::endl;
+				return false;
+			}
+		}
+	}
+
+	std::vector<MinidumpThread> threads;
+	std::vector<MinidumpModule> modules;
+	siginfo_t info = {};
+	bool hasInfo = false;
+	parseNotes(notes, threads, modules, info, hasInfo);
+	if (threads.empty()) {
+		log_error << "Core of process " << crash.pid << " has no thread" << std::endl;
+		return false;
+	}
+
+	// Only the stacks and the module headers are copied, the rest of the memory is skipped
+	std::vector<CoreRead> reads;
+	for (MinidumpThread &thread : threads)
+		planRead(loads, thread.regs.rsp, CORE_RED_ZONE_BYTES, CORE_STACK_BYTES, thread.stack, thread.stackStart, reads);
+	for (MinidumpModule &module : modules) {
+		uint64_t start = 0;
+		planRead(loads, module.base, 0, CORE_MODULE_HEADER_BYTES, module.header, start, reads);
+	}
+	std::sort(reads.begin(), reads.end(), [](const CoreRead &a, const CoreRead &b) { return a.offset < b.offset; });
+	for (const CoreRead &read : reads) {
+		// Ranges overlapping an earlier one are already behind the stream
+		if (read.offset < core.position())
+			continue;
+		read.into->resize(read.size);
+		if (!core.skipTo(read.offset) || !core.read(read.into->data(), read.size)) {
+			log_error << "Core of process " << crash.pid << " ends before its memory, " << core.position() << " bytes read" << std::endl;
+			read.into->clear();
+			break;
+		}
+	}
+	const uint64_t consumed = core.position();
+
+	if (hasInfo) {
+		crash.signal = info.si_signo;
+		crash.address = info.si_code > 0 ? reinterpret_cast<uintptr_t>(info.si_addr) : 0;
+	}
+	if (!crash.tid)
+		crash.tid = threads.front().tid;
+	const std::vector<uint8_t> minidump = buildMinidump(crash.pid, threads, modules, crash.tid, info, crash.signal);
+
+	std::ostringstream name;
+	name << std::string(directory.begin(), directory.end()) << "/crash-" << crash.pid << "-" << time(nullptr) << ".dmp";
+#if defined(HAVE_ZLIB)
+	name << ".gz";
+#endif
+	if (!writeMinidump(minidump, name.str())) {
+		log_error << "Failed to write the minidump of process " << crash.pid << " to " << name.str() << std::endl;
+		return false;
+	}
+
+	const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+	log_info << "Core of process " << crash.pid << " signal " << crash.signal << " written as " << name.str() << ": " << threads.size() << " threads, "
+		 << modules.size() << " modules, " << minidump.size() << " bytes from " << consumed << " bytes of core read in " << elapsed.count() << " ms"
+		 << std::endl;
+	const std::string path = name.str();
+	written = std::wstring(path.begin(), path.end());
+	return true;
+}
+#else
+bool core_ingest(int input, CoreCrash &crash, const std::wstring &directory, std::wstring &written)
+{
+	log_error << "Core of process " << crash.pid << " is not converted, only x86_64 cores are supported" << std::endl;
+	return false;
+}
+#endif
+
+bool core_take_ownership(uint32_t uid, uint32_t gid, const std::wstring &directory, const std::wstring &log)
+{
+	const uid_t owner = uid == static_cast<uint32_t>(-1) ? geteuid() : static_cast<uid_t>(uid);
+	struct stat st = {};
+	if (lstat(std::string(directory.begin(), directory.end()).c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != owner)
+		return false;
+
+	const gid_t group = gid == static_cast<uint32_t>(-1) ? st.st_gid : static_cast<gid_t>(gid);
+	if (geteuid() == 0 && owner != 0) {
+		if (setgroups(0, nullptr) != 0 || setresgid(group, group, group) != 0 || setresuid(owner, owner, owner) != 0)
+			return false;
+	}
+	if (geteuid() != owner)
+		return false;
+
+	// A log left by an earlier core of the same pid is replaced, a link is removed and not followed
+	const std::string path(log.begin(), log.end());
+	unlink(path.c_str());
+	const int file = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+	if (file < 0)
+		return false;
+	close(file);
+	return true;
+}
@@ -0,0 +1,228 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../crash-context.hpp"
+#include "../logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+
+class CrashContextChannel_LINUX : public CrashContextChannel {
+public:
+	CrashContextChannel_LINUX(report_callback on_report);
+	virtual ~CrashContextChannel_LINUX();
+
+	virtual bool attach(int32_t pid, int &page, int &event) override;
+	virtual void detach(int32_t pid) override;
+
+private:
+	struct Entry {
+		int page = -1;
+		int event = -1;
+		CrashContext *context = nullptr;
+	};
+
+	report_callback on_report;
+	int epoll_fd = -1;
+	int wake_fd = -1;
+	std::atomic<bool> stopping{false};
+	std::thread *worker = nullptr;
+	std::mutex mtx;
+	std::unordered_map<int32_t, Entry> entries;
+
+	static void release(Entry &entry);
+	void worker_fnc();
+	void reported(int32_t pid);
+};
+
+std::unique_ptr<CrashContextChannel> CrashContextChannel::create(report_callback on_report)
+{
+	return std::make_unique<CrashContextChannel_LINUX>(on_report);
+}
+
+CrashContextChannel_LINUX::CrashContextChannel_LINUX(report_callback on_report) : on_report(on_report)
+{
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (epoll_fd < 0 || wake_fd < 0) {
+		log_error << "Failed to create the crash context channel " << strerror(errno) << std::endl;
+		return;
+	}
+
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.u64 = 0;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+	worker = new std::thread(&CrashContextChannel_LINUX::worker_fnc, this);
+}
+
+CrashContextChannel_LINUX::~CrashContextChannel_LINUX()
+{
+	stopping = true;
+	if (wake_fd >= 0)
+		eventfd_write(wake_fd, 1);
+	if (worker) {
+		if (worker->joinable())
+			worker->join();
+		delete worker;
+	}
+
+	for (auto &entry : entries)
+		release(entry.second);
+	if (wake_fd >= 0)
+		close(wake_fd);
+	if (epoll_fd >= 0)
+		close(epoll_fd);
+}
+
+void CrashContextChannel_LINUX::release(Entry &entry)
+{
+	if (entry.context)
+		munmap(entry.context, CRASH_CONTEXT_SIZE);
+	if (entry.page >= 0)
+		close(entry.page);
+	if (entry.event >= 0)
+		close(entry.event);
+	entry = Entry();
+}
+
+bool CrashContextChannel_LINUX::attach(int32_t pid, int &page, int &event)
+{
+	if (!worker || pid <= 0)
+		return false;
+
+	const std::lock_guard<std::mutex> lock(mtx);
+	auto it = entries.find(pid);
+	if (it != entries.end()) {
+		page = it->second.page;
+		event = it->second.event;
+		return true;
+	}
+
+	Entry entry;
+	entry.page = memfd_create("crash-handler-context", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	entry.event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (entry.page < 0 || entry.event < 0 || ftruncate(entry.page, CRASH_CONTEXT_SIZE) != 0) {
+		log_error << "Failed to create the crash context of pid " << pid << ": " << strerror(errno) << std::endl;
+		release(entry);
+		return false;
+	}
+
+	// The process must not be able to resize the page under the handler
+	fcntl(entry.page, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+	void *mapped = mmap(nullptr, CRASH_CONTEXT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, entry.page, 0);
+	if (mapped == MAP_FAILED) {
+		log_error << "Failed to map the crash context of pid " << pid << ": " << strerror(errno) << std::endl;
+		release(entry);
+		return false;
+	}
+	entry.context = static_cast<CrashContext *>(mapped);
+	entry.context->magic = CRASH_CONTEXT_MAGIC;
+	entry.context->version = CRASH_CONTEXT_VERSION;
+	entry.context->pid = pid;
+	entry.context->state.store(CRASH_CONTEXT_EMPTY, std::memory_order_release);
+
+	epoll_event ready = {};
+	ready.events = EPOLLIN;
+	ready.data.u64 = static_cast<uint32_t>(pid);
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, entry.event, &ready) != 0) {
+		log_error << "Failed to watch the crash context of pid " << pid << ": " << strerror(errno) << std::endl;
+		release(entry);
+		return false;
+	}
+
+	entries[pid] = entry;
+	page = entry.page;
+	event = entry.event;
+	log_info << "Crash context attached to pid " << pid << std::endl;
+	return true;
+}
+
+void CrashContextChannel_LINUX::detach(int32_t pid)
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	auto it = entries.find(pid);
+	if (it == entries.end())
+		return;
+
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.event, nullptr);
+	release(it->second);
+	entries.erase(it);
+}
+
+void CrashContextChannel_LINUX::worker_fnc()
+{
+	epoll_event events[16];
+	while (!stopping) {
+		int count = epoll_wait(epoll_fd, events, 16, -1);
+		if (count < 0 && errno != EINTR)
+			break;
+
+		for (int i = 0; i < count && !stopping; i++) {
+			if (events[i].data.u64 != 0)
+				reported(static_cast<int32_t>(events[i].data.u64));
+		}
+	}
+}
+
+void CrashContextChannel_LINUX::reported(int32_t pid)
+{
+	CrashContext copy;
+	{
+		const std::lock_guard<std::mutex> lock(mtx);
+		auto it = entries.find(pid);
+		if (it == entries.end())
+			return;
+
+		eventfd_t count;
+		eventfd_read(it->second.event, &count);
+
+		// A wake up without a complete page is ignored, the process may still write it
+		const CrashContext *context = it->second.context;
+		if (context->state.load(std::memory_order_acquire) != CRASH_CONTEXT_WRITTEN)
+			return;
+		copy.magic = context->magic;
+		copy.version = context->version;
+		copy.state.store(CRASH_CONTEXT_WRITTEN, std::memory_order_relaxed);
+		copy.pid = pid;
+		copy.tid = context->tid;
+		copy.signal = context->signal;
+		copy.code = context->code;
+		copy.architecture = context->architecture;
+		copy.address = context->address;
+		copy.instruction_pointer = context->instruction_pointer;
+		copy.stack_pointer = context->stack_pointer;
+		copy.register_count = std::min<uint32_t>(context->register_count, CRASH_CONTEXT_REGISTERS);
+		memcpy(copy.registers, context->registers, sizeof(copy.registers));
+
+		// The page is reported once, a process that crashes keeps nothing else to say
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.event, nullptr);
+	}
+	on_report(pid, copy);
+}
@@ -0,0 +1,680 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../crash-interceptor.hpp"
+#include "../logger.hpp"
+#include "../metrics.hpp"
+#include "minidump-linux.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <elf.h>
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+
+// Interrupts the blocking wait of the tracer thread when a request is queued
+#define CRASH_INTERCEPT_WAKE_SIGNAL (SIGRTMIN + 5)
+#define CRASH_INTERCEPT_WAKE_RETRY_MS 10
+#define CRASH_INTERCEPT_REQUEST_TIMEOUT_MS 1000
+// Time between polls of the traced threads while a child of the handler itself is waiting to be reaped
+#define CRASH_INTERCEPT_POLL_MS 10
+#define CRASH_INTERCEPT_STACK_BYTES (16 * 1024)
+#define CRASH_SNAPSHOT_STACK_BYTES (32 * 1024)
+#define CRASH_SNAPSHOT_RED_ZONE 128
+// Frames are walked only in the copied top of each stack
+#define CRASH_SAMPLE_STACK_BYTES (16 * 1024)
+#define CRASH_SAMPLE_MAX_FRAMES 64
+
+class CrashInterceptor_LINUX : public CrashInterceptor {
+public:
+	CrashInterceptor_LINUX(crash_callback on_crash);
+	virtual ~CrashInterceptor_LINUX();
+
+	virtual bool attach(int32_t pid) override;
+	virtual void detach(int32_t pid) override;
+	virtual bool snapshot(int32_t pid, const std::string &path) override;
+	virtual bool sample(int32_t pid, std::vector<ThreadStack> &stacks) override;
+
+private:
+	// Registers and top of the stack of a thread, copied while it is held
+	struct StackCopy {
+		int32_t tid = 0;
+		uint64_t ip = 0;
+		uint64_t sp = 0;
+		uint64_t fp = 0;
+		std::vector<uint8_t> stack;
+	};
+
+	// Executable mapping, frames are named after its file
+	struct Mapping {
+		uint64_t start = 0;
+		uint64_t end = 0;
+		uint64_t offset = 0;
+		std::string name;
+	};
+
+	struct Request {
+		enum Kind { Attach, Detach, Snapshot, Sample };
+		Kind kind = Detach;
+		int32_t pid = 0;
+		std::string path;
+		std::vector<StackCopy> copies;
+		bool done = false;
+		bool result = false;
+	};
+
+	crash_callback on_crash;
+	std::thread *worker = nullptr;
+	pthread_t worker_thread;
+	std::atomic<bool> stopping{false};
+	bool finished = false;
+	std::mutex mtx;
+	std::condition_variable changed;
+	std::deque<std::shared_ptr<Request>> requests;
+
+	// Only used by the tracer thread, ptrace requests are bound to the thread that seized
+	std::unordered_map<int32_t, std::set<int32_t>> traced;
+	std::unordered_map<int32_t, int32_t> owners;
+
+	bool submit(std::shared_ptr<Request> request);
+	void worker_fnc();
+	void serveRequests();
+	bool seize(int32_t pid);
+	void release(int32_t pid);
+	void forget(int32_t tid);
+	void stopped(int32_t tid, int status);
+	bool pollTraced();
+	bool isFatal(int32_t pid, int signal, const siginfo_t &info);
+	void capture(int32_t pid, int32_t tid, const siginfo_t &info);
+	// Holds every thread of the process while read is called for each of them
+	bool hold(int32_t pid, const std::function<void(int32_t tid)> &read, int64_t &heldUs);
+	bool writeSnapshot(int32_t pid, const std::string &path);
+	bool copyStacks(int32_t pid, std::vector<StackCopy> &copies);
+	static std::vector<Mapping> readMappings(int32_t pid);
+	static bool readRegisters(int32_t tid, uint32_t &count, uint64_t *registers, uint64_t &ip, uint64_t &sp);
+};
+
+std::unique_ptr<CrashInterceptor> CrashInterceptor::create(crash_callback on_crash)
+{
+	return std::make_unique<CrashInterceptor_LINUX>(on_crash);
+}
+
+static void wakeTracer(int) {}
+
+CrashInterceptor_LINUX::CrashInterceptor_LINUX(crash_callback on_crash) : on_crash(on_crash)
+{
+	// No SA_RESTART, so the signal makes waitid return
+	struct sigaction action = {};
+	action.sa_handler = wakeTracer;
+	sigemptyset(&action.sa_mask);
+	sigaction(CRASH_INTERCEPT_WAKE_SIGNAL, &action, nullptr);
+
+	worker = new std::thread(&CrashInterceptor_LINUX::worker_fnc, this);
+	worker_thread = worker->native_handle();
+}
+
+CrashInterceptor_LINUX::~CrashInterceptor_LINUX()
+{
+	{
+		const std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+	}
+	changed.notify_all();
+	// The tracer thread releases the processes it traces before it ends
+	while (true) {
+		pthread_kill(worker_thread, CRASH_INTERCEPT_WAKE_SIGNAL);
+		std::unique_lock<std::mutex> lock(mtx);
+		if (changed.wait_for(lock, std::chrono::milliseconds(CRASH_INTERCEPT_WAKE_RETRY_MS), [this] { return finished; }))
+			break;
+	}
+	worker->join();
+	delete worker;
+}
+
+bool CrashInterceptor_LINUX::submit(std::shared_ptr<Request> request)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	if (stopping)
+		return false;
+	requests.push_back(request);
+	changed.notify_all();
+
+	// The signal can land just before the tracer blocks in waitid, it is sent again until the request is served
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CRASH_INTERCEPT_REQUEST_TIMEOUT_MS);
+	while (!request->done && std::chrono::steady_clock::now() < deadline) {
+		pthread_kill(worker_thread, CRASH_INTERCEPT_WAKE_SIGNAL);
+		changed.wait_for(lock, std::chrono::milliseconds(CRASH_INTERCEPT_WAKE_RETRY_MS), [&request] { return request->done; });
+	}
+	return request->done && request->result;
+}
+
+bool CrashInterceptor_LINUX::attach(int32_t pid)
+{
+	auto request = std::make_shared<Request>();
+	request->kind = Request::Attach;
+	request->pid = pid;
+	return submit(request);
+}
+
+void CrashInterceptor_LINUX::detach(int32_t pid)
+{
+	auto request = std::make_shared<Request>();
+	request->kind = Request::Detach;
+	request->pid = pid;
+	submit(request);
+}
+
+bool CrashInterceptor_LINUX::snapshot(int32_t pid, const std::string &path)
+{
+	auto request = std::make_shared<Request>();
+	request->kind = Request::Snapshot;
+	request->pid = pid;
+	request->path = path;
+	return submit(request);
+}
+
+void CrashInterceptor_LINUX::serveRequests()
+{
+	std::deque<std::shared_ptr<Request>> pending;
+	{
+		const std::lock_guard<std::mutex> lock(mtx);
+		pending.swap(requests);
+	}
+	for (auto &request : pending) {
+		if (request->kind == Request::Attach) {
+			request->result = seize(request->pid);
+		} else if (request->kind == Request::Snapshot) {
+			request->result = writeSnapshot(request->pid, request->path);
+		} else if (request->kind == Request::Sample) {
+			request->result = copyStacks(request->pid, request->copies);
+		} else {
+			release(request->pid);
+			request->result = true;
+		}
+	}
+
+	const std::lock_guard<std::mutex> lock(mtx);
+	for (auto &request : pending)
+		request->done = true;
+	changed.notify_all();
+}
+
+void CrashInterceptor_LINUX::worker_fnc()
+{
+	while (true) {
+		serveRequests();
+		if (stopping) {
+			while (!traced.empty())
+				release(traced.begin()->first);
+			const std::lock_guard<std::mutex> lock(mtx);
+			finished = true;
+			changed.notify_all();
+			return;
+		}
+
+		if (traced.empty()) {
+			std::unique_lock<std::mutex> lock(mtx);
+			changed.wait(lock, [this] { return stopping || !requests.empty(); });
+			continue;
+		}
+
+		// The next event is looked at without reaping it, a child of the handler itself is left to whoever started it
+		siginfo_t info = {};
+		if (waitid(P_ALL, 0, &info, WEXITED | WSTOPPED | WNOWAIT | __WALL) != 0)
+			continue;
+		int status = 0;
+		if (owners.count(info.si_pid)) {
+			if (waitpid(info.si_pid, &status, __WALL) == info.si_pid)
+				stopped(info.si_pid, status);
+			continue;
+		}
+
+		// The traced threads are polled one by one until that event is gone, a new thread also stops before its clone event makes it known
+		if (!pollTraced()) {
+			std::unique_lock<std::mutex> lock(mtx);
+			changed.wait_for(lock, std::chrono::milliseconds(CRASH_INTERCEPT_POLL_MS), [this] { return stopping || !requests.empty(); });
+		}
+	}
+}
+
+bool CrashInterceptor_LINUX::pollTraced()
+{
+	std::vector<int32_t> tids;
+	for (const auto &owner : owners)
+		tids.push_back(owner.first);
+
+	bool any = false;
+	for (int32_t tid : tids) {
+		int status = 0;
+		if (waitpid(tid, &status, WNOHANG | __WALL) == tid) {
+			stopped(tid, status);
+			any = true;
+		}
+	}
+	return any;
+}
+
+bool CrashInterceptor_LINUX::seize(int32_t pid)
+{
+	if (traced.count(pid))
+		return true;
+
+	// New threads are traced from their creation on, the existing ones are seized one by one
+	const long options = PTRACE_O_TRACECLONE;
+	std::set<int32_t> &threads = traced[pid];
+	std::error_code error;
+	for (const auto &entry : std::filesystem::directory_iterator("/proc/" + std::to_string(pid) + "/task", error)) {
+		const int32_t tid = atoi(entry.path().filename().c_str());
+		if (tid <= 0 || threads.count(tid))
+			continue;
+		if (ptrace(PTRACE_SEIZE, tid, nullptr, reinterpret_cast<void *>(options)) != 0) {
+			if (errno == ESRCH)
+				continue;
+			log_error << "Failed to trace pid " << pid << " thread " << tid << ": " << strerror(errno) << std::endl;
+			release(pid);
+			return false;
+		}
+		threads.insert(tid);
+		owners[tid] = pid;
+	}
+	if (threads.empty()) {
+		traced.erase(pid);
+		return false;
+	}
+	log_info << "Intercepting crashes of pid " << pid << ", " << threads.size() << " threads" << std::endl;
+	return true;
+}
+
+void CrashInterceptor_LINUX::release(int32_t pid)
+{
+	auto it = traced.find(pid);
+	if (it == traced.end())
+		return;
+
+	// A tracee is detached from a stop, it is interrupted first and keeps the signal it was stopped with
+	for (int32_t tid : it->second) {
+		owners.erase(tid);
+		if (ptrace(PTRACE_INTERRUPT, tid, nullptr, nullptr) != 0)
+			continue;
+		int status = 0;
+		if (waitpid(tid, &status, __WALL) != tid || !WIFSTOPPED(status))
+			continue;
+		const bool signalStop = (status >> 16) == 0;
+		ptrace(PTRACE_DETACH, tid, nullptr, reinterpret_cast<void *>(static_cast<long>(signalStop ? WSTOPSIG(status) : 0)));
+	}
+	traced.erase(it);
+}
+
+void CrashInterceptor_LINUX::forget(int32_t tid)
+{
+	auto owner = owners.find(tid);
+	if (owner == owners.end())
+		return;
+
+	auto it = traced.find(owner->second);
+	if (it != traced.end()) {
+		it->second.erase(tid);
+		if (it->second.empty())
+			traced.erase(it);
+	}
+	owners.erase(owner);
+}
+
+void CrashInterceptor_LINUX::stopped(int32_t tid, int status)
+{
+	if (WIFEXITED(status) || WIFSIGNALED(status)) {
+		forget(tid);
+		return;
+	}
+	if (!WIFSTOPPED(status))
+		return;
+
+	const int event = status >> 16;
+	const int signal = WSTOPSIG(status);
+	if (event == PTRACE_EVENT_CLONE) {
+		unsigned long child = 0;
+		auto owner = owners.find(tid);
+		if (ptrace(PTRACE_GETEVENTMSG, tid, nullptr, &child) == 0 && owner != owners.end()) {
+			traced[owner->second].insert(static_cast<int32_t>(child));
+			owners[static_cast<int32_t>(child)] = owner->second;
+		}
+		ptrace(PTRACE_CONT, tid, nullptr, nullptr);
+		return;
+	}
+	if (event == PTRACE_EVENT_STOP) {
+		// A group stop is kept without resuming the tracee, any other event stop is a new thread or an interrupt
+		if (signal == SIGSTOP || signal == SIGTSTP || signal == SIGTTIN || signal == SIGTTOU)
+			ptrace(PTRACE_LISTEN, tid, nullptr, nullptr);
+		else
+			ptrace(PTRACE_CONT, tid, nullptr, nullptr);
+		return;
+	}
+
+	// Signal delivery stop, every signal of the process passes here and is delivered unchanged
+	siginfo_t info = {};
+	auto owner = owners.find(tid);
+	if (owner != owners.end() && ptrace(PTRACE_GETSIGINFO, tid, nullptr, &info) == 0 && isFatal(owner->second, signal, info))
+		capture(owner->second, tid, info);
+	ptrace(PTRACE_CONT, tid, nullptr, reinterpret_cast<void *>(static_cast<long>(signal)));
+}
+
+bool CrashInterceptor_LINUX::isFatal(int32_t pid, int signal, const siginfo_t &info)
+{
+	if (signal != SIGSEGV && signal != SIGBUS && signal != SIGILL && signal != SIGFPE && signal != SIGABRT && signal != SIGSYS && signal != SIGTRAP)
+		return false;
+
+	// A signal the process handles is its own business, it is seen again if the handler raises it with the default action
+	std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+	std::string line;
+	const uint64_t bit = 1ull << (signal - 1);
+	while (std::getline(status, line)) {
+		if (line.rfind("SigCgt:", 0) == 0 || line.rfind("SigIgn:", 0) == 0) {
+			if (std::stoull(line.substr(7), nullptr, 16) & bit)
+				return false;
+		}
+	}
+	return true;
+}
+
+bool CrashInterceptor_LINUX::readRegisters(int32_t tid, uint32_t &count, uint64_t *registers, uint64_t &ip, uint64_t &sp)
+{
+	user_regs_struct regs = {};
+	iovec iov = {&regs, sizeof(regs)};
+	if (ptrace(PTRACE_GETREGSET, tid, reinterpret_cast<void *>(NT_PRSTATUS), &iov) != 0)
+		return false;
+
+#if defined(__x86_64__)
+	// In the order of the ucontext gregs the client library copies
+	const uint64_t ordered[] = {regs.r8,  regs.r9,  regs.r10, regs.r11, regs.r12, regs.r13, regs.r14, regs.r15, regs.rdi,
+				    regs.rsi, regs.rbp, regs.rbx, regs.rdx, regs.rax, regs.rcx, regs.rsp, regs.rip, regs.eflags};
+	count = sizeof(ordered) / sizeof(ordered[0]);
+	memcpy(registers, ordered, sizeof(ordered));
+	ip = regs.rip;
+	sp = regs.rsp;
+#elif defined(__aarch64__)
+	for (int i = 0; i < 31; i++)
+		registers[i] = regs.regs[i];
+	registers[31] = regs.sp;
+	registers[32] = regs.pc;
+	registers[33] = regs.pstate;
+	count = 34;
+	ip = regs.pc;
+	sp = regs.sp;
+#else
+	count = 0;
+	ip = 0;
+	sp = 0;
+#endif
+	return true;
+}
+
+void CrashInterceptor_LINUX::capture(int32_t pid, int32_t tid, const siginfo_t &info)
+{
+	const auto started = std::chrono::steady_clock::now();
+	CrashSnapshot snapshot;
+	CrashContext &context = snapshot.context;
+	context.magic = CRASH_CONTEXT_MAGIC;
+	context.version = CRASH_CONTEXT_VERSION;
+	context.pid = pid;
+	context.tid = tid;
+	context.signal = info.si_signo;
+	context.code = info.si_code;
+	context.address = info.si_code > 0 ? reinterpret_cast<uint64_t>(info.si_addr) : 0;
+#if defined(__x86_64__)
+	context.architecture = CRASH_CONTEXT_ARCH_X86_64;
+#elif defined(__aarch64__)
+	context.architecture = CRASH_CONTEXT_ARCH_AARCH64;
+#endif
+	readRegisters(tid, context.register_count, context.registers, context.instruction_pointer, context.stack_pointer);
+	context.state.store(CRASH_CONTEXT_WRITTEN, std::memory_order_relaxed);
+
+	// The other threads are held too, so the snapshot is of one instant
+	std::set<int32_t> threads = traced[pid];
+	for (int32_t other : threads) {
+		if (other == tid || ptrace(PTRACE_INTERRUPT, other, nullptr, nullptr) != 0)
+			continue;
+		int status = 0;
+		if (waitpid(other, &status, __WALL) != other || !WIFSTOPPED(status)) {
+			forget(other);
+			continue;
+		}
+
+		CrashThreadState state;
+		state.tid = other;
+		if (readRegisters(other, state.register_count, state.registers, state.instruction_pointer, state.stack_pointer))
+			snapshot.threads.push_back(state);
+	}
+
+	if (context.stack_pointer) {
+		minidump_read_stack(pid, context.stack_pointer, CRASH_INTERCEPT_STACK_BYTES, snapshot.stack);
+		snapshot.stack_address = context.stack_pointer;
+	}
+
+	log_info << "Intercepted signal " << info.si_signo << " of pid " << pid << " thread " << tid << ", " << snapshot.threads.size() + 1 << " threads captured in "
+		 << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count() << " us" << std::endl;
+	on_crash(pid, snapshot);
+
+	// The held threads go on only to die with the process
+	for (const CrashThreadState &state : snapshot.threads)
+		ptrace(PTRACE_CONT, state.tid, nullptr, nullptr);
+}
+
+bool CrashInterceptor_LINUX::hold(int32_t pid, const std::function<void(int32_t tid)> &read, int64_t &heldUs)
+{
+	// A process that is not traced yet is seized for the time of the hold only
+	auto it = traced.find(pid);
+	const bool borrowed = it == traced.end();
+	std::set<int32_t> threads;
+	if (borrowed) {
+		std::error_code error;
+		for (const auto &entry : std::filesystem::directory_iterator("/proc/" + std::to_string(pid) + "/task", error)) {
+			const int32_t tid = atoi(entry.path().filename().c_str());
+			if (tid > 0 && ptrace(PTRACE_SEIZE, tid, nullptr, nullptr) == 0)
+				threads.insert(tid);
+		}
+	} else {
+		threads = it->second;
+	}
+	if (threads.empty())
+		return false;
+
+	// Every thread is interrupted before the first stop is waited for, so they are held together and for the shortest time
+	const auto started = std::chrono::steady_clock::now();
+	std::vector<int32_t> interrupted;
+	for (int32_t tid : threads) {
+		if (ptrace(PTRACE_INTERRUPT, tid, nullptr, nullptr) == 0)
+			interrupted.push_back(tid);
+	}
+	std::vector<std::pair<int32_t, int>> held;
+	for (int32_t tid : interrupted) {
+		int status = 0;
+		if (waitpid(tid, &status, __WALL) != tid || !WIFSTOPPED(status)) {
+			if (!borrowed)
+				forget(tid);
+			continue;
+		}
+		held.push_back({tid, status});
+	}
+	for (const auto &entry : held)
+		read(entry.first);
+
+	// Interrupt stops are resumed before a signal seen meanwhile is handled, a fatal one interrupts the other threads again
+	std::stable_partition(held.begin(), held.end(), [](const std::pair<int32_t, int> &entry) { return (entry.second >> 16) != 0; });
+	for (const auto &entry : held) {
+		const bool signalStop = (entry.second >> 16) == 0;
+		if (borrowed)
+			ptrace(PTRACE_DETACH, entry.first, nullptr, reinterpret_cast<void *>(static_cast<long>(signalStop ? WSTOPSIG(entry.second) : 0)));
+		else
+			stopped(entry.first, entry.second);
+	}
+	heldUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+	return !held.empty();
+}
+
+#if defined(__x86_64__)
+bool CrashInterceptor_LINUX::writeSnapshot(int32_t pid, const std::string &path)
+{
+	std::vector<MinidumpThread> captured;
+	int64_t heldUs = 0;
+	const bool held = hold(
+		pid,
+		[pid, &captured](int32_t tid) {
+			MinidumpThread thread;
+			thread.tid = tid;
+			iovec iov = {&thread.regs, sizeof(thread.regs)};
+			if (ptrace(PTRACE_GETREGSET, tid, reinterpret_cast<void *>(NT_PRSTATUS), &iov) != 0)
+				return;
+			iov = {&thread.floats, sizeof(thread.floats)};
+			thread.hasFloats = ptrace(PTRACE_GETREGSET, tid, reinterpret_cast<void *>(NT_PRFPREG), &iov) == 0;
+
+			// Leaf functions keep data below the stack pointer
+			thread.stackStart = (thread.regs.rsp - CRASH_SNAPSHOT_RED_ZONE) & ~15ull;
+			minidump_read_stack(pid, thread.stackStart, CRASH_SNAPSHOT_STACK_BYTES, thread.stack);
+			captured.push_back(std::move(thread));
+		},
+		heldUs);
+	if (!held) {
+		log_error << "Failed to hold pid " << pid << " for a snapshot" << std::endl;
+		return false;
+	}
+	log_info << "Held pid " << pid << " for a snapshot of " << captured.size() << " threads in " << heldUs << " us" << std::endl;
+
+	return !captured.empty() && minidump_write_threads(pid, captured, path);
+}
+#else
+bool CrashInterceptor_LINUX::writeSnapshot(int32_t pid, const std::string &path)
+{
+	log_error << "Hang snapshots are not supported on this architecture" << std::endl;
+	return false;
+}
+#endif
+
+bool CrashInterceptor_LINUX::copyStacks(int32_t pid, std::vector<StackCopy> &copies)
+{
+	static MetricHistogram &holds = Metrics::getInstance()->histogram("crash_handler_stack_sample_hold_seconds", "Time a process is held for one stack sample", 1e-6);
+	int64_t heldUs = 0;
+	const bool held = hold(
+		pid,
+		[pid, &copies](int32_t tid) {
+			StackCopy copy;
+			copy.tid = tid;
+#if defined(__x86_64__) || defined(__aarch64__)
+			user_regs_struct regs = {};
+			iovec iov = {&regs, sizeof(regs)};
+			if (ptrace(PTRACE_GETREGSET, tid, reinterpret_cast<void *>(NT_PRSTATUS), &iov) != 0)
+				return;
+#endif
+#if defined(__x86_64__)
+			copy.ip = regs.rip;
+			copy.sp = regs.rsp;
+			copy.fp = regs.rbp;
+#elif defined(__aarch64__)
+			copy.ip = regs.pc;
+			copy.sp = regs.sp;
+			copy.fp = regs.regs[29];
+#endif
+			if (copy.sp)
+				minidump_read_stack(pid, copy.sp, CRASH_SAMPLE_STACK_BYTES, copy.stack);
+			copies.push_back(std::move(copy));
+		},
+		heldUs);
+	if (held)
+		holds.record(heldUs);
+	return held;
+}
+
+bool CrashInterceptor_LINUX::sample(int32_t pid, std::vector<ThreadStack> &stacks)
+{
+	auto request = std::make_shared<Request>();
+	request->kind = Request::Sample;
+	request->pid = pid;
+	if (!submit(request))
+		return false;
+
+	// The process runs again, frames are walked in the copies and named from the mappings read now
+	const std::vector<Mapping> mappings = readMappings(pid);
+	auto name = [&mappings](uint64_t address) {
+		auto it = std::upper_bound(mappings.begin(), mappings.end(), address, [](uint64_t value, const Mapping &mapping) { return value < mapping.end; });
+		std::ostringstream frame;
+		if (it != mappings.end() && address >= it->start)
+			frame << it->name << "+0x" << std::hex << address - it->start + it->offset;
+		else
+			frame << "0x" << std::hex << address;
+		return frame.str();
+	};
+
+	for (const StackCopy &copy : request->copies) {
+		ThreadStack stack;
+		stack.tid = copy.tid;
+		std::ifstream comm("/proc/" + std::to_string(pid) + "/task/" + std::to_string(copy.tid) + "/comm");
+		std::getline(comm, stack.name);
+		if (copy.ip)
+			stack.frames.push_back(name(copy.ip));
+
+		// Each frame record holds the caller frame pointer then the return address, the chain only goes up the stack
+		uint64_t fp = copy.fp;
+		while (stack.frames.size() < CRASH_SAMPLE_MAX_FRAMES && fp >= copy.sp && fp - copy.sp + 16 <= copy.stack.size()) {
+			uint64_t record[2];
+			memcpy(record, copy.stack.data() + (fp - copy.sp), sizeof(record));
+			if (!record[1] || record[0] <= fp)
+				break;
+			stack.frames.push_back(name(record[1]));
+			fp = record[0];
+		}
+		stacks.push_back(std::move(stack));
+	}
+	return !stacks.empty();
+}
+
+std::vector<CrashInterceptor_LINUX::Mapping> CrashInterceptor_LINUX::readMappings(int32_t pid)
+{
+	std::vector<Mapping> mappings;
+	std::ifstream maps("/proc/" + std::to_string(pid) + "/maps");
+	std::string line;
+	while (std::getline(maps, line)) {
+		Mapping mapping;
+		char permissions[8] = {};
+		int pathAt = 0;
+		if (sscanf(line.c_str(), "%lx-%lx %7s %lx %*s %*s %n", &mapping.start, &mapping.end, permissions, &mapping.offset, &pathAt) < 4 || permissions[2] != 'x')
+			continue;
+		const std::string path = pathAt > 0 ? line.substr(pathAt) : std::string();
+		mapping.name = path.empty() ? "[anon]" : path.substr(path.rfind('/') + 1);
+		mappings.push_back(mapping);
+	}
+	return mappings;
+}
@@ -0,0 +1,208 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "discovery-linux.hpp"
+#include "../logger.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+
+// Without the proc connector the children of watched processes are read from /proc at this period
+#define DISCOVERY_SCAN_PERIOD_MS 1000
+
+std::unique_ptr<ProcessDiscovery> ProcessDiscovery::create(fork_callback on_fork, exit_callback on_exit)
+{
+	return std::make_unique<ProcessDiscovery_LINUX>(on_fork, on_exit);
+}
+
+ProcessDiscovery_LINUX::ProcessDiscovery_LINUX(fork_callback on_fork, exit_callback on_exit) : on_fork(on_fork), on_exit(on_exit)
+{
+	stop_fd = eventfd(0, EFD_CLOEXEC);
+
+	if (openConnector()) {
+		log_info << "Process discovery uses the proc connector" << std::endl;
+		worker = new std::thread(&ProcessDiscovery_LINUX::connector_fnc, this);
+	} else {
+		log_info << "Process discovery falls back to scanning children of watched processes" << std::endl;
+		worker = new std::thread(&ProcessDiscovery_LINUX::scan_fnc, this);
+	}
+}
+
+ProcessDiscovery_LINUX::~ProcessDiscovery_LINUX()
+{
+	uint64_t stop = 1;
+	if (::write(stop_fd, &stop, sizeof(stop)) < 0)
+		log_error << "Failed to stop process discovery: " << strerror(errno) << std::endl;
+
+	if (worker->joinable())
+		worker->join();
+	delete worker;
+
+	if (netlink_fd >= 0)
+		close(netlink_fd);
+	close(stop_fd);
+}
+
+void ProcessDiscovery_LINUX::watch(int32_t pid)
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	watched.insert(pid);
+}
+
+void ProcessDiscovery_LINUX::unwatch(int32_t pid)
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	watched.erase(pid);
+}
+
+bool ProcessDiscovery_LINUX::isWatched(int32_t pid)
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	return watched.count(pid) != 0;
+}
+
+bool ProcessDiscovery_LINUX::openConnector()
+{
+	// Subscribing needs CAP_NET_ADMIN, which a desktop session usually does not have
+	netlink_fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+	if (netlink_fd < 0)
+		return false;
+
+	sockaddr_nl addr = {};
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = CN_IDX_PROC;
+	if (bind(netlink_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+		log_info << "Proc connector bind failed: " << strerror(errno) << std::endl;
+		close(netlink_fd);
+		netlink_fd = -1;
+		return false;
+	}
+
+	alignas(nlmsghdr) char request[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))] = {};
+	nlmsghdr *header = reinterpret_cast<nlmsghdr *>(request);
+	header->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+	header->nlmsg_type = NLMSG_DONE;
+
+	cn_msg *message = static_cast<cn_msg *>(NLMSG_DATA(header));
+	message->id.idx = CN_IDX_PROC;
+	message->id.val = CN_VAL_PROC;
+	message->len = sizeof(proc_cn_mcast_op);
+	const proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+	memcpy(message->data, &op, sizeof(op));
+
+	if (send(netlink_fd, request, header->nlmsg_len, 0) < 0) {
+		log_info << "Proc connector subscription failed: " << strerror(errno) << std::endl;
+		close(netlink_fd);
+		netlink_fd = -1;
+		return false;
+	}
+	return true;
+}
+
+void ProcessDiscovery_LINUX::connector_fnc()
+{
+	alignas(nlmsghdr) char buffer[8192];
+	pollfd fds[2] = {{netlink_fd, POLLIN, 0}, {stop_fd, POLLIN, 0}};
+
+	while (true) {
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			log_error << "Proc connector poll failed: " << strerror(errno) << std::endl;
+			break;
+		}
+		if (fds[1].revents)
+			break;
+
+		sockaddr_nl from = {};
+		socklen_t from_len = sizeof(from);
+		ssize_t received = recvfrom(netlink_fd, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr *>(&from), &from_len);
+		if (received <= 0 || from.nl_pid != 0) // only the kernel may send proc events
+			continue;
+
+		for (nlmsghdr *header = reinterpret_cast<nlmsghdr *>(buffer); NLMSG_OK(header, received); header = NLMSG_NEXT(header, received)) {
+			const cn_msg *message = static_cast<const cn_msg *>(NLMSG_DATA(header));
+			if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC)
+				continue;
+
+			const proc_event *event = reinterpret_cast<const proc_event *>(message->data);
+			switch (event->what) {
+			case proc_event::PROC_EVENT_FORK: {
+				const auto &fork = event->event_data.fork;
+				// Threads share the tgid of their process and are not reported
+				if (fork.child_pid == fork.child_tgid && isWatched(fork.parent_tgid))
+					on_fork(fork.parent_tgid, fork.child_tgid);
+				break;
+			}
+			case proc_event::PROC_EVENT_EXIT: {
+				const auto &exit = event->event_data.exit;
+				if (exit.process_pid == exit.process_tgid && isWatched(exit.process_tgid))
+					on_exit(exit.process_tgid, exit.exit_code, WIFSIGNALED(exit.exit_code) ? WTERMSIG(exit.exit_code) : 0);
+				break;
+			}
+			default:
+				break;
+			}
+		}
+	}
+}
+
+void ProcessDiscovery_LINUX::scan_fnc()
+{
+	// Only the task directories of watched processes are read, never the whole process table
+	pollfd stop = {stop_fd, POLLIN, 0};
+	while (poll(&stop, 1, DISCOVERY_SCAN_PERIOD_MS) == 0) {
+		std::vector<int32_t> parents;
+		{
+			const std::lock_guard<std::mutex> lock(mtx);
+			parents.assign(watched.begin(), watched.end());
+		}
+
+		for (int32_t parent : parents) {
+			const std::string tasks = "/proc/" + std::to_string(parent) + "/task";
+			DIR *dir = opendir(tasks.c_str());
+			if (!dir)
+				continue;
+
+			while (dirent *entry = readdir(dir)) {
+				if (entry->d_name[0] == '.')
+					continue;
+
+				std::ifstream children(tasks + "/" + entry->d_name + "/children");
+				int32_t child = 0;
+				while (children >> child) {
+					if (!isWatched(child))
+						on_fork(parent, child);
+				}
+			}
+			closedir(dir);
+		}
+	}
+}
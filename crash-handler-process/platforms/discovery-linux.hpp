@@ -0,0 +1,51 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+
+#include "../discovery.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+
+class ProcessDiscovery_LINUX : public ProcessDiscovery {
+private:
+	fork_callback on_fork;
+	exit_callback on_exit;
+
+	std::set<int32_t> watched;
+	std::mutex mtx;
+
+	int netlink_fd = -1;
+	int stop_fd = -1;
+	std::thread *worker = nullptr;
+
+	bool openConnector();
+	void connector_fnc();
+	void scan_fnc();
+	bool isWatched(int32_t pid);
+
+public:
+	ProcessDiscovery_LINUX(fork_callback on_fork, exit_callback on_exit);
+	virtual ~ProcessDiscovery_LINUX();
+
+	virtual void watch(int32_t pid) override;
+	virtual void unwatch(int32_t pid) override;
+};
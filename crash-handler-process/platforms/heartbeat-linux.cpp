@@ -0,0 +1,143 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "heartbeat-linux.hpp"
+#include "../logger.hpp"
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+HeartbeatChannel *HeartbeatChannel::getInstance()
+{
+	static HeartbeatChannel instance;
+	return &instance;
+}
+
+HeartbeatChannel::HeartbeatChannel()
+{
+	descriptor = memfd_create("crash-handler-heartbeat", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (descriptor < 0) {
+		log_error << "Failed to create heartbeat memfd: " << strerror(errno) << std::endl;
+		return;
+	}
+
+	if (ftruncate(descriptor, sizeof(HeartbeatSegment)) != 0) {
+		log_error << "Failed to size heartbeat memfd: " << strerror(errno) << std::endl;
+		close(descriptor);
+		descriptor = -1;
+		return;
+	}
+
+	// Clients must not be able to shrink the segment under the monitor
+	fcntl(descriptor, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+
+	void *mapped = mmap(nullptr, sizeof(HeartbeatSegment), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	if (mapped == MAP_FAILED) {
+		log_error << "Failed to map heartbeat memfd: " << strerror(errno) << std::endl;
+		close(descriptor);
+		descriptor = -1;
+		return;
+	}
+	segment = static_cast<HeartbeatSegment *>(mapped);
+}
+
+HeartbeatChannel::~HeartbeatChannel()
+{
+	if (segment)
+		munmap(segment, sizeof(HeartbeatSegment));
+	if (descriptor >= 0)
+		close(descriptor);
+}
+
+int32_t HeartbeatChannel::findSlot(int32_t pid)
+{
+	for (int32_t i = 0; i < HEARTBEAT_SLOTS; i++) {
+		if (states[i].pid == pid)
+			return i;
+	}
+	return -1;
+}
+
+int32_t HeartbeatChannel::attach(int32_t pid, uint32_t deadline_ms)
+{
+	if (!segment)
+		return -1;
+
+	const std::lock_guard<std::mutex> lock(mtx);
+
+	int32_t slot = findSlot(pid);
+	if (slot < 0)
+		slot = findSlot(0);
+	if (slot < 0) {
+		log_error << "No free heartbeat slot for pid " << pid << std::endl;
+		return -1;
+	}
+
+	segment->slots[slot].counter.store(0, std::memory_order_relaxed);
+	segment->slots[slot].pid.store(pid, std::memory_order_release);
+
+	states[slot].pid = pid;
+	states[slot].last_counter = 0;
+	states[slot].last_change = std::chrono::steady_clock::now();
+	states[slot].deadline = std::chrono::milliseconds(deadline_ms);
+
+	log_info << "Heartbeat slot " << slot << " attached to pid " << pid << ", deadline " << deadline_ms << " ms" << std::endl;
+	return slot;
+}
+
+void HeartbeatChannel::detach(int32_t pid)
+{
+	if (!segment)
+		return;
+
+	const std::lock_guard<std::mutex> lock(mtx);
+
+	int32_t slot = findSlot(pid);
+	if (slot < 0)
+		return;
+
+	segment->slots[slot].pid.store(0, std::memory_order_release);
+	states[slot] = SlotState();
+}
+
+bool HeartbeatChannel::isStalled(int32_t pid)
+{
+	if (!segment)
+		return false;
+
+	const std::lock_guard<std::mutex> lock(mtx);
+
+	int32_t slot = findSlot(pid);
+	if (slot < 0)
+		return false;
+
+	SlotState &state = states[slot];
+	const uint64_t counter = segment->slots[slot].counter.load(std::memory_order_relaxed);
+	const auto now = std::chrono::steady_clock::now();
+
+	if (counter != state.last_counter) {
+		state.last_counter = counter;
+		state.last_change = now;
+		return false;
+	}
+
+	return now - state.last_change > state.deadline;
+}
@@ -0,0 +1,57 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+
+#include "../heartbeat.hpp"
+
+#include <chrono>
+#include <mutex>
+
+class HeartbeatChannel {
+public:
+	static HeartbeatChannel *getInstance();
+
+	int getDescriptor() const { return descriptor; }
+
+	// Returns the slot assigned to the pid or -1 when no slot is free
+	int32_t attach(int32_t pid, uint32_t deadline_ms);
+	void detach(int32_t pid);
+
+	// Reads the counter of the pid's slot without any syscall. A process that
+	// never attached is never reported as stalled.
+	bool isStalled(int32_t pid);
+
+private:
+	HeartbeatChannel();
+	~HeartbeatChannel();
+
+	struct SlotState {
+		int32_t pid = 0;
+		uint64_t last_counter = 0;
+		std::chrono::steady_clock::time_point last_change;
+		std::chrono::milliseconds deadline{0};
+	};
+
+	int descriptor = -1;
+	HeartbeatSegment *segment = nullptr;
+	SlotState states[HEARTBEAT_SLOTS];
+	std::mutex mtx;
+
+	int32_t findSlot(int32_t pid);
+};
@@ -0,0 +1,251 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../instance-guard.hpp"
+#include "../logger.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// How long a new instance waits for the running one to let go of the lock
+#define INSTANCE_HANDOVER_TIMEOUT_MS 2000
+
+class InstanceGuard_LINUX : public InstanceGuard {
+public:
+	InstanceGuard_LINUX(const std::string &pidPath) : pidPath(pidPath) {}
+	virtual ~InstanceGuard_LINUX();
+
+	virtual bool acquire(std::vector<char> &handedOver) override;
+	virtual void serve(handover_callback handover) override;
+
+private:
+	std::string pidPath;
+	int fd = -1;
+	int listener = -1;
+	std::atomic<bool> stopping{false};
+	std::thread *server = nullptr;
+	// The server releases the descriptors right after a handover, while the destructor may be shutting the listener down
+	std::mutex mtx;
+
+	bool tryLock();
+	void release();
+	void writePid();
+	socklen_t address(sockaddr_un &addr) const;
+	bool requestHandover(std::vector<char> &handedOver);
+	void server_fnc(handover_callback handover);
+};
+
+std::unique_ptr<InstanceGuard> InstanceGuard::create(const std::string &pidPath)
+{
+	return std::make_unique<InstanceGuard_LINUX>(pidPath);
+}
+
+InstanceGuard_LINUX::~InstanceGuard_LINUX()
+{
+	stopping = true;
+	{
+		// Wakes the server from its poll, a listener shut down reports a hangup
+		const std::lock_guard<std::mutex> lock(mtx);
+		if (listener >= 0)
+			shutdown(listener, SHUT_RDWR);
+	}
+	if (server) {
+		if (server->joinable())
+			server->join();
+		delete server;
+	}
+	release();
+}
+
+bool InstanceGuard_LINUX::tryLock()
+{
+	// Open file description locks are tied to this descriptor only, flock is the fallback on older kernels
+	struct flock lock = {};
+	lock.l_type = F_WRLCK;
+	lock.l_whence = SEEK_SET;
+	if (fcntl(fd, F_OFD_SETLK, &lock) == 0)
+		return true;
+	if (errno == EINVAL)
+		return flock(fd, LOCK_EX | LOCK_NB) == 0;
+	return false;
+}
+
+void InstanceGuard_LINUX::release()
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	if (listener >= 0) {
+		close(listener);
+		listener = -1;
+	}
+	// Closing the descriptor drops the lock
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+}
+
+void InstanceGuard_LINUX::writePid()
+{
+	const std::string pid = std::to_string(getpid()) + "\n";
+	if (ftruncate(fd, 0) != 0 || pwrite(fd, pid.data(), pid.size(), 0) != static_cast<ssize_t>(pid.size()))
+		log_info << "Failed to write the pid file " << strerror(errno) << std::endl;
+}
+
+socklen_t InstanceGuard_LINUX::address(sockaddr_un &addr) const
+{
+	// Abstract socket named after the pid file, it disappears with the instance that bound it. The name is
+	// hashed with FNV-1a, which unlike std::hash gives the same name to handlers of different builds.
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (unsigned char c : pidPath) {
+		hash ^= c;
+		hash *= 0x100000001b3ull;
+	}
+	const std::string name = "crash-handler." + std::to_string(hash);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path + 1, name.data(), name.size());
+	return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + name.size());
+}
+
+bool InstanceGuard_LINUX::requestHandover(std::vector<char> &handedOver)
+{
+	sockaddr_un addr;
+	const socklen_t length = address(addr);
+	int client = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (client < 0)
+		return false;
+	if (connect(client, reinterpret_cast<sockaddr *>(&addr), length) < 0) {
+		close(client);
+		return false;
+	}
+
+	const char request = 1;
+	bool received = send(client, &request, 1, MSG_NOSIGNAL) == 1;
+	char buffer[4096];
+	while (received) {
+		pollfd readable = {client, POLLIN, 0};
+		if (poll(&readable, 1, INSTANCE_HANDOVER_TIMEOUT_MS) <= 0) {
+			received = false;
+			break;
+		}
+		ssize_t count = recv(client, buffer, sizeof(buffer), 0);
+		if (count < 0)
+			received = false;
+		if (count <= 0)
+			break;
+		handedOver.insert(handedOver.end(), buffer, buffer + count);
+	}
+	close(client);
+	// The running instance closes the connection without a reply when it refuses
+	return received && !handedOver.empty();
+}
+
+bool InstanceGuard_LINUX::acquire(std::vector<char> &handedOver)
+{
+	fd = open(pidPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		log_info << "Failed to open the pid file " << pidPath << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	if (tryLock()) {
+		writePid();
+		return true;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	if (!requestHandover(handedOver)) {
+		log_info << "The running crash handler did not hand over" << std::endl;
+		handedOver.clear();
+		release();
+		return false;
+	}
+
+	// The previous instance drops the lock right after replying
+	while (!tryLock()) {
+		if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(INSTANCE_HANDOVER_TIMEOUT_MS)) {
+			log_info << "The running crash handler kept the pid file lock" << std::endl;
+			release();
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	writePid();
+	log_info << "Handover from the running crash handler took "
+		 << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() << " us" << std::endl;
+	return true;
+}
+
+void InstanceGuard_LINUX::serve(handover_callback handover)
+{
+	if (fd < 0)
+		return;
+
+	sockaddr_un addr;
+	const socklen_t length = address(addr);
+	listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&addr), length) < 0 || listen(listener, 1) < 0) {
+		log_info << "Failed to listen for a handover " << strerror(errno) << std::endl;
+		if (listener >= 0)
+			close(listener);
+		listener = -1;
+		return;
+	}
+	server = new std::thread(&InstanceGuard_LINUX::server_fnc, this, handover);
+}
+
+void InstanceGuard_LINUX::server_fnc(handover_callback handover)
+{
+	while (!stopping) {
+		pollfd pending = {listener, POLLIN, 0};
+		if (poll(&pending, 1, 500) <= 0)
+			continue;
+
+		int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+		if (client < 0)
+			continue;
+
+		char request = 0;
+		pollfd readable = {client, POLLIN, 0};
+		std::vector<char> state;
+		if (poll(&readable, 1, 100) > 0 && recv(client, &request, 1, 0) == 1 && handover(state)) {
+			size_t sent = 0;
+			while (sent < state.size()) {
+				ssize_t count = send(client, state.data() + sent, state.size() - sent, MSG_NOSIGNAL);
+				if (count <= 0)
+					break;
+				sent += static_cast<size_t>(count);
+			}
+			close(client);
+			// The listener goes first so the next instance can bind the name once it has the lock
+			release();
+			log_info << "Handed over to a new crash handler" << std::endl;
+			return;
+		}
+		close(client);
+	}
+}
@@ -0,0 +1,573 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "minidump-linux.hpp"
+#include "../logger.hpp"
+#include "../metrics.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <codecvt>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <locale>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/utsname.h>
+
+// Memory is read and written in chunks taken by the workers in address order
+#define MINIDUMP_CHUNK_BYTES (8 * 1024 * 1024)
+#define MINIDUMP_MAX_WORKERS 16
+// Kept as the stack of a thread, the rest of its stack mapping is in the memory list too
+#define MINIDUMP_STACK_BYTES (1024 * 1024)
+#define MINIDUMP_RED_ZONE_BYTES 128
+
+uint32_t MinidumpWriter::appendString(const std::string &value)
+{
+	std::u16string text;
+	try {
+		text = std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t>().from_bytes(value);
+	} catch (...) {
+		text.assign(value.begin(), value.end());
+	}
+	const uint32_t rva = begin();
+	put(static_cast<uint32_t>(text.size() * sizeof(char16_t)));
+	append(text.data(), text.size() * sizeof(char16_t));
+	put(static_cast<uint16_t>(0));
+	return rva;
+}
+
+void MinidumpWriter::finish(uint32_t timestamp)
+{
+	const uint32_t header[4] = {MD_SIGNATURE, MD_VERSION, streams, 32};
+	memcpy(&buffer[0], header, sizeof(header));
+	memcpy(&buffer[20], &timestamp, sizeof(timestamp));
+}
+
+#if defined(__x86_64__)
+std::vector<uint8_t> minidump_context(uint32_t flags, const user_regs_struct &regs, const user_fpregs_struct *floats)
+{
+	std::vector<uint8_t> context(MD_CONTEXT_AMD64_SIZE, 0);
+	auto set = [&context](size_t offset, auto value) { memcpy(&context[offset], &value, sizeof(value)); };
+
+	set(48, floats ? flags | MD_CONTEXT_AMD64_FLOATING_POINT : flags);
+	set(56, static_cast<uint16_t>(regs.cs));
+	set(58, static_cast<uint16_t>(regs.ds));
+	set(60, static_cast<uint16_t>(regs.es));
+	set(62, static_cast<uint16_t>(regs.fs));
+	set(64, static_cast<uint16_t>(regs.gs));
+	set(66, static_cast<uint16_t>(regs.ss));
+	set(68, static_cast<uint32_t>(regs.eflags));
+
+	const uint64_t general[] = {regs.rax, regs.rcx, regs.rdx, regs.rbx, regs.rsp, regs.rbp, regs.rsi, regs.rdi,  regs.r8,
+				    regs.r9,  regs.r10, regs.r11, regs.r12, regs.r13, regs.r14, regs.r15, regs.rip};
+	memcpy(&context[120], general, sizeof(general));
+
+	if (floats) {
+		set(52, floats->mxcsr);
+		memcpy(&context[256], floats, sizeof(*floats));
+	}
+	return context;
+}
+#endif
+
+static std::vector<uint8_t> buildId(const std::vector<uint8_t> &header)
+{
+	Elf64_Ehdr ehdr;
+	if (header.size() < sizeof(ehdr) || memcmp(header.data(), ELFMAG, SELFMAG) != 0 || header[EI_CLASS] != ELFCLASS64)
+		return {};
+	memcpy(&ehdr, header.data(), sizeof(ehdr));
+
+	std::vector<uint8_t> id;
+	for (uint16_t i = 0; i < ehdr.e_phnum && id.empty(); i++) {
+		const uint64_t at = ehdr.e_phoff + static_cast<uint64_t>(i) * sizeof(Elf64_Phdr);
+		Elf64_Phdr phdr;
+		if (at + sizeof(phdr) > header.size())
+			break;
+		memcpy(&phdr, header.data() + at, sizeof(phdr));
+		if (phdr.p_type != PT_NOTE || phdr.p_offset + phdr.p_filesz > header.size())
+			continue;
+
+		elf_for_each_note(header.data() + phdr.p_offset, phdr.p_filesz, [&id](std::string_view name, uint32_t type, const uint8_t *desc, size_t size) {
+			if (name == "GNU" && type == NT_GNU_BUILD_ID && id.empty())
+				id.assign(desc, desc + size);
+		});
+	}
+	return id;
+}
+
+void minidump_add_modules(MinidumpWriter &dump, const std::vector<MinidumpModule> &modules)
+{
+	// Name and CodeView record of each module, the record is empty without a build id
+	struct ModuleLocation {
+		uint32_t name;
+		uint32_t cv;
+		uint32_t cvSize;
+	};
+	std::vector<ModuleLocation> locations;
+	for (const MinidumpModule &module : modules) {
+		ModuleLocation location = {dump.appendString(module.path), 0, 0};
+		const std::vector<uint8_t> id = buildId(module.header);
+		if (!id.empty()) {
+			location.cv = dump.begin();
+			location.cvSize = static_cast<uint32_t>(4 + id.size());
+			dump.put(static_cast<uint32_t>(MD_CVINFOELF_SIGNATURE));
+			dump.append(id.data(), id.size());
+		}
+		locations.push_back(location);
+	}
+
+	const uint32_t rva = dump.begin();
+	dump.put(static_cast<uint32_t>(modules.size()));
+	for (size_t i = 0; i < modules.size(); i++) {
+		dump.put(modules[i].base);
+		dump.put(static_cast<uint32_t>(modules[i].end - modules[i].base));
+		dump.zeros(8);
+		dump.put(locations[i].name);
+		// Version information, unused on Linux
+		dump.zeros(52);
+		dump.put(locations[i].cvSize);
+		dump.put(locations[i].cv);
+		dump.zeros(8 + 16);
+	}
+	dump.addStream(MD_MODULE_LIST_STREAM, rva);
+}
+
+void minidump_add_system_info(MinidumpWriter &dump)
+{
+	utsname system = {};
+	uname(&system);
+	uint32_t major = 0, minor = 0, build = 0;
+	sscanf(system.release, "%u.%u.%u", &major, &minor, &build);
+	const uint32_t version = dump.appendString(std::string(system.release) + " " + system.version);
+
+	const uint32_t rva = dump.begin();
+#if defined(__aarch64__)
+	dump.put(static_cast<uint16_t>(MD_CPU_ARCHITECTURE_ARM64));
+#else
+	dump.put(static_cast<uint16_t>(MD_CPU_ARCHITECTURE_AMD64));
+#endif
+	dump.zeros(4);
+	dump.put(static_cast<uint8_t>(std::min<long>(sysconf(_SC_NPROCESSORS_ONLN), 255)));
+	dump.put(static_cast<uint8_t>(0));
+	dump.put(major);
+	dump.put(minor);
+	dump.put(build);
+	dump.put(static_cast<uint32_t>(MD_OS_LINUX));
+	dump.put(version);
+	dump.zeros(4 + 24);
+	dump.addStream(MD_SYSTEM_INFO_STREAM, rva);
+}
+
+namespace {
+
+struct Region {
+	uint64_t start;
+	uint64_t end;
+	// Offset of the region in the memory data at the end of the file
+	uint64_t offset;
+};
+
+struct Chunk {
+	uint64_t address;
+	size_t size;
+	uint64_t position;
+};
+
+bool writeAt(int file, const uint8_t *data, size_t size, uint64_t position)
+{
+	while (size > 0) {
+		const ssize_t written = pwrite(file, data, size, static_cast<off_t>(position));
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+		data += written;
+		size -= written;
+		position += written;
+	}
+	return true;
+}
+
+bool parseMapping(const std::string &line, uint64_t &start, uint64_t &end, char (&permissions)[8], uint64_t &offset, std::string &path)
+{
+	int pathAt = 0;
+	if (sscanf(line.c_str(), "%lx-%lx %7s %lx %*s %*s %n", &start, &end, permissions, &offset, &pathAt) < 4)
+		return false;
+	path = pathAt > 0 ? line.substr(pathAt) : std::string();
+	return true;
+}
+
+// Mappings reading would fault on, or that are not memory of the process
+bool skipMapping(const std::string &path)
+{
+	if (path == "[vvar]" || path == "[vvar_vclock]" || path == "[vsyscall]")
+		return true;
+	return path.rfind("/dev/", 0) == 0 && path.rfind("/dev/shm/", 0) != 0;
+}
+
+// A thread stopped or frozen outside of the kernel reports its stack and instruction pointers last
+bool readThread(int32_t pid, const std::string &tid, uint64_t &sp, uint64_t &ip)
+{
+	std::ifstream syscall("/proc/" + std::to_string(pid) + "/task/" + tid + "/syscall");
+	std::vector<std::string> fields;
+	std::string field;
+	while (syscall >> field)
+		fields.push_back(field);
+	if (fields.size() < 3 || fields[0] == "running")
+		return false;
+	sp = strtoull(fields[fields.size() - 2].c_str(), nullptr, 16);
+	ip = strtoull(fields.back().c_str(), nullptr, 16);
+	return true;
+}
+
+} // namespace
+
+void minidump_read_stack(int32_t pid, uint64_t start, size_t size, std::vector<uint8_t> &stack)
+{
+	// One remote range per page, the read then stops at the top of the stack mapping instead of failing
+	const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+	std::vector<iovec> remote;
+	for (uint64_t address = start, end = start + size; address < end;) {
+		const uint64_t next = std::min(end, (address / page + 1) * page);
+		remote.push_back({reinterpret_cast<void *>(address), static_cast<size_t>(next - address)});
+		address = next;
+	}
+	stack.resize(size);
+	iovec local = {stack.data(), stack.size()};
+	const ssize_t read = process_vm_readv(pid, &local, 1, remote.data(), remote.size(), 0);
+	stack.resize(read > 0 ? static_cast<size_t>(read) : 0);
+}
+
+std::string minidump_read_modules(int32_t pid, std::vector<MinidumpModule> &modules)
+{
+	std::ifstream mapsFile("/proc/" + std::to_string(pid) + "/maps");
+	if (!mapsFile.is_open())
+		return std::string();
+	const std::string maps((std::istreambuf_iterator<char>(mapsFile)), std::istreambuf_iterator<char>());
+
+	std::unordered_map<std::string, size_t> modulesByPath;
+	std::istringstream lines(maps);
+	std::string line, mapping;
+	while (std::getline(lines, line)) {
+		uint64_t start = 0, end = 0, offset = 0;
+		char permissions[8] = {};
+		if (!parseMapping(line, start, end, permissions, offset, mapping) || mapping.empty() || mapping[0] != '/')
+			continue;
+
+		auto it = modulesByPath.find(mapping);
+		if (it != modulesByPath.end()) {
+			modules[it->second].end = std::max(modules[it->second].end, end);
+		} else if (offset == 0) {
+			modulesByPath[mapping] = modules.size();
+			modules.push_back({start, end, mapping, {}});
+		}
+	}
+
+	for (MinidumpModule &module : modules) {
+		module.header.resize(std::min<uint64_t>(module.end - module.base, 4096));
+		iovec local = {module.header.data(), module.header.size()};
+		iovec remote = {reinterpret_cast<void *>(module.base), module.header.size()};
+		const ssize_t read = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+		module.header.resize(read > 0 ? static_cast<size_t>(read) : 0);
+	}
+	return maps;
+}
+
+#if defined(__x86_64__)
+std::vector<uint32_t> minidump_add_threads(MinidumpWriter &dump, const std::vector<MinidumpThread> &threads)
+{
+	// Stacks and contexts first, the thread and memory lists point at them
+	std::vector<uint32_t> stacks;
+	std::vector<uint32_t> contexts;
+	for (const MinidumpThread &thread : threads) {
+		stacks.push_back(dump.appendBlob(thread.stack.data(), thread.stack.size()));
+		contexts.push_back(dump.appendBlob(minidump_context(MD_CONTEXT_AMD64_FULL, thread.regs, thread.hasFloats ? &thread.floats : nullptr).data(), MD_CONTEXT_AMD64_SIZE));
+	}
+
+	uint32_t rva = dump.begin();
+	dump.put(static_cast<uint32_t>(threads.size()));
+	for (size_t i = 0; i < threads.size(); i++) {
+		dump.put(static_cast<uint32_t>(threads[i].tid));
+		dump.zeros(12);
+		dump.put(static_cast<uint64_t>(0));
+		dump.put(threads[i].stackStart);
+		dump.put(static_cast<uint32_t>(threads[i].stack.size()));
+		dump.put(stacks[i]);
+		dump.put(static_cast<uint32_t>(MD_CONTEXT_AMD64_SIZE));
+		dump.put(contexts[i]);
+	}
+	dump.addStream(MD_THREAD_LIST_STREAM, rva);
+
+	rva = dump.begin();
+	dump.put(static_cast<uint32_t>(threads.size()));
+	for (size_t i = 0; i < threads.size(); i++) {
+		dump.put(threads[i].stackStart);
+		dump.put(static_cast<uint32_t>(threads[i].stack.size()));
+		dump.put(stacks[i]);
+	}
+	dump.addStream(MD_MEMORY_LIST_STREAM, rva);
+	return contexts;
+}
+
+bool minidump_write_threads(int32_t pid, const std::vector<MinidumpThread> &threads, const std::string &path)
+{
+	std::vector<MinidumpModule> modules;
+	const std::string maps = minidump_read_modules(pid, modules);
+
+	MinidumpWriter dump(maps.empty() ? 4 : 5);
+	minidump_add_threads(dump, threads);
+	minidump_add_modules(dump, modules);
+	minidump_add_system_info(dump);
+	if (!maps.empty()) {
+		const uint32_t rva = dump.appendBlob(maps.data(), maps.size());
+		dump.addStream(MD_LINUX_MAPS, rva);
+	}
+	dump.finish(static_cast<uint32_t>(time(nullptr)));
+
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char *>(dump.data().data()), dump.size());
+	file.close();
+	if (file.fail()) {
+		log_error << "Failed to write " << path << std::endl;
+		remove(path.c_str());
+		return false;
+	}
+	return true;
+}
+#endif
+
+bool minidump_write_process(int32_t pid, const std::string &path, const MinidumpCrash *crash)
+{
+	static MetricHistogram &duration = Metrics::getInstance()->histogram("crash_handler_memory_dump_seconds", "Time to write a memory dump", 1e-6);
+	static MetricCounter &dumped = Metrics::getInstance()->counter("crash_handler_memory_dump_bytes_total", "Process memory written to memory dumps");
+	const auto started = std::chrono::steady_clock::now();
+
+	std::vector<MinidumpModule> modules;
+	const std::string maps = minidump_read_modules(pid, modules);
+	if (maps.empty()) {
+		log_error << "Failed to read the mappings of pid " << pid << std::endl;
+		return false;
+	}
+
+	std::vector<Region> regions;
+	uint64_t total = 0;
+	std::istringstream lines(maps);
+	std::string line, mapping;
+	while (std::getline(lines, line)) {
+		uint64_t start = 0, end = 0, offset = 0;
+		char permissions[8] = {};
+		if (!parseMapping(line, start, end, permissions, offset, mapping) || permissions[0] != 'r' || skipMapping(mapping))
+			continue;
+		regions.push_back({start, end, total});
+		total += end - start;
+	}
+
+	struct Thread {
+		int32_t tid;
+		uint64_t sp;
+		uint64_t ip;
+	};
+	std::vector<Thread> threads;
+	std::error_code error;
+	for (const auto &entry : std::filesystem::directory_iterator("/proc/" + std::to_string(pid) + "/task", error)) {
+		Thread thread = {static_cast<int32_t>(atoi(entry.path().filename().c_str())), 0, 0};
+		if (readThread(pid, entry.path().filename().string(), thread.sp, thread.ip))
+			threads.push_back(thread);
+	}
+
+	const bool exception = crash && crash->signal;
+	MinidumpWriter dump(exception ? 6 : 5);
+	minidump_add_modules(dump, modules);
+	minidump_add_system_info(dump);
+	uint32_t rva = dump.appendBlob(maps.data(), maps.size());
+	dump.addStream(MD_LINUX_MAPS, rva);
+
+	// Only the stack and instruction pointers are known without tracing the process, enough to walk the stacks
+	std::vector<uint32_t> contexts;
+	uint32_t crashedContext = 0;
+#if defined(__x86_64__)
+	for (Thread &thread : threads) {
+		user_regs_struct regs = {};
+		uint32_t flags = MD_CONTEXT_AMD64_CONTROL;
+		if (crash && crash->registers.count(thread.tid)) {
+			// Read from the held thread by the caller, the stack is found from its stack pointer too
+			regs = crash->registers.at(thread.tid);
+			flags = MD_CONTEXT_AMD64_FULL;
+			thread.sp = regs.rsp;
+			thread.ip = regs.rip;
+		} else {
+			regs.rsp = thread.sp;
+			regs.rip = thread.ip;
+		}
+		contexts.push_back(dump.appendBlob(minidump_context(flags, regs, nullptr).data(), MD_CONTEXT_AMD64_SIZE));
+		if (exception && thread.tid == crash->tid)
+			crashedContext = contexts.back();
+	}
+#else
+	threads.clear();
+#endif
+
+	if (exception) {
+		rva = dump.begin();
+		dump.put(static_cast<uint32_t>(crash->tid));
+		dump.put(static_cast<uint32_t>(0));
+		dump.put(static_cast<uint32_t>(crash->signal));
+		dump.put(static_cast<uint32_t>(crash->code));
+		dump.put(static_cast<uint64_t>(0));
+		dump.put(crash->address);
+		dump.zeros(8 + 15 * 8);
+		dump.put(static_cast<uint32_t>(crashedContext ? MD_CONTEXT_AMD64_SIZE : 0));
+		dump.put(crashedContext);
+		dump.addStream(MD_EXCEPTION_STREAM, rva);
+	}
+
+	// Stacks point into the memory data, whose place is known once the list of ranges is laid out
+	std::vector<uint32_t> stackFields;
+	rva = dump.begin();
+	dump.put(static_cast<uint32_t>(threads.size()));
+	for (size_t i = 0; i < threads.size(); i++) {
+		dump.put(static_cast<uint32_t>(threads[i].tid));
+		dump.zeros(12);
+		dump.put(static_cast<uint64_t>(0));
+		stackFields.push_back(dump.size());
+		dump.zeros(16);
+		dump.put(static_cast<uint32_t>(MD_CONTEXT_AMD64_SIZE));
+		dump.put(contexts[i]);
+	}
+	dump.addStream(MD_THREAD_LIST_STREAM, rva);
+
+	rva = dump.begin();
+	const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+	const uint64_t base = (static_cast<uint64_t>(rva) + 16 + 16 * regions.size() + page - 1) / page * page;
+	dump.put(static_cast<uint64_t>(regions.size()));
+	dump.put(base);
+	for (const Region &region : regions) {
+		dump.put(region.start);
+		dump.put(region.end - region.start);
+	}
+	dump.addStream(MD_MEMORY_64_LIST_STREAM, rva);
+
+	for (size_t i = 0; i < threads.size(); i++) {
+		auto region = std::find_if(regions.begin(), regions.end(), [&](const Region &r) { return threads[i].sp >= r.start && threads[i].sp < r.end; });
+		if (region == regions.end())
+			continue;
+		const uint64_t start = threads[i].sp - std::min<uint64_t>(MINIDUMP_RED_ZONE_BYTES, threads[i].sp - region->start);
+		const uint64_t position = base + region->offset + (start - region->start);
+		// Descriptors have 32 bit offsets, stacks further in the file are found through the memory list
+		if (position + MINIDUMP_STACK_BYTES > UINT32_MAX)
+			continue;
+		dump.patch(stackFields[i], start);
+		dump.patch(stackFields[i] + 8, static_cast<uint32_t>(std::min<uint64_t>(region->end - start, MINIDUMP_STACK_BYTES)));
+		dump.patch(stackFields[i] + 12, static_cast<uint32_t>(position));
+	}
+	dump.finish(static_cast<uint32_t>(time(nullptr)));
+
+	int file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (file < 0) {
+		log_error << "Failed to create memory dump " << path << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	// The file is sized first, pages that can not be read stay as holes of zeros
+	if (ftruncate(file, static_cast<off_t>(base + total)) != 0 || !writeAt(file, dump.data().data(), dump.size(), 0)) {
+		log_error << "Failed to write memory dump " << path << ": " << strerror(errno) << std::endl;
+		close(file);
+		return false;
+	}
+
+	std::vector<Chunk> chunks;
+	for (const Region &region : regions) {
+		for (uint64_t address = region.start; address < region.end; address += MINIDUMP_CHUNK_BYTES)
+			chunks.push_back({address, static_cast<size_t>(std::min<uint64_t>(MINIDUMP_CHUNK_BYTES, region.end - address)), base + region.offset + (address - region.start)});
+	}
+
+	// process_vm_readv copies from the pages of the process straight into the buffer, where /proc/<pid>/mem goes through a kernel page
+	std::atomic<size_t> next{0};
+	std::atomic<uint64_t> unreadable{0};
+	std::atomic<bool> failed{false};
+	std::atomic<int> readError{0};
+	auto worker = [&]() {
+		std::vector<uint8_t> buffer(MINIDUMP_CHUNK_BYTES);
+		for (size_t i = next++; i < chunks.size() && !failed; i = next++) {
+			const Chunk &chunk = chunks[i];
+			// Read bytes from written on are not in the file yet
+			size_t done = 0, written = 0;
+			while (done < chunk.size && !failed) {
+				iovec local = {buffer.data() + done, chunk.size - done};
+				iovec remote = {reinterpret_cast<void *>(chunk.address + done), chunk.size - done};
+				const ssize_t read = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+				if (read > 0) {
+					done += read;
+					continue;
+				}
+				// Only EFAULT is a page that can not be read, anything else (ESRCH, EPERM) fails the whole dump
+				if (read < 0 && errno != EFAULT) {
+					readError = errno;
+					failed = true;
+					break;
+				}
+
+				// A read stops at a page that can not be read, the file keeps zeros there
+				if (done > written && !writeAt(file, buffer.data() + written, done - written, chunk.position + written))
+					failed = true;
+				const size_t skipped = static_cast<size_t>(std::min<uint64_t>(page - (chunk.address + done) % page, chunk.size - done));
+				unreadable += skipped;
+				done += skipped;
+				written = done;
+			}
+			if (!failed && done > written && !writeAt(file, buffer.data() + written, done - written, chunk.position + written))
+				failed = true;
+		}
+	};
+
+	const size_t count = std::max<size_t>(1, std::min<size_t>({std::thread::hardware_concurrency(), MINIDUMP_MAX_WORKERS, chunks.size()}));
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < count; i++)
+		workers.push_back(std::thread(worker));
+	worker();
+	for (auto &thread : workers)
+		thread.join();
+	close(file);
+
+	if (failed) {
+		if (readError)
+			log_error << "Failed to read the memory of pid " << pid << " for dump " << path << ": " << strerror(readError) << std::endl;
+		else
+			log_error << "Failed to write memory dump " << path << " of pid " << pid << std::endl;
+		remove(path.c_str());
+		return false;
+	}
+
+	const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+	duration.record(elapsed.count());
+	dumped.add(total - unreadable);
+	log_info << "Memory dump of pid " << pid << " written to " << path << ": " << regions.size() << " regions, " << (total - unreadable) / 1024 << " KB, "
+		 << unreadable / 1024 << " KB unreadable, " << threads.size() << " threads, " << count << " workers in " << elapsed.count() / 1000 << " ms"
+		 << std::endl;
+	return true;
+}
@@ -0,0 +1,176 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/user.h>
+
+// Minidump layout, as read by the Breakpad and Crashpad processors
+#define MD_SIGNATURE 0x504d444d
+#define MD_VERSION 0xa793
+#define MD_THREAD_LIST_STREAM 3
+#define MD_MODULE_LIST_STREAM 4
+#define MD_MEMORY_LIST_STREAM 5
+#define MD_EXCEPTION_STREAM 6
+#define MD_SYSTEM_INFO_STREAM 7
+#define MD_MEMORY_64_LIST_STREAM 9
+#define MD_LINUX_MAPS 0x47670009
+#define MD_CPU_ARCHITECTURE_AMD64 9
+#define MD_CPU_ARCHITECTURE_ARM64 12
+#define MD_OS_LINUX 0x8201
+#define MD_CONTEXT_AMD64 0x00100000
+#define MD_CONTEXT_AMD64_CONTROL (MD_CONTEXT_AMD64 | 0x1)
+#define MD_CONTEXT_AMD64_FULL (MD_CONTEXT_AMD64 | 0x7)
+#define MD_CONTEXT_AMD64_FLOATING_POINT (MD_CONTEXT_AMD64 | 0x8)
+#define MD_CONTEXT_AMD64_SIZE 1232
+#define MD_CVINFOELF_SIGNATURE 0x4270454c
+
+// Builds the start of a minidump in memory. Blobs are appended one after the
+// other, and each stream is listed in the directory reserved after the header.
+class MinidumpWriter {
+public:
+	MinidumpWriter(uint32_t streams) : directory(32), buffer(32 + streams * 12, 0) {}
+
+	uint32_t size() const { return static_cast<uint32_t>(buffer.size()); }
+	const std::vector<uint8_t> &data() const { return buffer; }
+
+	template<typename T> void put(T value) { append(&value, sizeof(value)); }
+	// Overwrites a value put earlier, for offsets known only once later blobs are laid out
+	template<typename T> void patch(uint32_t offset, T value) { memcpy(&buffer[offset], &value, sizeof(value)); }
+
+	void append(const void *data, size_t size)
+	{
+		const uint8_t *bytes = static_cast<const uint8_t *>(data);
+		buffer.insert(buffer.end(), bytes, bytes + size);
+	}
+
+	void zeros(size_t size) { buffer.insert(buffer.end(), size, 0); }
+
+	// Starts a blob on a 4 byte boundary, returns its offset
+	uint32_t begin()
+	{
+		buffer.resize((buffer.size() + 3) & ~static_cast<size_t>(3), 0);
+		return size();
+	}
+
+	uint32_t appendBlob(const void *data, size_t size)
+	{
+		const uint32_t rva = begin();
+		append(data, size);
+		return rva;
+	}
+
+	// MINIDUMP_STRING, UTF-16 with its byte length
+	uint32_t appendString(const std::string &value);
+
+	void addStream(uint32_t type, uint32_t rva)
+	{
+		const uint32_t entry[3] = {type, size() - rva, rva};
+		memcpy(&buffer[directory], entry, sizeof(entry));
+		directory += sizeof(entry);
+		streams++;
+	}
+
+	void finish(uint32_t timestamp);
+
+private:
+	size_t directory;
+	uint32_t streams = 0;
+	std::vector<uint8_t> buffer;
+};
+
+struct MinidumpModule {
+	uint64_t base = 0;
+	uint64_t end = 0;
+	std::string path;
+	// First page of the module, where the kernel and loader keep its ELF headers
+	std::vector<uint8_t> header;
+};
+
+// Calls visit(name, type, desc, size) for each note of an ELF note segment
+template<typename F> void elf_for_each_note(const uint8_t *data, size_t size, F visit)
+{
+	auto align4 = [](size_t value) { return (value + 3) & ~static_cast<size_t>(3); };
+	size_t at = 0;
+	while (at + 12 <= size) {
+		uint32_t header[3];
+		memcpy(header, data + at, sizeof(header));
+		const size_t name = at + 12;
+		const size_t desc = name + align4(header[0]);
+		if (desc + header[1] > size)
+			break;
+
+		const char *text = reinterpret_cast<const char *>(data + name);
+		visit(std::string_view(text, header[0] ? strnlen(text, header[0]) : 0), header[2], data + desc, static_cast<size_t>(header[1]));
+		at = desc + align4(header[1]);
+	}
+}
+
+#if defined(__x86_64__)
+struct MinidumpThread {
+	int32_t tid = 0;
+	user_regs_struct regs = {};
+	bool hasFloats = false;
+	user_fpregs_struct floats = {};
+	uint64_t stackStart = 0;
+	std::vector<uint8_t> stack;
+};
+
+// CONTEXT_AMD64 of a thread, with the registers flags says are valid. floats may be null.
+std::vector<uint8_t> minidump_context(uint32_t flags, const user_regs_struct &regs, const user_fpregs_struct *floats);
+
+// Appends the stacks and contexts, then the thread and memory lists pointing at them. Returns where each context is.
+std::vector<uint32_t> minidump_add_threads(MinidumpWriter &dump, const std::vector<MinidumpThread> &threads);
+
+// Writes threads captured earlier with their stacks, and the modules of the process, without any other memory
+bool minidump_write_threads(int32_t pid, const std::vector<MinidumpThread> &threads, const std::string &path);
+#endif
+
+void minidump_add_modules(MinidumpWriter &dump, const std::vector<MinidumpModule> &modules);
+void minidump_add_system_info(MinidumpWriter &dump);
+
+// Reads up to size bytes of a stack from start, cut short at the end of its mapping
+void minidump_read_stack(int32_t pid, uint64_t start, size_t size, std::vector<uint8_t> &stack);
+
+// Mappings of a running process, with the modules mapped from their start and their first page.
+// Returns an empty string when the mappings can not be read.
+std::string minidump_read_modules(int32_t pid, std::vector<MinidumpModule> &modules);
+
+// What the caller knows of a process it holds: the registers it read from
+// its threads, and the signal the dump is written for when signal is set.
+struct MinidumpCrash {
+	int32_t tid = 0;
+	int32_t signal = 0;
+	int32_t code = 0;
+	uint64_t address = 0;
+#if defined(__x86_64__)
+	std::map<int32_t, user_regs_struct> registers;
+#endif
+};
+
+// Writes every readable mapping of a running process, read by a pool of
+// workers straight to their place in the file. The process is expected to
+// be stopped or frozen by the caller. Without crash, the threads only have
+// the stack and instruction pointers read from /proc.
+bool minidump_write_process(int32_t pid, const std::string &path, const MinidumpCrash *crash = nullptr);
@@ -0,0 +1,262 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../process-freezer.hpp"
+#include "../logger.hpp"
+#include "minidump-linux.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define PROCESS_FREEZER_STACK_BYTES (16 * 1024)
+
+namespace {
+
+bool writeValue(const std::string &path, const std::string &value)
+{
+	int file = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+	if (file < 0)
+		return false;
+	const bool written = write(file, value.c_str(), value.size()) == static_cast<ssize_t>(value.size());
+	close(file);
+	return written;
+}
+
+// Where the unified hierarchy is mounted, cgroup paths of processes are relative to it
+std::string cgroupRoot()
+{
+	std::ifstream mounts("/proc/self/mountinfo");
+	std::string line;
+	while (std::getline(mounts, line)) {
+		const size_t separator = line.find(" - ");
+		if (separator == std::string::npos || line.compare(separator + 3, 8, "cgroup2 ") != 0)
+			continue;
+
+		std::istringstream fields(line.substr(0, separator));
+		std::string field;
+		for (int i = 0; i < 5 && fields >> field; i++)
+			;
+		return field;
+	}
+	return std::string();
+}
+
+std::string cgroupOf(int32_t pid)
+{
+	std::ifstream cgroup("/proc/" + std::to_string(pid) + "/cgroup");
+	std::string line;
+	while (std::getline(cgroup, line)) {
+		if (line.rfind("0::", 0) == 0)
+			return line.substr(3);
+	}
+	return std::string();
+}
+
+} // namespace
+
+class ProcessFreezer_LINUX : public ProcessFreezer {
+public:
+	ProcessFreezer_LINUX(const std::string &root, const std::string &path) : root(root), path(path) {}
+	virtual ~ProcessFreezer_LINUX();
+
+	virtual bool add(int32_t pid) override;
+	virtual void remove(int32_t pid) override;
+
+	virtual bool freeze(std::chrono::milliseconds timeout) override;
+	virtual void thaw() override;
+	virtual std::vector<int32_t> members() override;
+
+	virtual bool capture(int32_t pid, CrashSnapshot &snapshot) override;
+
+private:
+	std::string root;
+	std::string path;
+	std::mutex mtx;
+	// Group each member was added from, relative to root
+	std::unordered_map<int32_t, std::string> origins;
+
+	bool isFrozen();
+};
+
+std::unique_ptr<ProcessFreezer> ProcessFreezer::create(const std::string &parent)
+{
+	const std::string root = cgroupRoot();
+	if (root.empty()) {
+		log_info << "No cgroup v2 hierarchy is mounted" << std::endl;
+		return nullptr;
+	}
+
+	// Sessions of one handler each get their group
+	static std::atomic<uint32_t> groups{0};
+	const std::string path = parent + "/crash-handler-" + std::to_string(getpid()) + "-" + std::to_string(groups++);
+	if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+		log_info << "Failed to create cgroup " << path << ": " << strerror(errno) << std::endl;
+		return nullptr;
+	}
+	// The freezer of the unified hierarchy came with Linux 5.2
+	if (access((path + "/cgroup.freeze").c_str(), W_OK) != 0) {
+		log_info << "Cgroup " << path << " can not be frozen" << std::endl;
+		rmdir(path.c_str());
+		return nullptr;
+	}
+	log_info << "Registered processes are grouped in " << path << std::endl;
+	return std::make_unique<ProcessFreezer_LINUX>(root, path);
+}
+
+ProcessFreezer_LINUX::~ProcessFreezer_LINUX()
+{
+	thaw();
+	// Members still running go back where they came from, the group is removed once empty
+	for (int32_t pid : members())
+		remove(pid);
+	if (rmdir(path.c_str()) != 0)
+		log_info << "Failed to remove cgroup " << path << ": " << strerror(errno) << std::endl;
+}
+
+bool ProcessFreezer_LINUX::add(int32_t pid)
+{
+	const std::string origin = cgroupOf(pid);
+	if (origin.empty() || !writeValue(path + "/cgroup.procs", std::to_string(pid))) {
+		log_info << "Failed to move pid " << pid << " to cgroup " << path << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	const std::lock_guard<std::mutex> lock(this->mtx);
+	this->origins[pid] = origin;
+	return true;
+}
+
+void ProcessFreezer_LINUX::remove(int32_t pid)
+{
+	std::string origin;
+	{
+		const std::lock_guard<std::mutex> lock(this->mtx);
+		auto it = this->origins.find(pid);
+		if (it != this->origins.end()) {
+			origin = it->second;
+			this->origins.erase(it);
+		}
+	}
+	// Children found in the group go where their parent was taken from, or to the parent of the group
+	if (origin.empty())
+		origin = cgroupOf(getpid());
+	if (!writeValue(this->root + origin + "/cgroup.procs", std::to_string(pid)) && errno != ESRCH)
+		log_info << "Failed to move pid " << pid << " out of cgroup " << path << ": " << strerror(errno) << std::endl;
+}
+
+bool ProcessFreezer_LINUX::isFrozen()
+{
+	std::ifstream events(path + "/cgroup.events");
+	std::string line;
+	while (std::getline(events, line)) {
+		if (line == "frozen 1")
+			return true;
+	}
+	return false;
+}
+
+bool ProcessFreezer_LINUX::freeze(std::chrono::milliseconds timeout)
+{
+	if (!writeValue(path + "/cgroup.freeze", "1")) {
+		log_info << "Failed to freeze cgroup " << path << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	// The kernel notifies a change of cgroup.events as an exceptional condition
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	int events = open((path + "/cgroup.events").c_str(), O_RDONLY | O_CLOEXEC);
+	bool frozen = isFrozen();
+	while (!frozen && events >= 0) {
+		const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+		if (left.count() <= 0)
+			break;
+		// Reading the file arms the notification
+		char buffer[256];
+		if (pread(events, buffer, sizeof(buffer), 0) < 0)
+			break;
+		pollfd descriptor = {events, POLLPRI, 0};
+		poll(&descriptor, 1, static_cast<int>(left.count()));
+		frozen = isFrozen();
+	}
+	if (events >= 0)
+		close(events);
+	return frozen;
+}
+
+void ProcessFreezer_LINUX::thaw()
+{
+	writeValue(path + "/cgroup.freeze", "0");
+}
+
+std::vector<int32_t> ProcessFreezer_LINUX::members()
+{
+	std::vector<int32_t> pids;
+	std::ifstream procs(path + "/cgroup.procs");
+	int32_t pid = 0;
+	while (procs >> pid)
+		pids.push_back(pid);
+	return pids;
+}
+
+bool ProcessFreezer_LINUX::capture(int32_t pid, CrashSnapshot &snapshot)
+{
+	// A frozen thread reports its user stack and instruction pointers as the last two fields
+	std::error_code error;
+	const std::string task = "/proc/" + std::to_string(pid) + "/task";
+	for (const auto &entry : std::filesystem::directory_iterator(task, error)) {
+		std::ifstream syscall(entry.path() / "syscall");
+		std::vector<std::string> fields;
+		std::string field;
+		while (syscall >> field)
+			fields.push_back(field);
+		if (fields.size() < 3 || fields[0] == "running")
+			continue;
+
+		CrashThreadState state;
+		state.tid = static_cast<int32_t>(std::stol(entry.path().filename().string()));
+		state.stack_pointer = std::stoull(fields[fields.size() - 2], nullptr, 16);
+		state.instruction_pointer = std::stoull(fields.back(), nullptr, 16);
+		if (state.tid == pid) {
+			snapshot.context.pid = pid;
+			snapshot.context.tid = pid;
+			snapshot.context.stack_pointer = state.stack_pointer;
+			snapshot.context.instruction_pointer = state.instruction_pointer;
+		} else {
+			snapshot.threads.push_back(state);
+		}
+	}
+	if (!snapshot.context.stack_pointer)
+		return false;
+
+	minidump_read_stack(pid, snapshot.context.stack_pointer, PROCESS_FREEZER_STACK_BYTES, snapshot.stack);
+	snapshot.stack_address = snapshot.context.stack_pointer;
+	return true;
+}
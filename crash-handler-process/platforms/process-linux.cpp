@@ -0,0 +1,101 @@
+#include "process-linux.hpp"
+#include "heartbeat-linux.hpp"
+#include "../logger.hpp"
+#include "../window-index.hpp"
+
+#include <string>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+std::unique_ptr<Process> Process::create(int32_t pid, bool isCritical)
+{
+	return std::make_unique<Process_LINUX>(pid, isCritical);
+}
+
+std::unique_ptr<WindowSource> WindowSource::create()
+{
+	return nullptr;
+}
+
+Process_LINUX::Process_LINUX(int32_t pid, bool isCritical)
+{
+	PID = pid;
+	critical = isCritical;
+	alive = true;
+	stat_fd = open(("/proc/" + std::to_string(pid) + "/stat").c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+Process_LINUX::~Process_LINUX()
+{
+	HeartbeatChannel::getInstance()->detach(PID);
+	if (stat_fd >= 0)
+		close(stat_fd);
+}
+
+int32_t Process_LINUX::getPID(void)
+{
+	return PID;
+}
+
+bool Process_LINUX::isValid(void)
+{
+	return true;
+}
+
+bool Process_LINUX::isCritical(void)
+{
+	return critical;
+}
+
+bool Process_LINUX::isUnResponsive(void)
+{
+	// Only processes that asked for a heartbeat slot can be reported, the others have no main loop we know of
+	return HeartbeatChannel::getInstance()->isStalled(PID);
+}
+
+void Process_LINUX::startMemoryDumpMonitoring(const std::wstring &eventName_Start, const std::wstring &eventName_Fail, const std::wstring &eventName_Success,
+					      const std::wstring &dumpPath, const std::wstring &dumpName)
+{
+	memoryDumpPath = dumpPath;
+	memoryDumpName = dumpName;
+}
+
+bool Process_LINUX::getMemoryDumpRequest(std::wstring &dumpPath, std::wstring &dumpName)
+{
+	if (memoryDumpName.empty())
+		return false;
+	dumpPath = memoryDumpPath;
+	dumpName = memoryDumpName;
+	return true;
+}
+
+bool Process_LINUX::startHeartbeatMonitoring(uint32_t deadline_ms, int32_t &slot, int &descriptor)
+{
+	HeartbeatChannel *channel = HeartbeatChannel::getInstance();
+	slot = channel->attach(PID, deadline_ms);
+	descriptor = channel->getDescriptor();
+	return slot >= 0;
+}
+
+bool Process_LINUX::isAlive(void)
+{
+	if (stat_fd < 0)
+		return kill(PID, 0) == 0 || errno == EPERM;
+
+	// Reading fails once the process is reaped. Until then a zombie is not alive either.
+	char buffer[512];
+	ssize_t bytes = pread(stat_fd, buffer, sizeof(buffer) - 1, 0);
+	if (bytes <= 0)
+		return false;
+	buffer[bytes] = 0;
+
+	const char *state = strrchr(buffer, ')');
+	return state && state[1] == ' ' && state[2] != 'Z' && state[2] != 'X';
+}
+
+void Process_LINUX::terminate(void)
+{
+	kill(PID, SIGKILL);
+}
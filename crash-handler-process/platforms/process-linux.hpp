@@ -0,0 +1,28 @@
+#include "../process.hpp"
+
+class Process_LINUX : public Process {
+private:
+	// Kept open so liveness is one pread, and so a recycled pid is never mistaken for this process
+	int stat_fd = -1;
+	// Written by the crash handler, there are no named events to signal the process with
+	std::wstring memoryDumpPath;
+	std::wstring memoryDumpName;
+
+public:
+	Process_LINUX(int32_t pid, bool isCritical);
+	virtual ~Process_LINUX();
+
+public:
+	virtual int32_t getPID(void) override;
+	virtual bool isValid(void) override;
+	virtual bool isCritical(void) override;
+	virtual bool isAlive(void) override;
+	virtual bool isUnResponsive(void) override;
+	virtual void terminate(void) override;
+
+public:
+	virtual void startMemoryDumpMonitoring(const std::wstring &eventName_Start, const std::wstring &eventName_Fail, const std::wstring &eventName_Success,
+					       const std::wstring &dumpPath, const std::wstring &dumpName) override;
+	virtual bool getMemoryDumpRequest(std::wstring &dumpPath, std::wstring &dumpName) override;
+	virtual bool startHeartbeatMonitoring(uint32_t deadline_ms, int32_t &slot, int &descriptor) override;
+};
@@ -2,6 +2,16 @@
 #include <Cocoa/Cocoa.h>
 #include <iostream>
 #include "../logger.hpp"
+#include "../window-index.hpp"
+#include "../discovery.hpp"
+#include "../termination.hpp"
+#include "../instance-guard.hpp"
+#include "../connection-watcher.hpp"
+#include "../crash-context.hpp"
+#include "../crash-interceptor.hpp"
+#include "../core-ingest.hpp"
+#include "../process-freezer.hpp"
+#include "../thread-monitor.hpp"
 
 #include <libproc.h>
 #include <stdio.h>
@@ -12,6 +22,66 @@ std::unique_ptr<Process> Process::create(int32_t pid, bool isCritical)
 	return std::make_unique<Process_OSX>(pid, isCritical);
 }
 
+std::unique_ptr<WindowSource> WindowSource::create()
+{
+	return nullptr;
+}
+
+std::unique_ptr<TelemetrySampler> TelemetrySampler::create(int32_t pid)
+{
+	return nullptr;
+}
+
+std::unique_ptr<ProcessDiscovery> ProcessDiscovery::create(fork_callback on_fork, exit_callback on_exit)
+{
+	return nullptr;
+}
+
+std::unique_ptr<TerminationEngine> TerminationEngine::create()
+{
+	return nullptr;
+}
+
+std::unique_ptr<ConnectionWatcher> ConnectionWatcher::create(close_callback on_close)
+{
+	return nullptr;
+}
+
+std::unique_ptr<CrashContextChannel> CrashContextChannel::create(report_callback on_report)
+{
+	return nullptr;
+}
+
+std::unique_ptr<CrashInterceptor> CrashInterceptor::create(crash_callback on_crash)
+{
+	return nullptr;
+}
+
+bool core_ingest(int input, CoreCrash &crash, const std::wstring &directory, std::wstring &written)
+{
+	return false;
+}
+
+bool core_take_ownership(uint32_t uid, uint32_t gid, const std::wstring &directory, const std::wstring &log)
+{
+	return false;
+}
+
+std::unique_ptr<ProcessFreezer> ProcessFreezer::create(const std::string &parent)
+{
+	return nullptr;
+}
+
+std::unique_ptr<ThreadMonitor> ThreadMonitor::create(int32_t pid)
+{
+	return nullptr;
+}
+
+std::unique_ptr<InstanceGuard> InstanceGuard::create(const std::string &pidPath)
+{
+	return nullptr;
+}
+
 Process_OSX::Process_OSX(int32_t pid, bool isCritical)
 {
 	PID = pid;
@@ -35,7 +105,7 @@ bool Process_OSX::isCritical(void)
 }
 bool Process_OSX::isUnResponsive(void)
 {
-	return false; // check for responsiveness not impemented
+	return false; // check for responsiveness not implemented
 }
 void Process_OSX::startMemoryDumpMonitoring(const std::wstring &eventName_Start, const std::wstring &eventName_Fail, const std::wstring &eventName_Success,
 					    const std::wstring &dumpPath, const std::wstring &dumpName)
@@ -43,6 +113,11 @@ void Process_OSX::startMemoryDumpMonitoring(const std::wstring &eventName_Start,
 	return;
 }
 
+bool Process_OSX::startHeartbeatMonitoring(uint32_t deadline_ms, int32_t &slot, int &descriptor)
+{
+	return false; // heartbeat channel not implemented
+}
+
 bool Process_OSX::isAlive(void)
 {
 	struct proc_bsdinfo proc;
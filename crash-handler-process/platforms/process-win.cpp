@@ -18,6 +18,18 @@
 
 #include "process-win.hpp"
 #include "../util.hpp"
+#include "../window-index.hpp"
+#include "../discovery.hpp"
+#include "../termination.hpp"
+#include "../instance-guard.hpp"
+#include "../connection-watcher.hpp"
+#include "../crash-context.hpp"
+#include "../crash-interceptor.hpp"
+#include "../core-ingest.hpp"
+#include "../process-freezer.hpp"
+#include "../thread-monitor.hpp"
+#include "../metrics.hpp"
+#include "../trace.hpp"
 #include "upload-window-win.hpp"
 #include <iomanip>
 #include <ctime>
@@ -25,21 +37,83 @@
 #include "Shlobj.h"
 #pragma comment(lib, "Shell32.lib")
 
-struct handle_data {
-	unsigned long process_id;
-	HWND window_handle;
-};
+typedef std::function<void(int32_t pid, uintptr_t window)> window_visitor;
 
 BOOL CALLBACK enum_windows_callback(HWND handle, LPARAM lParam)
 {
-	handle_data &data = *(handle_data *)lParam;
+	const window_visitor &visit = *(const window_visitor *)lParam;
+	if (!(GetWindow(handle, GW_OWNER) == (HWND)0))
+		return TRUE;
+
 	unsigned long process_id = 0;
 	GetWindowThreadProcessId(handle, &process_id);
-	if (data.process_id != process_id || !(GetWindow(handle, GW_OWNER) == (HWND)0))
-		return TRUE;
+	visit(static_cast<int32_t>(process_id), reinterpret_cast<uintptr_t>(handle));
+	return TRUE;
+}
+
+class WindowSource_WIN : public WindowSource {
+public:
+	virtual void enumerate(const window_visitor &visit) override { EnumWindows(enum_windows_callback, (LPARAM)&visit); }
+};
+
+std::unique_ptr<WindowSource> WindowSource::create()
+{
+	return std::make_unique<WindowSource_WIN>();
+}
+
+std::unique_ptr<TelemetrySampler> TelemetrySampler::create(int32_t pid)
+{
+	return nullptr; // resource telemetry is only sampled on Linux
+}
+
+std::unique_ptr<ProcessDiscovery> ProcessDiscovery::create(fork_callback on_fork, exit_callback on_exit)
+{
+	return nullptr;
+}
+
+std::unique_ptr<TerminationEngine> TerminationEngine::create()
+{
+	return nullptr;
+}
+
+std::unique_ptr<ConnectionWatcher> ConnectionWatcher::create(close_callback on_close)
+{
+	return nullptr;
+}
+
+std::unique_ptr<CrashContextChannel> CrashContextChannel::create(report_callback on_report)
+{
+	return nullptr;
+}
+
+std::unique_ptr<CrashInterceptor> CrashInterceptor::create(crash_callback on_crash)
+{
+	return nullptr;
+}
+
+bool core_ingest(int input, CoreCrash &crash, const std::wstring &directory, std::wstring &written)
+{
+	return false;
+}
+
+bool core_take_ownership(uint32_t uid, uint32_t gid, const std::wstring &directory, const std::wstring &log)
+{
+	return false;
+}
+
+std::unique_ptr<ProcessFreezer> ProcessFreezer::create(const std::string &parent)
+{
+	return nullptr;
+}
+
+std::unique_ptr<ThreadMonitor> ThreadMonitor::create(int32_t pid)
+{
+	return nullptr;
+}
 
-	data.window_handle = handle;
-	return FALSE;
+std::unique_ptr<InstanceGuard> InstanceGuard::create(const std::string &pidPath)
+{
+	return nullptr;
 }
 
 std::unique_ptr<Process> Process::create(int32_t pid, bool isCritical)
@@ -141,8 +215,15 @@ void Process_WIN::startMemoryDumpMonitoring(const std::wstring &eventName_Start,
 	memorydump = new std::thread(&Process_WIN::memorydump_worker, this);
 }
 
+bool Process_WIN::startHeartbeatMonitoring(uint32_t deadline_ms, int32_t &slot, int &descriptor)
+{
+	// Responsiveness is detected from the top level window on Windows
+	return false;
+}
+
 void Process_WIN::memorydump_worker()
 {
+	Tracer::getInstance()->setThreadName("memory dump");
 	log_info << "Memory dump worker started" << std::endl;
 	HANDLE handles[] = {handle_OpenProcess, handle_event_Start};
 	DWORD ret = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
@@ -168,11 +249,23 @@ void Process_WIN::memorydump_worker()
 				UploadWindow::getInstance()->registerRemoveFile(fullArchivePath);
 				UploadWindow::getInstance()->registerRemoveFile(fullDumpPath);
 
-				bool dump_saved = Util::saveMemoryDump(PID, memorydumpPath, memorydumpName);
+				static MetricHistogram &dumping = Metrics::getInstance()->histogram("crash_handler_dump_seconds", "Time to write a memory dump", 1e-6);
+				static MetricHistogram &archiving = Metrics::getInstance()->histogram("crash_handler_archive_seconds", "Time to compress a memory dump", 1e-6);
+				static MetricHistogram &uploading = Metrics::getInstance()->histogram("crash_handler_upload_seconds", "Time to upload a memory dump", 1e-6);
+				static MetricCounter &uploadFailures = Metrics::getInstance()->counter("crash_handler_upload_failures_total", "Memory dump uploads that failed");
+
+				bool dump_saved = false;
+				{
+					MetricTimer timer(dumping);
+					TraceSpan span("saveMemoryDump");
+					dump_saved = Util::saveMemoryDump(PID, memorydumpPath, memorydumpName);
+				}
 
 				if (dump_saved && !UploadWindow::getInstance()->userWantsToClose()) {
 					UploadWindow::getInstance()->setDumpFileName(archiveName);
 					UploadWindow::getInstance()->zippingStarted();
+					MetricTimer timer(archiving);
+					TraceSpan span("archiveFile");
 					dump_saved = Util::archiveFile(fullDumpPath, fullArchivePath, "MiniDumpWriteDump.dmp");
 				}
 
@@ -183,7 +276,16 @@ void Process_WIN::memorydump_worker()
 					UploadWindow::getInstance()->setUploadProgress(0);
 
 					if (!UploadWindow::getInstance()->userWantsToClose()) {
-						if (Util::uploadToAWS(memorydumpPath, archiveName)) {
+						bool uploaded = false;
+						{
+							MetricTimer timer(uploading);
+							TraceSpan span("uploadToAWS");
+							uploaded = Util::uploadToAWS(memorydumpPath, archiveName);
+						}
+						if (!uploaded)
+							uploadFailures.add();
+
+						if (uploaded) {
 							successful_upload = true;
 							SetEvent(handle_event_Success);
 						} else if (UploadWindow::getInstance()->waitForUserChoise() == IDYES) {
@@ -278,11 +380,8 @@ DWORD Process_WIN::getPIDDWORD(void)
 
 HWND Process_WIN::getTopWindow()
 {
-	handle_data data;
-	data.process_id = PID;
-	data.window_handle = 0;
-	EnumWindows(enum_windows_callback, (LPARAM)&data);
-	return data.window_handle;
+	// The index is refreshed by the monitor once per responsiveness pass
+	return reinterpret_cast<HWND>(WindowIndex::getInstance()->find(PID));
 }
 
 bool Process_WIN::isValidHandleValue(const HANDLE h)
@@ -56,6 +56,7 @@ public:
 public:
 	virtual void startMemoryDumpMonitoring(const std::wstring &eventName_Start, const std::wstring &eventName_Fail, const std::wstring &eventName_Success,
 					       const std::wstring &dumpPath, const std::wstring &dumpName) override;
+	virtual bool startHeartbeatMonitoring(uint32_t deadline_ms, int32_t &slot, int &descriptor) override;
 
 private:
 	void worker();
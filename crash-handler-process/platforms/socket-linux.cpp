@@ -0,0 +1,240 @@
+#include "socket-linux.hpp"
+#include "../metrics.hpp"
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <chrono>
+#include <thread>
+
+std::wstring Socket_LINUX::ipc_path;
+
+void Socket::set_ipc_path(const std::wstring &new_ipc_path)
+{
+	Socket_LINUX::ipc_path = new_ipc_path;
+}
+
+Socket_LINUX::Socket_LINUX()
+{
+	this->name = std::string(ipc_path.begin(), ipc_path.end());
+	this->name_exit = "/tmp/exit-slobs-crash-handler";
+
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (this->name.size() >= sizeof(addr.sun_path)) {
+		initialization_failed = true;
+		log_info << "Socket path too long " << this->name << std::endl;
+		return;
+	}
+	strncpy(addr.sun_path, this->name.c_str(), sizeof(addr.sun_path) - 1);
+
+	// The path is only taken over once nobody accepts on it, a handler still serving it keeps it
+	listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	bool bound = listen_fd >= 0 && bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+	for (int retry = 0; listen_fd >= 0 && !bound && errno == EADDRINUSE && retry < SOCKET_BIND_RETRIES; retry++) {
+		if (isServed(addr)) {
+			// A handler handing over closes its socket before it exits
+			std::this_thread::sleep_for(std::chrono::milliseconds(SOCKET_BIND_RETRY_MS));
+		} else {
+			unlink(this->name.c_str());
+		}
+		bound = bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+	}
+	if (!bound || listen(listen_fd, SOMAXCONN) < 0) {
+		initialization_failed = true;
+		log_info << "Could not create " << strerror(errno) << std::endl;
+	} else {
+		log_info << "Socket created " << this->name << std::endl;
+	}
+	interrupt_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+bool Socket_LINUX::isServed(const sockaddr_un &addr)
+{
+	int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (probe < 0)
+		return false;
+	const bool served = connect(probe, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) == 0;
+	close(probe);
+	return served;
+}
+
+Socket_LINUX::~Socket_LINUX()
+{
+	closeClient();
+	if (listen_fd >= 0)
+		close(listen_fd);
+	if (interrupt_fd >= 0)
+		close(interrupt_fd);
+}
+
+std::unique_ptr<Socket> Socket::create()
+{
+	return std::make_unique<Socket_LINUX>();
+}
+
+void Socket_LINUX::closeClient()
+{
+	if (client_fd >= 0) {
+		close(client_fd);
+		client_fd = -1;
+	}
+	if (passed_fd >= 0) {
+		close(passed_fd);
+		passed_fd = -1;
+	}
+}
+
+void Socket_LINUX::interrupt()
+{
+	if (interrupt_fd >= 0 && eventfd_write(interrupt_fd, 1) != 0)
+		log_info << "Failed to interrupt the socket read " << strerror(errno) << std::endl;
+}
+
+int Socket_LINUX::takeConnection(int &descriptor)
+{
+	const int connection = client_fd;
+	descriptor = passed_fd;
+	client_fd = -1;
+	passed_fd = -1;
+	return connection;
+}
+
+std::vector<char> Socket_LINUX::read()
+{
+	// Same contract as the other platforms: one message per connection,
+	// an empty buffer after 500 ms without a client.
+	// The connection stays open until the next read so reply() can answer it.
+	std::vector<char> buffer;
+	closeClient();
+
+	pollfd listener[2] = {{listen_fd, POLLIN, 0}, {interrupt_fd, POLLIN, 0}};
+	int rv = poll(listener, interrupt_fd >= 0 ? 2 : 1, 500);
+	if (rv <= 0) {
+		if (rv < 0 && errno != EINTR) {
+			log_info << "Could not accept; |poll| error: " << strerror(errno) << std::endl;
+		}
+		return buffer;
+	}
+	if (listener[1].revents & POLLIN) {
+		eventfd_t count;
+		eventfd_read(interrupt_fd, &count);
+		return buffer;
+	}
+
+	static MetricCounter &connections = Metrics::getInstance()->counter("crash_handler_socket_connections_total", "Connections accepted on the socket");
+	static MetricCounter &received = Metrics::getInstance()->counter("crash_handler_socket_bytes_received_total", "Bytes read from the socket");
+	static MetricCounter &errors = Metrics::getInstance()->counter("crash_handler_socket_errors_total", "Failed socket operations");
+
+	client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+	if (client_fd < 0) {
+		errors.add();
+		log_info << "Could not accept; |accept| error: " << strerror(errno) << std::endl;
+		return buffer;
+	}
+
+	pollfd client = {client_fd, POLLIN, 0};
+	if (poll(&client, 1, 500) <= 0)
+		return buffer;
+
+	// A process registering its connection may pass its pidfd along
+	buffer.resize(30000, 0);
+	iovec iov = {buffer.data(), buffer.size()};
+	msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	ssize_t bytes_read = recvmsg(client_fd, &msg, MSG_CMSG_CLOEXEC);
+	buffer.resize(bytes_read < 0 ? 0 : bytes_read);
+	for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); bytes_read > 0 && cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+			memcpy(&passed_fd, CMSG_DATA(cmsg), sizeof(int));
+	}
+	connections.add();
+	if (bytes_read < 0)
+		errors.add();
+	else
+		received.add(static_cast<uint64_t>(bytes_read));
+
+	return buffer;
+}
+
+bool Socket_LINUX::reply(const std::vector<char> &buffer, const std::vector<int> &descriptors)
+{
+	if (client_fd < 0 || descriptors.size() > SOCKET_MAX_DESCRIPTORS)
+		return false;
+
+	iovec iov = {const_cast<char *>(buffer.data()), buffer.size()};
+	msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	alignas(cmsghdr) char control[CMSG_SPACE(SOCKET_MAX_DESCRIPTORS * sizeof(int))] = {};
+	if (!descriptors.empty()) {
+		msg.msg_control = control;
+		msg.msg_controllen = CMSG_SPACE(descriptors.size() * sizeof(int));
+		cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(descriptors.size() * sizeof(int));
+		memcpy(CMSG_DATA(cmsg), descriptors.data(), descriptors.size() * sizeof(int));
+	}
+
+	if (sendmsg(client_fd, &msg, MSG_NOSIGNAL) < 0) {
+		log_info << "Could not reply " << strerror(errno) << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int Socket_LINUX::write(bool exit, std::vector<char> buffer, const std::string &session)
+{
+	// The exit message of a session goes next to the ipc path, named after the session
+	const size_t slash = this->name.rfind('/') + 1;
+	std::string path = this->name;
+	if (exit)
+		path = session.empty() ? this->name_exit : this->name.substr(0, slash) + "exit-" + session + "-" + this->name.substr(slash);
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	int file_descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (file_descriptor < 0 || connect(file_descriptor, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+		log_info << "Could not connect " << strerror(errno) << std::endl;
+		if (file_descriptor >= 0)
+			close(file_descriptor);
+		return 0;
+	}
+	int bytes_wrote = send(file_descriptor, buffer.data(), buffer.size(), MSG_NOSIGNAL);
+	close(file_descriptor);
+	return bytes_wrote;
+}
+
+int Socket::forward(const std::vector<char> &buffer)
+{
+	const std::string path(Socket_LINUX::ipc_path.begin(), Socket_LINUX::ipc_path.end());
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	int file_descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (file_descriptor < 0)
+		return 0;
+	if (connect(file_descriptor, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+		close(file_descriptor);
+		return 0;
+	}
+	int bytes_wrote = send(file_descriptor, buffer.data(), buffer.size(), MSG_NOSIGNAL);
+	close(file_descriptor);
+	return bytes_wrote < 0 ? 0 : bytes_wrote;
+}
+
+void Socket_LINUX::disconnect()
+{
+	closeClient();
+	remove(this->name.c_str());
+}
@@ -0,0 +1,42 @@
+#include "../socket.hpp"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../logger.hpp"
+
+// Most descriptors a reply passes, the crash context page and its eventfd
+#define SOCKET_MAX_DESCRIPTORS 2
+// How long a new handler waits for the one serving the path to close it
+#define SOCKET_BIND_RETRIES 20
+#define SOCKET_BIND_RETRY_MS 50
+
+class Socket_LINUX : public Socket {
+private:
+	std::string name;
+	// Where the exit message goes without a session, fixed whatever the ipc path is as the frontend listens there
+	std::string name_exit;
+	int listen_fd = -1;
+	int client_fd = -1;
+	// Descriptor passed along with the last read message
+	int passed_fd = -1;
+	int interrupt_fd = -1;
+	static std::wstring ipc_path;
+
+	void closeClient();
+	static bool isServed(const sockaddr_un &addr);
+
+public:
+	Socket_LINUX();
+	virtual ~Socket_LINUX();
+
+public:
+	virtual std::vector<char> read() override;
+	virtual int write(bool exit, std::vector<char> buffer, const std::string &session) override;
+	virtual bool reply(const std::vector<char> &buffer, const std::vector<int> &descriptors) override;
+	virtual int takeConnection(int &descriptor) override;
+	virtual void interrupt() override;
+	virtual void disconnect() override;
+	friend void Socket::set_ipc_path(const std::wstring &new_ipc_path);
+	friend int Socket::forward(const std::vector<char> &buffer);
+};
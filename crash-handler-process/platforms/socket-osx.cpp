@@ -1,4 +1,5 @@
 #include "socket-osx.hpp"
+#include "../metrics.hpp"
 
 std::wstring Socket_OSX::ipc_path;
 
@@ -12,8 +13,11 @@ Socket_OSX::Socket_OSX()
 	this->name = std::string(ipc_path.begin(), ipc_path.end());
 	this->name_exit = "/tmp/exit-slobs-crash-handler";
 
-	remove(this->name.c_str());
-	if (mkfifo(this->name.c_str(), S_IRUSR | S_IWUSR) < 0) {
+	// A fifo left at the path is reused as is, removing it could pull it from under another handler
+	struct stat existing = {};
+	if (stat(this->name.c_str(), &existing) == 0 && !S_ISFIFO(existing.st_mode))
+		remove(this->name.c_str());
+	if (mkfifo(this->name.c_str(), S_IRUSR | S_IWUSR) < 0 && errno != EEXIST) {
 		initialization_failed = true;
 		log_info << "Could not create " << strerror(errno) << std::endl;
 	} else {
@@ -33,9 +37,14 @@ std::vector<char> Socket_OSX::read()
 	// The workaround is O_NONBLOCK + select + 500 ms timeout.
 	// It emulates the Windows implementation behavior.
 
+	static MetricCounter &connections = Metrics::getInstance()->counter("crash_handler_socket_connections_total", "Connections accepted on the socket");
+	static MetricCounter &received = Metrics::getInstance()->counter("crash_handler_socket_bytes_received_total", "Bytes read from the socket");
+	static MetricCounter &errors = Metrics::getInstance()->counter("crash_handler_socket_errors_total", "Failed socket operations");
+
 	std::vector<char> buffer;
 	int file_descriptor = open(this->name.c_str(), O_RDONLY | O_NONBLOCK);
 	if (file_descriptor < 0) {
+		errors.add();
 		log_info << "Could not open; |open| error: " << strerror(errno) << std::endl;
 		return buffer;
 	}
@@ -51,6 +60,7 @@ std::vector<char> Socket_OSX::read()
 	int rv = select(file_descriptor + 1, &set, NULL, NULL, &timeout);
 	if (rv <= 0) {
 		if (rv < 0) {
+			errors.add();
 			log_info << "Could not open; |select| error: " << strerror(errno) << std::endl;
 		}
 		close(file_descriptor);
@@ -61,13 +71,24 @@ std::vector<char> Socket_OSX::read()
 	int bytes_read = ::read(file_descriptor, buffer.data(), buffer.size());
 	buffer.resize(bytes_read < 0 ? 0 : bytes_read);
 	close(file_descriptor);
+	// A writer having opened the fifo is what stands for a connection here
+	connections.add();
+	if (bytes_read < 0)
+		errors.add();
+	else
+		received.add(static_cast<uint64_t>(bytes_read));
 
 	return buffer;
 }
 
-int Socket_OSX::write(bool exit, std::vector<char> buffer)
+int Socket_OSX::write(bool exit, std::vector<char> buffer, const std::string &session)
 {
-	int file_descriptor = open(exit ? this->name_exit.c_str() : this->name.c_str(), O_WRONLY | O_DSYNC);
+	// The exit message of a session goes next to the ipc path, named after the session
+	const size_t slash = this->name.rfind('/') + 1;
+	std::string path = this->name;
+	if (exit)
+		path = session.empty() ? this->name_exit : this->name.substr(0, slash) + "exit-" + session + "-" + this->name.substr(slash);
+	int file_descriptor = open(path.c_str(), O_WRONLY | O_DSYNC);
 	if (file_descriptor < 0) {
 		log_info << "Could not open " << strerror(errno) << std::endl;
 	}
@@ -76,6 +97,19 @@ int Socket_OSX::write(bool exit, std::vector<char> buffer)
 	return bytes_wrote;
 }
 
+int Socket::forward(const std::vector<char> &buffer)
+{
+	// Opening a fifo without a reader fails with ENXIO instead of blocking
+	const std::string path(Socket_OSX::ipc_path.begin(), Socket_OSX::ipc_path.end());
+	int file_descriptor = open(path.c_str(), O_WRONLY | O_NONBLOCK);
+	if (file_descriptor < 0)
+		return 0;
+
+	int bytes_wrote = ::write(file_descriptor, buffer.data(), buffer.size());
+	close(file_descriptor);
+	return bytes_wrote < 0 ? 0 : bytes_wrote;
+}
+
 void Socket_OSX::disconnect()
 {
 	remove(this->name.c_str());
@@ -22,9 +22,29 @@
 #include <algorithm>
 #include <vector>
 #include "../logger.hpp"
+#include "../metrics.hpp"
 
 std::wstring Socket_WIN::ipc_path;
 
+// The same counters as on the other platforms, a connection being a client connecting to a pipe instance
+static MetricCounter &socketConnections()
+{
+	static MetricCounter &connections = Metrics::getInstance()->counter("crash_handler_socket_connections_total", "Connections accepted on the socket");
+	return connections;
+}
+
+static MetricCounter &socketReceived()
+{
+	static MetricCounter &received = Metrics::getInstance()->counter("crash_handler_socket_bytes_received_total", "Bytes read from the socket");
+	return received;
+}
+
+static MetricCounter &socketErrors()
+{
+	static MetricCounter &errors = Metrics::getInstance()->counter("crash_handler_socket_errors_total", "Failed socket operations");
+	return errors;
+}
+
 void Socket::set_ipc_path(const std::wstring &new_ipc_path)
 {
 	Socket_WIN::ipc_path = new_ipc_path;
@@ -44,9 +64,11 @@ BOOL Socket_WIN::ConnectToNewClient(HANDLE hPipe, LPOVERLAPPED lpo)
 		fPendingIO = TRUE;
 		break;
 	case ERROR_PIPE_CONNECTED:
+		socketConnections().add();
 		if (SetEvent(lpo->hEvent))
 			break;
 	default: {
+		socketErrors().add();
 		return 0;
 	}
 	}
@@ -148,9 +170,12 @@ std::vector<char> Socket_WIN::read()
 
 		switch (Pipe[i].dwState) {
 		case CONNECTING_STATE: {
-			if (!fSuccess)
+			if (!fSuccess) {
+				socketErrors().add();
 				return buffer;
+			}
 
+			socketConnections().add();
 			Pipe[i].dwState = READING_STATE;
 			Pipe[i].cbRead = 0;
 			break;
@@ -162,6 +187,7 @@ std::vector<char> Socket_WIN::read()
 			}
 			if (!fSuccess || cbRet == 0) {
 				log_error << "Socket::read instance_" << i << " pending check failed for  " << dwErr << "\n";
+				socketErrors().add();
 				DisconnectAndReconnect(i);
 				return buffer;
 			}
@@ -185,6 +211,7 @@ std::vector<char> Socket_WIN::read()
 		// The read operation completed successfully.
 		if (Pipe[i].cbRead > 0 && fSuccess) {
 			Pipe[i].fPendingIO = FALSE;
+			socketReceived().add(Pipe[i].cbRead);
 			return Pipe[i].chRequest;
 		} else {
 			log_error << "Socket::read instance_" << i << " failed with error code " << dwErr << "\n";
@@ -192,6 +219,7 @@ std::vector<char> Socket_WIN::read()
 				Pipe[i].fPendingIO = TRUE;
 				return buffer;
 			}
+			socketErrors().add();
 			DisconnectAndReconnect(i);
 		}
 		Pipe[i].dwState = WRITING_STATE;
@@ -222,10 +250,16 @@ std::vector<char> Socket_WIN::read()
 	return buffer;
 }
 
-int Socket_WIN::write(bool exit, std::vector<char> buffer)
+int Socket_WIN::write(bool exit, std::vector<char> buffer, const std::string &session)
 {
-	HANDLE hPipe = CreateFile(exit ? const_cast<LPWSTR>(this->name_exit.c_str()) : const_cast<LPWSTR>(this->name.c_str()), GENERIC_READ | GENERIC_WRITE, 0,
-				  NULL, OPEN_EXISTING, 0, NULL);
+	// The exit message of a session goes next to the ipc path, named after the session
+	const size_t slash = this->name.rfind(L'\\') + 1;
+	std::wstring path = this->name;
+	if (exit && session.empty())
+		path = this->name_exit;
+	else if (exit)
+		path = this->name.substr(0, slash) + L"exit-" + std::wstring(session.begin(), session.end()) + L"-" + this->name.substr(slash);
+	HANDLE hPipe = CreateFile(const_cast<LPWSTR>(path.c_str()), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
 
 	if (hPipe == INVALID_HANDLE_VALUE)
 		return 0;
@@ -241,6 +275,19 @@ int Socket_WIN::write(bool exit, std::vector<char> buffer)
 	return (int)bytesWritten;
 }
 
+int Socket::forward(const std::vector<char> &buffer)
+{
+	HANDLE hPipe = CreateFile(const_cast<LPWSTR>(Socket_WIN::ipc_path.c_str()), GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+	if (hPipe == INVALID_HANDLE_VALUE)
+		return 0;
+
+	DWORD bytesWritten = 0;
+	WriteFile(hPipe, buffer.data(), buffer.size(), &bytesWritten, NULL);
+
+	CloseHandle(hPipe);
+	return (int)bytesWritten;
+}
+
 void Socket_WIN::disconnect()
 {
 	for (int i = 0; i < INSTANCES; i++) {
@@ -44,6 +44,7 @@ private:
 	PIPEINST Pipe[INSTANCES];
 	HANDLE hEvents[INSTANCES];
 	std::wstring name;
+	// Where the exit message goes without a session, fixed whatever the ipc path is as the frontend listens there
 	std::wstring name_exit;
 	static std::wstring ipc_path;
 
@@ -57,7 +58,8 @@ public:
 
 public:
 	virtual std::vector<char> read() override;
-	virtual int write(bool exit, std::vector<char> buffer) override;
+	virtual int write(bool exit, std::vector<char> buffer, const std::string &session) override;
 	virtual void disconnect() override;
 	friend void Socket::set_ipc_path(const std::wstring &new_ipc_path);
+	friend int Socket::forward(const std::vector<char> &buffer);
 };
\ No newline at end of file
@@ -0,0 +1,145 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../telemetry.hpp"
+
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// The proc files are opened once and re-read with pread, so a sample costs
+// one syscall per file plus the directory scan for the descriptor count.
+class TelemetrySampler_LINUX : public TelemetrySampler {
+private:
+	int stat_fd = -1;
+	int statm_fd = -1;
+	int io_fd = -1;
+	DIR *fd_dir = nullptr;
+	long ticks_per_second = 100;
+	long page_size = 4096;
+
+	static ssize_t readAll(int fd, char *buffer, size_t size);
+
+public:
+	TelemetrySampler_LINUX(int32_t pid);
+	virtual ~TelemetrySampler_LINUX();
+
+	bool isValid() const { return stat_fd >= 0; }
+	virtual bool sample(TelemetrySample &sample) override;
+};
+
+std::unique_ptr<TelemetrySampler> TelemetrySampler::create(int32_t pid)
+{
+	auto sampler = std::make_unique<TelemetrySampler_LINUX>(pid);
+	if (!sampler->isValid())
+		return nullptr;
+	return sampler;
+}
+
+TelemetrySampler_LINUX::TelemetrySampler_LINUX(int32_t pid)
+{
+	const std::string proc = "/proc/" + std::to_string(pid);
+	stat_fd = open((proc + "/stat").c_str(), O_RDONLY | O_CLOEXEC);
+	statm_fd = open((proc + "/statm").c_str(), O_RDONLY | O_CLOEXEC);
+	io_fd = open((proc + "/io").c_str(), O_RDONLY | O_CLOEXEC);
+	fd_dir = opendir((proc + "/fd").c_str());
+
+	ticks_per_second = sysconf(_SC_CLK_TCK);
+	page_size = sysconf(_SC_PAGESIZE);
+}
+
+TelemetrySampler_LINUX::~TelemetrySampler_LINUX()
+{
+	for (int fd : {stat_fd, statm_fd, io_fd}) {
+		if (fd >= 0)
+			close(fd);
+	}
+	if (fd_dir)
+		closedir(fd_dir);
+}
+
+ssize_t TelemetrySampler_LINUX::readAll(int fd, char *buffer, size_t size)
+{
+	if (fd < 0)
+		return -1;
+	ssize_t bytes = pread(fd, buffer, size - 1, 0);
+	buffer[bytes < 0 ? 0 : bytes] = 0;
+	return bytes;
+}
+
+bool TelemetrySampler_LINUX::sample(TelemetrySample &sample)
+{
+	char buffer[1024];
+
+	// The process name may contain spaces, fields are counted after the last ')'
+	if (readAll(stat_fd, buffer, sizeof(buffer)) <= 0)
+		return false;
+	const char *fields = strrchr(buffer, ')');
+	if (!fields)
+		return false;
+
+	unsigned long long utime = 0, stime = 0;
+	long threads = 0;
+	int field = 2;
+	for (const char *p = fields + 1; *p; p++) {
+		if (*p != ' ')
+			continue;
+		field++;
+		if (field == 14)
+			utime = strtoull(p + 1, nullptr, 10);
+		else if (field == 15)
+			stime = strtoull(p + 1, nullptr, 10);
+		else if (field == 20) {
+			threads = strtol(p + 1, nullptr, 10);
+			break;
+		}
+	}
+
+	sample.timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	sample.cpu_time_ms = (utime + stime) * 1000 / ticks_per_second;
+	sample.threads = static_cast<uint32_t>(threads);
+
+	if (readAll(statm_fd, buffer, sizeof(buffer)) > 0) {
+		char *next = nullptr;
+		strtoull(buffer, &next, 10);
+		sample.rss_bytes = strtoull(next, nullptr, 10) * page_size;
+	}
+
+	if (readAll(io_fd, buffer, sizeof(buffer)) > 0) {
+		if (const char *read_bytes = strstr(buffer, "\nread_bytes: "))
+			sample.read_bytes = strtoull(read_bytes + strlen("\nread_bytes: "), nullptr, 10);
+		if (const char *write_bytes = strstr(buffer, "\nwrite_bytes: "))
+			sample.write_bytes = strtoull(write_bytes + strlen("\nwrite_bytes: "), nullptr, 10);
+	}
+
+	if (fd_dir) {
+		uint32_t count = 0;
+		rewinddir(fd_dir);
+		while (dirent *entry = readdir(fd_dir)) {
+			if (entry->d_name[0] != '.')
+				count++;
+		}
+		sample.open_fds = count;
+	}
+
+	return true;
+}
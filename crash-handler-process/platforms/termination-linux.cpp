@@ -0,0 +1,183 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../termination.hpp"
+#include "../logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+
+// How long a killed process gets to disappear before it is reported as still running
+#define TERMINATION_KILL_GRACE_MS 1000
+// Poll period used when the kernel has no pidfd support
+#define TERMINATION_POLL_MS 10
+
+class TerminationEngine_LINUX : public TerminationEngine {
+private:
+	struct Target {
+		TerminationResult result;
+		int pidfd = -1;
+	};
+
+	static int pidfdOpen(int32_t pid) { return static_cast<int>(syscall(SYS_pidfd_open, pid, 0)); }
+	static void sendSignal(Target &target, int sig);
+	static bool hasExited(const Target &target);
+	static void waitUntil(std::vector<Target> &targets, int epoll_fd, std::chrono::steady_clock::time_point start,
+			      std::chrono::steady_clock::time_point deadline);
+
+public:
+	virtual std::vector<TerminationResult> terminate(const std::vector<int32_t> &pids, std::chrono::milliseconds deadline) override;
+};
+
+std::unique_ptr<TerminationEngine> TerminationEngine::create()
+{
+	return std::make_unique<TerminationEngine_LINUX>();
+}
+
+void TerminationEngine_LINUX::sendSignal(Target &target, int sig)
+{
+	// The pidfd pins the process, so a recycled pid is never signalled
+	if (target.pidfd >= 0)
+		syscall(SYS_pidfd_send_signal, target.pidfd, sig, nullptr, 0);
+	else
+		kill(target.result.pid, sig);
+}
+
+bool TerminationEngine_LINUX::hasExited(const Target &target)
+{
+	if (kill(target.result.pid, 0) != 0 && errno == ESRCH)
+		return true;
+
+	// A child its parent has not reaped yet still takes signals, but it is a zombie in its stat
+	std::ifstream stat("/proc/" + std::to_string(target.result.pid) + "/stat");
+	std::string line;
+	if (!std::getline(stat, line))
+		return false;
+	const size_t closing = line.rfind(')');
+	return closing != std::string::npos && closing + 2 < line.size() && (line[closing + 2] == 'Z' || line[closing + 2] == 'X');
+}
+
+void TerminationEngine_LINUX::waitUntil(std::vector<Target> &targets, int epoll_fd, std::chrono::steady_clock::time_point start,
+					std::chrono::steady_clock::time_point deadline)
+{
+	size_t remaining = 0;
+	for (auto &target : targets)
+		remaining += target.result.exited ? 0 : 1;
+
+	while (remaining) {
+		const auto now = std::chrono::steady_clock::now();
+		if (now >= deadline)
+			break;
+		int timeout = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()) + 1;
+
+		if (epoll_fd >= 0) {
+			epoll_event events[16];
+			int count = epoll_wait(epoll_fd, events, 16, timeout);
+			if (count < 0 && errno != EINTR)
+				break;
+
+			const auto exited_at = std::chrono::steady_clock::now();
+			for (int i = 0; i < count; i++) {
+				Target &target = targets[events[i].data.u32];
+				if (target.result.exited)
+					continue;
+				target.result.exited = true;
+				target.result.latency = std::chrono::duration_cast<std::chrono::milliseconds>(exited_at - start);
+				epoll_ctl(epoll_fd, EPOLL_CTL_DEL, target.pidfd, nullptr);
+				remaining--;
+			}
+		} else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeout, TERMINATION_POLL_MS)));
+			const auto exited_at = std::chrono::steady_clock::now();
+			for (auto &target : targets) {
+				if (target.result.exited || !hasExited(target))
+					continue;
+				target.result.exited = true;
+				target.result.latency = std::chrono::duration_cast<std::chrono::milliseconds>(exited_at - start);
+				remaining--;
+			}
+		}
+	}
+}
+
+std::vector<TerminationResult> TerminationEngine_LINUX::terminate(const std::vector<int32_t> &pids, std::chrono::milliseconds deadline)
+{
+	std::vector<Target> targets(pids.size());
+	int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+	for (size_t i = 0; i < pids.size(); i++) {
+		Target &target = targets[i];
+		target.result.pid = pids[i];
+		target.pidfd = pidfdOpen(pids[i]);
+		if (target.pidfd < 0) {
+			if (errno == ESRCH) {
+				target.result.exited = true;
+				continue;
+			}
+			// Without pidfds every target is polled
+			if (epoll_fd >= 0) {
+				close(epoll_fd);
+				epoll_fd = -1;
+			}
+			continue;
+		}
+		if (epoll_fd >= 0) {
+			epoll_event event = {};
+			event.events = EPOLLIN;
+			event.data.u32 = static_cast<uint32_t>(i);
+			epoll_ctl(epoll_fd, EPOLL_CTL_ADD, target.pidfd, &event);
+		}
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	for (auto &target : targets) {
+		if (!target.result.exited)
+			sendSignal(target, SIGTERM);
+	}
+	waitUntil(targets, epoll_fd, start, start + deadline);
+
+	bool escalated = false;
+	for (auto &target : targets) {
+		if (target.result.exited)
+			continue;
+		target.result.killed = true;
+		sendSignal(target, SIGKILL);
+		escalated = true;
+	}
+	if (escalated)
+		waitUntil(targets, epoll_fd, start, std::chrono::steady_clock::now() + std::chrono::milliseconds(TERMINATION_KILL_GRACE_MS));
+
+	std::vector<TerminationResult> results;
+	for (auto &target : targets) {
+		if (target.pidfd >= 0)
+			close(target.pidfd);
+		results.push_back(target.result);
+	}
+	if (epoll_fd >= 0)
+		close(epoll_fd);
+
+	return results;
+}
@@ -0,0 +1,219 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../thread-monitor.hpp"
+#include "../logger.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Share of the elapsed time a thread runs to count as spinning, and at most to count as blocked
+#define THREAD_SPINNING_CPU 0.9
+#define THREAD_BLOCKED_CPU 0.01
+
+// Waits a worker sleeps in between jobs, matched as prefixes of wchan. A thread other than the main one sleeping in them is idle.
+static const char *const idleWaits[] = {"futex_",  "do_epoll_wait",     "ep_poll",      "do_select",       "core_sys_select", "do_sys_poll",
+					"do_poll", "hrtimer_nanosleep", "do_nanosleep", "do_sigtimedwait", "sigsuspend"};
+
+class ThreadMonitor_LINUX : public ThreadMonitor {
+public:
+	ThreadMonitor_LINUX(int32_t pid);
+	virtual ~ThreadMonitor_LINUX();
+
+	virtual bool sample(std::vector<ThreadActivity> &threads) override;
+
+private:
+	// Files stay open between samples, each sample is then one pread per file
+	struct Task {
+		int stat = -1;
+		int schedstat = -1;
+		int wchan = -1;
+		bool sampled = false;
+		uint64_t runtime = 0;
+		ThreadActivity::State state = ThreadActivity::Progressing;
+		std::chrono::steady_clock::time_point since;
+	};
+
+	const int32_t pid;
+	std::string taskPath;
+	std::map<int32_t, Task> tasks;
+	std::chrono::steady_clock::time_point last;
+	const uint64_t tickNs;
+
+	bool open(int32_t tid, Task &task);
+	static void close(Task &task);
+	static ssize_t read(int file, char *buffer, size_t size);
+	static bool isIdleWait(const std::string &wchan);
+};
+
+std::unique_ptr<ThreadMonitor> ThreadMonitor::create(int32_t pid)
+{
+	return std::make_unique<ThreadMonitor_LINUX>(pid);
+}
+
+ThreadMonitor_LINUX::ThreadMonitor_LINUX(int32_t pid)
+	: pid(pid), taskPath("/proc/" + std::to_string(pid) + "/task/"), tickNs(1000000000ull / static_cast<uint64_t>(sysconf(_SC_CLK_TCK)))
+{
+}
+
+ThreadMonitor_LINUX::~ThreadMonitor_LINUX()
+{
+	for (auto &entry : tasks)
+		close(entry.second);
+}
+
+bool ThreadMonitor_LINUX::open(int32_t tid, Task &task)
+{
+	const std::string path = taskPath + std::to_string(tid) + "/";
+	task.stat = ::open((path + "stat").c_str(), O_RDONLY | O_CLOEXEC);
+	if (task.stat < 0)
+		return false;
+	// Missing when the kernel has no scheduler statistics, the run time then comes from stat in clock ticks
+	task.schedstat = ::open((path + "schedstat").c_str(), O_RDONLY | O_CLOEXEC);
+	return true;
+}
+
+void ThreadMonitor_LINUX::close(Task &task)
+{
+	for (int file : {task.stat, task.schedstat, task.wchan}) {
+		if (file >= 0)
+			::close(file);
+	}
+	task.stat = task.schedstat = task.wchan = -1;
+}
+
+ssize_t ThreadMonitor_LINUX::read(int file, char *buffer, size_t size)
+{
+	const ssize_t length = pread(file, buffer, size - 1, 0);
+	buffer[length > 0 ? length : 0] = '\0';
+	return length;
+}
+
+bool ThreadMonitor_LINUX::isIdleWait(const std::string &wchan)
+{
+	for (const char *wait : idleWaits) {
+		if (wchan.rfind(wait, 0) == 0)
+			return true;
+	}
+	return false;
+}
+
+bool ThreadMonitor_LINUX::sample(std::vector<ThreadActivity> &threads)
+{
+	threads.clear();
+	std::set<int32_t> current;
+	std::error_code error;
+	for (const auto &entry : std::filesystem::directory_iterator(taskPath, error)) {
+		const int32_t tid = atoi(entry.path().filename().c_str());
+		if (tid > 0)
+			current.insert(tid);
+	}
+	if (current.empty())
+		return false;
+
+	for (auto it = tasks.begin(); it != tasks.end();) {
+		if (current.count(it->first)) {
+			++it;
+			continue;
+		}
+		close(it->second);
+		it = tasks.erase(it);
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+	const uint64_t elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+	last = now;
+	char buffer[1024];
+	for (int32_t tid : current) {
+		Task &task = tasks[tid];
+		if (task.stat < 0 && !open(tid, task)) {
+			tasks.erase(tid);
+			continue;
+		}
+		if (read(task.stat, buffer, sizeof(buffer)) <= 0) {
+			close(task);
+			tasks.erase(tid);
+			continue;
+		}
+
+		// The name is between parentheses and may hold any character, the fields follow the last one
+		ThreadActivity activity;
+		activity.tid = tid;
+		const char *open = strchr(buffer, '(');
+		const char *closing = strrchr(buffer, ')');
+		if (!open || !closing || closing[1] == '\0')
+			continue;
+		activity.name.assign(open + 1, closing);
+		activity.kernelState = closing[2];
+
+		uint64_t runtime = 0;
+		if (task.schedstat >= 0 && read(task.schedstat, buffer, sizeof(buffer)) > 0) {
+			runtime = strtoull(buffer, nullptr, 10);
+		} else {
+			// utime and stime are the 12th and 13th fields after the state
+			const char *field = closing + 2;
+			for (int i = 0; i < 11 && field; i++) {
+				field = strchr(field, ' ');
+				field = field ? field + 1 : nullptr;
+			}
+			if (field) {
+				char *end = nullptr;
+				const uint64_t user = strtoull(field, &end, 10);
+				runtime = (user + strtoull(end, nullptr, 10)) * tickNs;
+			}
+		}
+
+		ThreadActivity::State state = ThreadActivity::Progressing;
+		if (task.sampled && elapsedNs) {
+			activity.cpu = static_cast<double>(runtime - std::min(runtime, task.runtime)) / elapsedNs;
+			if (activity.cpu >= THREAD_SPINNING_CPU)
+				state = ThreadActivity::Spinning;
+			else if (activity.cpu <= THREAD_BLOCKED_CPU && (activity.kernelState == 'S' || activity.kernelState == 'D'))
+				state = ThreadActivity::Blocked;
+		}
+
+		if (state == ThreadActivity::Blocked) {
+			// Reads 0 without ptrace access to the process
+			if (task.wchan < 0)
+				task.wchan = ::open((taskPath + std::to_string(tid) + "/wchan").c_str(), O_RDONLY | O_CLOEXEC);
+			if (task.wchan >= 0 && read(task.wchan, buffer, sizeof(buffer)) > 0 && strcmp(buffer, "0") != 0)
+				activity.wchan = buffer;
+			// An uninterruptible sleep is never idle, nor is the main thread while the process is unresponsive
+			if (tid != pid && activity.kernelState == 'S' && isIdleWait(activity.wchan))
+				state = ThreadActivity::Idle;
+		}
+		task.sampled = true;
+		task.runtime = runtime;
+		if (state != task.state || task.since == std::chrono::steady_clock::time_point()) {
+			task.state = state;
+			task.since = now;
+		}
+		activity.state = state;
+		if (state != ThreadActivity::Progressing)
+			activity.stuckMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - task.since).count();
+		threads.push_back(activity);
+	}
+	return !threads.empty();
+}
@@ -108,8 +108,8 @@ LRESULT UploadWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		upload_window_hwnd = NULL;
 		break;
 	case CUSTOM_CAUGHT_CRASH: {
-		std::string message_boost = boost::locale::translate("The application just crashed.").str() + std::string("\r\n\r\n") +
-					    boost::locale::translate("Would you like to send a report to the developers?").str();
+		std::string message_boost = boost::locale::translate("The application just crashed.").str(Util::translations()) + std::string("\r\n\r\n") +
+					    boost::locale::translate("Would you like to send a report to the developers?").str(Util::translations());
 		std::wstring caught_crash_message = from_utf8_to_utf16_wide(message_boost.c_str());
 
 		SetWindowText(upload_label_hwnd, caught_crash_message.c_str());
@@ -124,14 +124,15 @@ LRESULT UploadWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	case CUSTOM_PROGRESS_MSG: {
 		double progress = ((double)bytes_sent) / ((double)total_bytes_to_send / 100.0);
 		PostMessage(progresss_bar_hwnd, PBM_SETPOS, (int)progress, 0);
-		std::wstring upload_message = from_utf8_to_utf16_wide(boost::locale::translate("Uploading... %.2f%%\r\n%.1f / %.1fmb").str().c_str());
+		std::wstring upload_message =
+			from_utf8_to_utf16_wide(boost::locale::translate("Uploading... %.2f%%\r\n%.1f / %.1fmb").str(Util::translations()).c_str());
 		swprintf(upload_progress_message, upload_message_len, upload_message.c_str(), static_cast<float>(progress),
 			 static_cast<float>(bytes_sent) / (1024.f * 1024.f), static_cast<float>(total_bytes_to_send) / (1024.f * 1024.f));
 		SetWindowText(upload_label_hwnd, upload_progress_message);
 		break;
 	}
 	case CUSTOM_SAVE_STARTED: {
-		std::wstring save_message = from_utf8_to_utf16_wide(boost::locale::translate("Saving... to \"%s\"").str().c_str());
+		std::wstring save_message = from_utf8_to_utf16_wide(boost::locale::translate("Saving... to \"%s\"").str(Util::translations()).c_str());
 		swprintf(upload_progress_message, upload_message_len, save_message.c_str(), file_name.c_str());
 		SetWindowText(upload_label_hwnd, upload_progress_message);
 		showButtons({.ok = true, .cancel = true, .yes = false, .no = false});
@@ -140,7 +141,7 @@ LRESULT UploadWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	}
 	case CUSTOM_ZIPPING_STARTED: {
 		PostMessage(progresss_bar_hwnd, PBM_SETPOS, (int)25, 0);
-		std::wstring zipping_message = from_utf8_to_utf16_wide(boost::locale::translate("Zipping... to \"%s\"").str().c_str());
+		std::wstring zipping_message = from_utf8_to_utf16_wide(boost::locale::translate("Zipping... to \"%s\"").str(Util::translations()).c_str());
 		swprintf(upload_progress_message, upload_message_len, zipping_message.c_str(), file_name.c_str());
 		SetWindowText(upload_label_hwnd, upload_progress_message);
 		showButtons({.ok = true, .cancel = true, .yes = false, .no = false});
@@ -149,7 +150,7 @@ LRESULT UploadWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	}
 	case CUSTOM_SAVING_DUMP_FAILED: {
 		std::wstring dump_failed_message =
-			from_utf8_to_utf16_wide(boost::locale::translate("Failed to save the local debug information.").str().c_str());
+			from_utf8_to_utf16_wide(boost::locale::translate("Failed to save the local debug information.").str(Util::translations()).c_str());
 		SetWindowText(upload_label_hwnd, dump_failed_message.c_str());
 		showButtons({.ok = true, .cancel = true, .yes = false, .no = false});
 		enableButtons({.ok = false, .cancel = false, .yes = false, .no = false});
@@ -157,7 +158,8 @@ LRESULT UploadWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	}
 	case CUSTOM_UPLOAD_STARTED: {
 		SendMessage(progresss_bar_hwnd, PBM_SETRANGE32, 0, 100);
-		std::wstring upload_start_message = from_utf8_to_utf16_wide(boost::locale::translate("Initializing upload...").str().c_str());
+		std::wstring upload_start_message =
+			from_utf8_to_utf16_wide(boost::locale::translate("Initializing upload...").str(Util::translations()).c_str());
 		SetWindowText(upload_label_hwnd, upload_start_message.c_str());
 		showButtons({.ok = true, .cancel = true, .yes = false, .no = false});
 		enableButtons({.ok = false, .cancel = false, .yes = false, .no = false});
@@ -167,7 +169,7 @@ LRESULT UploadWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		auto message_boost = boost::locale::translate("Successfully uploaded the debug information.\r\n"
 							      "Please provide this file name to the support.\r\n"
 							      "File: \"%s\".");
-		std::wstring upload_finished_message = from_utf8_to_utf16_wide(message_boost.str().c_str());
+		std::wstring upload_finished_message = from_utf8_to_utf16_wide(message_boost.str(Util::translations()).c_str());
 		swprintf(upload_progress_message, upload_message_len, upload_finished_message.c_str(), file_name.c_str());
 		SetWindowText(upload_label_hwnd, upload_progress_message);
 		showButtons({.ok = true, .cancel = true, .yes = false, .no = false});
@@ -175,7 +177,8 @@ LRESULT UploadWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		break;
 	}
 	case CUSTOM_UPLOAD_CANCELED: {
-		std::wstring upload_upload_canceled = from_utf8_to_utf16_wide(boost::locale::translate("Upload cancleled.\r\n%s removed.").str().c_str());
+		std::wstring upload_upload_canceled =
+			from_utf8_to_utf16_wide(boost::locale::translate("Upload cancleled.\r\n%s removed.").str(Util::translations()).c_str());
 		swprintf(upload_progress_message, upload_message_len, upload_upload_canceled.c_str(), file_name.c_str());
 		SetWindowText(upload_label_hwnd, upload_progress_message);
 		showButtons({.ok = true, .cancel = true, .yes = false, .no = false});
@@ -183,7 +186,8 @@ LRESULT UploadWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		break;
 	}
 	case CUSTOM_UPLOAD_FAILED: {
-		std::wstring upload_upload_failed = from_utf8_to_utf16_wide(boost::locale::translate("Upload failed. Save a copy?\r\n\"%s/%s\"").str().c_str());
+		std::wstring upload_upload_failed =
+			from_utf8_to_utf16_wide(boost::locale::translate("Upload failed. Save a copy?\r\n\"%s/%s\"").str(Util::translations()).c_str());
 		swprintf(upload_progress_message, upload_message_len, upload_upload_failed.c_str(), dump_path.c_str(), file_name.c_str());
 		SetWindowText(upload_label_hwnd, upload_progress_message);
 		showButtons({.ok = false, .cancel = false, .yes = true, .no = true});
@@ -371,7 +375,7 @@ void UploadWindow::windowThread()
 	int screen_width = GetSystemMetrics(SM_CXSCREEN);
 	int screen_height = GetSystemMetrics(SM_CYSCREEN);
 	std::wstring upload_window_title =
-		from_utf8_to_utf16_wide(boost::locale::translate("Streamlabs Desktop has encountered a critical error").str().c_str());
+		from_utf8_to_utf16_wide(boost::locale::translate("Streamlabs Desktop has encountered a critical error").str(Util::translations()).c_str());
 
 	upload_window_hwnd = CreateWindowEx(WS_EX_CLIENTEDGE, L"uploaderwindowclass", upload_window_title.c_str(),
 					    WS_OVERLAPPED | WS_MINIMIZEBOX | WS_SYSMENU | WS_EX_TOPMOST, (screen_width - width) / 2,
@@ -398,10 +402,10 @@ void UploadWindow::windowThread()
 	upload_label_hwnd = CreateWindow(WC_EDIT, TEXT(""), WS_CHILD | WS_VISIBLE | ES_MULTILINE | ES_AUTOVSCROLL | ES_WANTRETURN, x_pos, y_pos + 50,
 					 x_size - 20, 90, upload_window_hwnd, NULL, NULL, NULL);
 
-	std::wstring yes_button_title = from_utf8_to_utf16_wide(boost::locale::translate("Yes").str().c_str());
-	std::wstring no_button_title = from_utf8_to_utf16_wide(boost::locale::translate("No").str().c_str());
-	std::wstring cancel_button_title = from_utf8_to_utf16_wide(boost::locale::translate("Cancel").str().c_str());
-	std::wstring ok_button_title = from_utf8_to_utf16_wide(boost::locale::translate("OK").str().c_str());
+	std::wstring yes_button_title = from_utf8_to_utf16_wide(boost::locale::translate("Yes").str(Util::translations()).c_str());
+	std::wstring no_button_title = from_utf8_to_utf16_wide(boost::locale::translate("No").str(Util::translations()).c_str());
+	std::wstring cancel_button_title = from_utf8_to_utf16_wide(boost::locale::translate("Cancel").str(Util::translations()).c_str());
+	std::wstring ok_button_title = from_utf8_to_utf16_wide(boost::locale::translate("OK").str(Util::translations()).c_str());
 
 	ok_button_hwnd = CreateWindow(WC_BUTTON, ok_button_title.c_str(), WS_TABSTOP | WS_CHILD | WS_VISIBLE | BS_DEFPUSHBUTTON, x_size - 220, y_size - 50, 100,
 				      40, upload_window_hwnd, NULL, NULL, NULL);
@@ -448,6 +452,7 @@ void UploadWindow::windowThread()
 
 bool UploadWindow::createWindow()
 {
+	Util::loadTranslations();
 	window_thread = new std::thread(&UploadWindow::windowThread, this);
 
 	std::unique_lock<std::mutex> lock(upload_window_choose_mutex);
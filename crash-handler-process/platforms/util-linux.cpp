@@ -0,0 +1,160 @@
+#include "../util.hpp"
+#include "../logger.hpp"
+#include "../crash-interceptor.hpp"
+#include "minidump-linux.hpp"
+#include <locale>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+void Util::runTerminateWindow(bool &shouldRestart)
+{
+	// No dialog toolkit is linked on Linux, the application decides on its own
+	log_info << "Terminate window is not available on this platform" << std::endl;
+	shouldRestart = false;
+}
+
+// Only used where no instance guard can be created, with the 8 byte pid the Windows handler writes
+void Util::check_pid_file(std::string &pid_path)
+{
+	int file = open(pid_path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file < 0)
+		return;
+	uint64_t pid = 0;
+	const bool read_pid = read(file, &pid, sizeof(pid)) == sizeof(pid);
+	close(file);
+	if (!read_pid || pid == 0 || pid == static_cast<uint64_t>(getpid()))
+		return;
+
+	// The pid may belong to an unrelated process by now
+	char exe[PATH_MAX] = {};
+	const std::string link = "/proc/" + std::to_string(pid) + "/exe";
+	if (readlink(link.c_str(), exe, sizeof(exe) - 1) <= 0 || !strstr(exe, "crash-handler-process"))
+		return;
+	log_info << "Killing the previous crash handler, pid " << pid << std::endl;
+	kill(static_cast<pid_t>(pid), SIGKILL);
+}
+
+void Util::write_pid_file(std::string &pid_path)
+{
+	int file = open(pid_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (file < 0) {
+		log_error << "Failed to write the pid file " << pid_path << ": " << strerror(errno) << std::endl;
+		return;
+	}
+	const uint64_t pid = static_cast<uint64_t>(getpid());
+	if (write(file, &pid, sizeof(pid)) != sizeof(pid))
+		log_error << "Failed to write the pid file " << pid_path << std::endl;
+	close(file);
+}
+
+std::string Util::get_temp_directory()
+{
+	const char *tmp = std::getenv("TMPDIR");
+	std::string path = tmp && std::strlen(tmp) ? tmp : "/tmp";
+	if (path.back() != '/')
+		path += '/';
+	return path;
+}
+
+void Util::restartApp(std::wstring path) {}
+
+bool Util::writeFileAtomically(const std::wstring &path, const std::string &content)
+{
+	const std::string file_path(path.begin(), path.end());
+	const std::string temp_path = file_path + ".tmp";
+
+	int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return false;
+
+	size_t done = 0;
+	while (done < content.size()) {
+		ssize_t written = write(fd, content.data() + done, content.size() - done);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			break;
+		done += static_cast<size_t>(written);
+	}
+	const bool synced = done == content.size() && fsync(fd) == 0;
+	close(fd);
+	if (!synced || rename(temp_path.c_str(), file_path.c_str()) != 0) {
+		unlink(temp_path.c_str());
+		return false;
+	}
+
+	// The rename itself survives a power loss once the directory is synced
+	const size_t separator = file_path.rfind('/');
+	int dir = open(separator == std::string::npos ? "." : file_path.substr(0, separator + 1).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dir >= 0) {
+		fsync(dir);
+		close(dir);
+	}
+	return true;
+}
+
+#if defined(__x86_64__)
+// Registers are kept in the order of the ucontext gregs, rip is the 17th
+static void addRegisters(MinidumpCrash &crash, int32_t tid, uint32_t count, const uint64_t *registers)
+{
+	if (tid <= 0 || count < 18)
+		return;
+	user_regs_struct &regs = crash.registers[tid];
+	unsigned long long *const ordered[] = {&regs.r8,  &regs.r9,  &regs.r10, &regs.r11, &regs.r12, &regs.r13, &regs.r14, &regs.r15, &regs.rdi,
+					       &regs.rsi, &regs.rbp, &regs.rbx, &regs.rdx, &regs.rax, &regs.rcx, &regs.rsp, &regs.rip, &regs.eflags};
+	for (size_t i = 0; i < sizeof(ordered) / sizeof(ordered[0]); i++)
+		*ordered[i] = registers[i];
+}
+#endif
+
+bool Util::saveMemoryDump(uint32_t pid, const std::wstring &dumpPath, const std::wstring &dumpFileName, const CrashSnapshot *snapshot)
+{
+	const std::wstring file = dumpPath + L"/" + dumpFileName;
+	if (!snapshot)
+		return minidump_write_process(static_cast<int32_t>(pid), std::string(file.begin(), file.end()));
+
+	MinidumpCrash crash;
+	crash.tid = snapshot->context.tid;
+	crash.signal = snapshot->context.signal;
+	crash.code = snapshot->context.code;
+	crash.address = snapshot->context.address;
+#if defined(__x86_64__)
+	if (snapshot->context.architecture == CRASH_CONTEXT_ARCH_X86_64) {
+		addRegisters(crash, snapshot->context.tid, snapshot->context.register_count, snapshot->context.registers);
+		for (const CrashThreadState &thread : snapshot->threads)
+			addRegisters(crash, thread.tid, thread.register_count, thread.registers);
+	}
+#endif
+	return minidump_write_process(static_cast<int32_t>(pid), std::string(file.begin(), file.end()), &crash);
+}
+bool Util::archiveFile(const std::wstring &srcFullPath, const std::wstring &dstFullPath, const std::string &nameInsideArchive)
+{
+	return false;
+}
+bool Util::uploadToAWS(const std::wstring &wspath, const std::wstring &fileName)
+{
+	return false;
+}
+void Util::abortUploadAWS() {}
+
+void Util::setupLocale()
+{
+	const char *current_locale = setlocale(LC_ALL, nullptr);
+	if (current_locale == nullptr || std::strlen(current_locale) == 0) {
+		setlocale(LC_ALL, "en_US.UTF-8");
+	}
+}
+
+// No dialog is shown on Linux
+void Util::loadTranslations() {}
+
+std::locale Util::translations()
+{
+	return std::locale();
+}
@@ -2,6 +2,9 @@
 #include "../logger.hpp"
 #include <libintl.h>
 #include <locale>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 
 #import <Cocoa/Cocoa.h>
 
@@ -96,11 +99,42 @@ void Util::restartApp(std::wstring path)
 	[[NSWorkspace sharedWorkspace] launchApplication:@"/Applications/Streamlabs Desktop.app"];
 }
 
-void Util::setCachePath(std::wstring path) {}
+bool Util::writeFileAtomically(const std::wstring &path, const std::string &content)
+{
+	const std::string file_path(path.begin(), path.end());
+	const std::string temp_path = file_path + ".tmp";
+
+	int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return false;
+
+	size_t done = 0;
+	while (done < content.size()) {
+		ssize_t written = write(fd, content.data() + done, content.size() - done);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			break;
+		done += static_cast<size_t>(written);
+	}
+	const bool synced = done == content.size() && fcntl(fd, F_FULLFSYNC) == 0;
+	close(fd);
+	if (!synced || rename(temp_path.c_str(), file_path.c_str()) != 0) {
+		unlink(temp_path.c_str());
+		return false;
+	}
 
-void Util::updateAppState(Util::AppState detected) {}
+	// The rename itself survives a power loss once the directory is synced
+	const size_t separator = file_path.rfind('/');
+	int dir = open(separator == std::string::npos ? "." : file_path.substr(0, separator + 1).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dir >= 0) {
+		fsync(dir);
+		close(dir);
+	}
+	return true;
+}
 
-bool Util::saveMemoryDump(uint32_t pid, const std::wstring &dumpPath, const std::wstring &dumpFileName)
+bool Util::saveMemoryDump(uint32_t pid, const std::wstring &dumpPath, const std::wstring &dumpFileName, const CrashSnapshot *snapshot)
 {
 	return false;
 }
@@ -116,4 +150,12 @@ void Util::setupLocale()
 	if (current_locale == nullptr || std::strlen(current_locale) == 0) {
 		setlocale(LC_ALL, "en_US.UTF-8");
 	}
+}
+
+// gettext maps a catalog on the first lookup already
+void Util::loadTranslations() {}
+
+std::locale Util::translations()
+{
+	return std::locale();
 }
\ No newline at end of file
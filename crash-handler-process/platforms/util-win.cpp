@@ -18,6 +18,7 @@
 
 #include "../util.hpp"
 #include "../logger.hpp"
+#include "../metrics.hpp"
 #include <windows.h>
 #include <string>
 #include <chrono>
@@ -25,8 +26,8 @@
 #include <sstream>
 #include <codecvt>
 #include <psapi.h>
-#include "json.hpp"
 #include <filesystem>
+#include <mutex>
 
 #include "upload-window-win.hpp"
 
@@ -57,7 +58,7 @@ std::wstring from_utf8_to_utf16_wide(const char *from, size_t length = -1);
 
 LONG CALLBACK unhandledHandler(EXCEPTION_POINTERS *e)
 {
-	if (log_output_file.is_open() && !log_output_path.empty()) {
+	if (log_output_file.isOpen() && !log_output_path.empty()) {
 		log_info << "!! Crashed !!" << std::endl;
 
 		// Small file, ~50-100 kb, MiniDumpNormal will only have stack, always same name to overwrite on purpose (small footprint)
@@ -88,9 +89,6 @@ unhandledHandlerObj unhandledHandlerObj_Impl;
 
 #define GET_KEY []() { return AWS_CRASH_UPLOAD_BUCKET_KEY; }()
 
-const std::wstring appStateFileName = L"\\appState";
-std::wstring appCachePath = L"";
-
 void Util::restartApp(std::wstring path)
 {
 	STARTUPINFO info = {sizeof(info)};
@@ -111,29 +109,30 @@ void Util::restartApp(std::wstring path)
 
 void Util::runTerminateWindow(bool &shouldRestart)
 {
-	std::wstring title = from_utf8_to_utf16_wide(boost::locale::translate("An error occurred").str().c_str());
+	loadTranslations();
+	std::wstring title = from_utf8_to_utf16_wide(boost::locale::translate("An error occurred").str(translations()).c_str());
 
 	auto message_translated1 = boost::locale::translate("An error occurred which has caused Streamlabs Desktop to close. Don't worry! "
 							    "If you were streaming or recording, that is still happening in the background.");
-	std::wstring message1 = from_utf8_to_utf16_wide(message_translated1.str().c_str());
+	std::wstring message1 = from_utf8_to_utf16_wide(message_translated1.str(translations()).c_str());
 	auto message_translated2 = boost::locale::translate("Whenever you're ready, we can relaunch the application, however this will "
 							    "end your stream / recording session.");
-	std::wstring message2 = from_utf8_to_utf16_wide(message_translated2.str().c_str());
+	std::wstring message2 = from_utf8_to_utf16_wide(message_translated2.str(translations()).c_str());
 	auto message_translated3 = boost::locale::translate("Click the Yes button to keep streaming / recording.");
-	std::wstring message3 = from_utf8_to_utf16_wide(message_translated3.str().c_str());
+	std::wstring message3 = from_utf8_to_utf16_wide(message_translated3.str(translations()).c_str());
 	auto message_translated4 = boost::locale::translate("Click the No button to stop streaming / recording.");
-	std::wstring message4 = from_utf8_to_utf16_wide(message_translated4.str().c_str());
+	std::wstring message4 = from_utf8_to_utf16_wide(message_translated4.str(translations()).c_str());
 
 	std::wstring message = message1 + L"\n\n" + message2 + L"\n\n" + message3 + L"\n\n" + message4;
 
 	int code = MessageBox(NULL, message.c_str(), title.c_str(), MB_YESNO | MB_SYSTEMMODAL);
 	switch (code) {
 	case IDYES: {
-		title = from_utf8_to_utf16_wide(boost::locale::translate("Choose when to restart").str().c_str());
+		title = from_utf8_to_utf16_wide(boost::locale::translate("Choose when to restart").str(translations()).c_str());
 		auto message_translated = boost::locale::translate("Your stream / recording session is still running in the background. "
 								   "Whenever you're ready, click the OK "
 								   "button below to end your stream / recording and relaunch the application.");
-		message = from_utf8_to_utf16_wide(message_translated.str().c_str());
+		message = from_utf8_to_utf16_wide(message_translated.str(translations()).c_str());
 		MessageBox(NULL, message.c_str(), title.c_str(), MB_OK | MB_SYSTEMMODAL);
 		shouldRestart = true;
 		break;
@@ -301,55 +300,22 @@ std::string Util::get_temp_directory()
 	return from_utf16_wide_to_utf8(tmp.data());
 }
 
-void Util::setCachePath(std::wstring path)
-{
-	appCachePath = path;
-}
-
-void Util::updateAppState(Util::AppState state)
+bool Util::writeFileAtomically(const std::wstring &path, const std::string &content)
 {
-	const std::string freez_flag = "window_unresponsive";
-	const std::string noncritical_flag = "crashed_noncritically";
-	const std::string flag_name = "detected";
-
-	std::ifstream state_file(appCachePath + appStateFileName, std::ios::in);
-	if (!state_file.is_open())
-		return;
-
-	std::ostringstream buffer;
-	buffer << state_file.rdbuf();
-	state_file.close();
-
-	std::string current_status = buffer.str();
-	if (current_status.size() == 0)
-		return;
+	const std::wstring temp_path = path + L".tmp";
+	HANDLE file = CreateFileW(temp_path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
 
-	std::string updated_status = "";
-	std::string existing_flag_value = "";
-	nlohmann::json jsonEntry = nlohmann::json::parse(current_status);
-	try {
-		existing_flag_value = jsonEntry.at(flag_name);
-	} catch (...) {
-	}
-	if (state == AppState::Unresponsive) {
-		if (existing_flag_value.empty())
-			jsonEntry[flag_name] = freez_flag;
-	} else if (state == AppState::Responsive) {
-		if (existing_flag_value.compare(freez_flag) == 0)
-			jsonEntry[flag_name] = "";
-	} else if (state == AppState::NoncriticallyDead) {
-		jsonEntry[flag_name] = noncritical_flag;
+	DWORD written = 0;
+	const bool synced = WriteFile(file, content.data(), static_cast<DWORD>(content.size()), &written, NULL) && written == content.size() &&
+			    FlushFileBuffers(file);
+	CloseHandle(file);
+	if (!synced || !MoveFileExW(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+		DeleteFileW(temp_path.c_str());
+		return false;
 	}
-	updated_status = jsonEntry.dump(-1);
-
-	std::ofstream out_state_file;
-	out_state_file.open(appCachePath + appStateFileName, std::ios::trunc | std::ios::out);
-	if (!out_state_file.is_open())
-		return;
-
-	out_state_file << updated_status << "\n";
-	out_state_file.flush();
-	out_state_file.close();
+	return true;
 }
 
 bool Util::archiveFile(const std::wstring &fileFullPath, const std::wstring &archiveFullPath, const std::string &nameInsideArchive)
@@ -393,6 +359,11 @@ bool Util::archiveFile(const std::wstring &fileFullPath, const std::wstring &arc
 					if (zipCloseFileInZip(zf) == S_OK)
 						result = true;
 				}
+				if (result) {
+					static MetricCounter &compressed =
+						Metrics::getInstance()->counter("crash_handler_compressed_bytes_total", "Bytes compressed into archives and rotated logs");
+					compressed.add(size);
+				}
 			}
 		}
 
@@ -406,7 +377,7 @@ bool Util::archiveFile(const std::wstring &fileFullPath, const std::wstring &arc
 	return result;
 }
 
-bool Util::saveMemoryDump(uint32_t pid, const std::wstring &dumpPath, const std::wstring &dumpFileName)
+bool Util::saveMemoryDump(uint32_t pid, const std::wstring &dumpPath, const std::wstring &dumpFileName, const CrashSnapshot *snapshot)
 {
 	bool dumpSaved = false;
 
@@ -644,26 +615,39 @@ void Util::setupLocale()
 	if (current_locale == nullptr || std::strlen(current_locale) == 0) {
 		std::setlocale(LC_ALL, "en_US.UTF-8");
 	}
+}
 
-	namespace blg = boost::locale::gnu_gettext;
-	blg::messages_info info;
-
-	info.paths.push_back("");
-	info.domains.push_back(blg::messages_info::domain("messages"));
-	info.callback = get_messages_callback;
+static std::locale translated_locale;
 
-	boost::locale::generator gen;
-	std::locale base_locale = gen("");
+void Util::loadTranslations()
+{
+	static std::once_flag loaded;
+	std::call_once(loaded, []() {
+		namespace blg = boost::locale::gnu_gettext;
+		blg::messages_info info;
+
+		info.paths.push_back("");
+		info.domains.push_back(blg::messages_info::domain("messages"));
+		info.callback = get_messages_callback;
+
+		boost::locale::generator gen;
+		std::locale base_locale = gen("");
+
+		boost::locale::info const &properties = std::use_facet<boost::locale::info>(base_locale);
+		info.language = properties.language();
+		info.country = properties.country();
+		info.encoding = properties.encoding();
+		info.variant = properties.variant();
+		try {
+			translated_locale = std::locale(base_locale, blg::create_messages_facet<char>(info));
+		} catch (...) {
+			log_error << "Failed to setup localizaiton for a current language: " << info.language << "-" << info.country << std::endl;
+		}
+	});
+}
 
-	boost::locale::info const &properties = std::use_facet<boost::locale::info>(base_locale);
-	info.language = properties.language();
-	info.country = properties.country();
-	info.encoding = properties.encoding();
-	info.variant = properties.variant();
-	try {
-		std::locale real_locale(base_locale, blg::create_messages_facet<char>(info));
-		std::locale::global(real_locale);
-	} catch (...) {
-		log_error << "Failed to setup localizaiton for a current language: " << info.language << "-" << info.country << std::endl;
-	}
+std::locale Util::translations()
+{
+	loadTranslations();
+	return translated_locale;
 }
@@ -0,0 +1,53 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef PROCESS_FREEZER_H
+#define PROCESS_FREEZER_H
+
+#include "crash-interceptor.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Keeps the registered processes in one group that is frozen with a single
+// write when a critical process crashes, so every member is captured as it
+// was at the same instant. Children forked by members join the group.
+class ProcessFreezer {
+public:
+	// Returns nullptr on platforms or kernels without a group freezer, or when parent can not be written
+	static std::unique_ptr<ProcessFreezer> create(const std::string &parent);
+
+	virtual ~ProcessFreezer(){};
+
+	virtual bool add(int32_t pid) = 0;
+	// Moves the process back where it was added from
+	virtual void remove(int32_t pid) = 0;
+
+	// Returns once every member is frozen, false if the timeout passed first
+	virtual bool freeze(std::chrono::milliseconds timeout) = 0;
+	virtual void thaw() = 0;
+	virtual std::vector<int32_t> members() = 0;
+
+	// Instruction and stack pointers of the threads of a frozen member, with the stack of its main thread
+	virtual bool capture(int32_t pid, CrashSnapshot &snapshot) = 0;
+};
+
+#endif
@@ -17,9 +17,25 @@
 ******************************************************************************/
 
 #include "process-manager.hpp"
+#include "window-index.hpp"
+#include "options.hpp"
+#include "termination.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+
+// Checks due within the same window run in one wakeup of the monitor
+#define MONITOR_RESOLUTION_MS 10
+// Longest the monitor sleeps, so a stop request is never missed for long
+#define MONITOR_MAX_SLEEP_MS 1000
+// A member stuck in uninterruptible sleep does not freeze, it is captured as it is after this
+#define FREEZE_TIMEOUT_MS 1000
 
 void ThreadData::send_stop()
 {
@@ -30,16 +46,55 @@ void ThreadData::send_stop()
 	stop_event.notify_one();
 }
 
-bool ThreadData::wait_or_stop()
+void ThreadData::wake()
+{
+	{
+		const std::lock_guard<std::recursive_mutex> lock(stop_mutex);
+		woken = true;
+	}
+	stop_event.notify_one();
+}
+
+bool ThreadData::wait_or_stop(std::chrono::milliseconds timeout)
 {
 	std::unique_lock<std::recursive_mutex> lck(stop_mutex);
 	if (should_stop)
 		return true;
-	else
-		return stop_event.wait_for(lck, std::chrono::milliseconds(50), [&flag = this->should_stop] { return flag; });
+
+	stop_event.wait_for(lck, timeout, [this] { return should_stop || woken; });
+	woken = false;
+	return should_stop;
 }
 
-ProcessManager::ProcessManager()
+static MetricGauge &monitoredProcesses()
+{
+	static MetricGauge &processes = Metrics::getInstance()->gauge("crash_handler_monitored_processes", "Processes monitored across sessions");
+	return processes;
+}
+
+static std::string formatHex(uint64_t value)
+{
+	std::ostringstream text;
+	text << "0x" << std::hex << value;
+	return text.str();
+}
+
+// Thread names are chosen by the application
+static std::string escapeJson(const std::string &value)
+{
+	std::string escaped;
+	for (char c : value) {
+		if (c == '"' || c == '\\')
+			escaped += '\\';
+		if (static_cast<unsigned char>(c) >= 0x20)
+			escaped += c;
+	}
+	return escaped;
+}
+
+ProcessManager::ProcessManager(const std::wstring &cachePath)
+	: cachePath(cachePath), reportPath(log_output_path), stopped(false), handedOver(false), interceptionUnavailable(false), appState(cachePath),
+	  scheduler(std::chrono::milliseconds(MONITOR_RESOLUTION_MS))
 {
 	m_applicationCrashed = false;
 	m_criticalCrash = false;
@@ -47,8 +102,20 @@ ProcessManager::ProcessManager()
 
 ProcessManager::~ProcessManager()
 {
+	stopMonitoring();
+	this->interceptor.reset();
+	this->freezer.reset();
+	this->connections.reset();
+	this->crashContexts.reset();
+	this->discovery.reset();
+	monitoredProcesses().add(-static_cast<int64_t>(this->processes.size()));
+	// Process threads, where dumps are saved and uploaded, are joined here
 	this->processes.clear();
-	this->socket->disconnect();
+	if (m_applicationCrashed && !this->reportPath.empty() && Tracer::getInstance()->writeEpisode(this->reportPath + L".trace.json"))
+		log_info << "Crash handling trace written" << std::endl;
+	// A session shares the socket of the handler, only the watcher owns it
+	if (this->watcher && this->socket && !this->handedOver)
+		this->socket->disconnect();
 	this->socket.reset();
 }
 
@@ -64,131 +131,369 @@ void ProcessManager::runWatcher()
 
 void ProcessManager::watcher_fnc()
 {
+	Tracer::getInstance()->setThreadName("watcher");
 	log_info << "Start Watcher" << std::endl;
 	this->socket = Socket::create();
 	if (this->socket->initialization_failed)
 		return;
 
+	startDiscovery();
+
 	while (!this->watcher->wait_or_stop()) {
 		std::vector<char> buffer = this->socket->read();
 		while (buffer.size()) {
-			Message msg(buffer);
-			switch (static_cast<Action>(msg.readUInt8())) {
-			case Action::REGISTER: {
-				bool isCritical = msg.readBool();
-				uint32_t pid = msg.readUInt32();
-				size_t size = registerProcess(isCritical, pid);
-				if (size == 1)
-					startMonitoring();
-
-				break;
-			}
-			case Action::UNREGISTER: {
-				uint32_t pid = msg.readUInt32();
-				unregisterProcess(pid);
-				break;
-			}
-			case Action::REGISTERMEMORYDUMP: {
-				uint32_t pid = msg.readUInt32();
-				std::wstring eventName_Start = msg.readWstring();
-				std::wstring eventName_Fail = msg.readWstring();
-				std::wstring eventName_Success = msg.readWstring();
-				std::wstring dumpPath = msg.readWstring();
-				std::wstring dumpName = msg.readWstring();
-				registerProcessMemoryDump(pid, eventName_Start, eventName_Fail, eventName_Success, dumpPath, dumpName);
-				break;
-			}
-			case Action::CRASHED_MODULE_INFO: {
-				const auto moduleName = msg.readString();
-				const auto modulePath = msg.readString();
-				log_info << "crashed_module_info " << moduleName << " (" << modulePath << ")" << std::endl;
-				break;
-			}
-			default:
-				break;
-			}
+			handleMessage(buffer);
 			buffer = this->socket->read();
 		}
 	}
+
+	stopDiscovery();
 	log_info << "End Watcher" << std::endl;
 }
 
+void ProcessManager::attachSession(std::shared_ptr<Socket> socket, const std::string &session, LogOutput *logOutput, const std::wstring &reportPath)
+{
+	this->socket = socket;
+	this->session = session;
+	this->logOutput = logOutput;
+	this->reportPath = reportPath;
+	startDiscovery();
+}
+
+void ProcessManager::detachSession()
+{
+	TraceSpan span("detachSession");
+	stopDiscovery();
+	const std::lock_guard<std::mutex> lock(this->monitorMtx);
+	if (this->monitor && this->monitor->worker->joinable())
+		this->monitor->worker->join();
+}
+
+void ProcessManager::stop()
+{
+	this->stopped = true;
+	if (this->watcher) {
+		this->watcher->send_stop();
+		if (this->socket)
+			this->socket->interrupt();
+	}
+}
+
+void ProcessManager::startDiscovery()
+{
+	if (!Options::get().discoverChildren)
+		return;
+
+	this->discovery = ProcessDiscovery::create(
+		[this](int32_t parent, int32_t child) {
+			LogScope scope(this->logOutput);
+			registerDiscoveredProcess(parent, child);
+		},
+		[this](int32_t pid, int32_t exitCode, int32_t termSignal) {
+			LogScope scope(this->logOutput);
+			unregisterDiscoveredProcess(pid, exitCode, termSignal);
+		});
+	if (!this->discovery)
+		log_info << "Process discovery is not supported on this platform" << std::endl;
+}
+
+void ProcessManager::stopDiscovery()
+{
+	// Discovery callbacks must not change the process list while the crash is handled
+	std::unique_ptr<ProcessDiscovery> stopping;
+	{
+		const std::lock_guard<std::mutex> lock(this->mtx);
+		stopping = std::move(this->discovery);
+	}
+	stopping.reset();
+}
+
+void ProcessManager::handleMessage(const std::vector<char> &buffer)
+{
+	static MetricCounter &messages = Metrics::getInstance()->counter("crash_handler_messages_total", "Messages handled");
+	static MetricHistogram &handling = Metrics::getInstance()->histogram("crash_handler_message_handling_seconds", "Time to handle a message", 1e-6);
+	messages.add();
+	MetricTimer timer(handling);
+
+	Message msg(buffer);
+	switch (static_cast<Action>(msg.readUInt8())) {
+	case Action::REGISTER: {
+		bool isCritical = msg.readBool();
+		uint32_t pid = msg.readUInt32();
+		size_t size = registerProcess(isCritical, pid);
+		if (isCritical)
+			interceptCrashes(pid);
+		if (size == 1)
+			startMonitoring();
+
+		break;
+	}
+	case Action::UNREGISTER: {
+		uint32_t pid = msg.readUInt32();
+		unregisterProcess(pid);
+		if (this->interceptor)
+			this->interceptor->detach(pid);
+		break;
+	}
+	case Action::REGISTERCONNECTION: {
+		bool isCritical = msg.readBool();
+		registerConnection(isCritical);
+		break;
+	}
+	case Action::REGISTERMEMORYDUMP: {
+		uint32_t pid = msg.readUInt32();
+		std::wstring eventName_Start = msg.readWstring();
+		std::wstring eventName_Fail = msg.readWstring();
+		std::wstring eventName_Success = msg.readWstring();
+		std::wstring dumpPath = msg.readWstring();
+		std::wstring dumpName = msg.readWstring();
+		registerProcessMemoryDump(pid, eventName_Start, eventName_Fail, eventName_Success, dumpPath, dumpName);
+		break;
+	}
+	case Action::REGISTERHEARTBEAT: {
+		uint32_t pid = msg.readUInt32();
+		uint32_t deadline_ms = msg.readUInt32();
+		registerProcessHeartbeat(pid, deadline_ms);
+		break;
+	}
+	case Action::CRASHWITHCODE: {
+		uint32_t pid = msg.readUInt32();
+		uint32_t code = msg.readUInt32();
+		uint64_t address = msg.readUInt64();
+		crashWithCode(pid, code, address);
+		break;
+	}
+	case Action::REGISTERCRASHCONTEXT: {
+		uint32_t pid = msg.readUInt32();
+		registerProcessCrashContext(pid);
+		break;
+	}
+	case Action::CRASHED_MODULE_INFO: {
+		const auto moduleName = msg.readString();
+		const auto modulePath = msg.readString();
+		log_info << "crashed_module_info " << moduleName << " (" << modulePath << ")" << std::endl;
+		break;
+	}
+	default:
+		break;
+	}
+}
+
 void ProcessManager::monitor_fnc()
 {
+	LogScope scope(this->logOutput);
+	Tracer::getInstance()->setThreadName("monitor");
 	log_info << "Start monitoring" << std::endl;
-	bool criticalCrash = false;
 	bool unresponsiveMarked = false;
-	uint32_t last_responsive_check = 0;
-	std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
-	bool validatedProcesses = false;
 
-	while (!this->monitor->wait_or_stop()) {
-		bool detectedUnresponsive = false;
+	// How late the monitor wakes up adds to every detection latency
+	static MetricHistogram &lag = Metrics::getInstance()->histogram("crash_handler_monitor_wakeup_lag_seconds", "Delay of monitor wakeups past their due time", 1e-6);
+	static MetricHistogram &tick = Metrics::getInstance()->histogram("crash_handler_monitor_checks_seconds", "Time to run the checks due in one wakeup", 1e-6);
+	auto due = std::chrono::steady_clock::now();
+
+	while (true) {
+		std::chrono::milliseconds wait(MONITOR_RESOLUTION_MS);
 		if (this->mtx.try_lock()) {
-			if (++last_responsive_check % 100 == 0)
-				last_responsive_check = 0;
-
-			bool willValidateProcesses = false;
-			if (!validatedProcesses) {
-				std::chrono::time_point<std::chrono::system_clock> now = std::chrono::system_clock::now();
-				auto diff = std::chrono::duration_cast<std::chrono::seconds>(now - start).count();
-				if (diff >= 7) { // check in 7 seconds after start
-					willValidateProcesses = true;
-					validatedProcesses = true;
-				}
+			const auto now = std::chrono::steady_clock::now();
+			lag.record(now > due ? std::chrono::duration_cast<std::chrono::microseconds>(now - due).count() : 0);
+			{
+				MetricTimer timer(tick);
+				this->scheduler.advance(now);
 			}
+			bool detectedUnresponsive = !this->unresponsiveProcesses.empty();
+			std::vector<HangReport> hangs;
+			hangs.swap(this->pendingHangReports);
+			wait = this->scheduler.timeUntilNext(now, std::chrono::milliseconds(MONITOR_MAX_SLEEP_MS));
+			this->mtx.unlock();
 
-			for (auto &process : this->processes) {
-				if (!process->isAlive() || (willValidateProcesses && !process->isValid())) {
-					// Log information about the process that just crashed
-					if (!process->isValid()) {
-						log_info << "process handle not valid" << std::endl;
-					} else {
-						log_info << "process died" << std::endl;
-					}
-					log_info << "process.pid: " << process->getPID() << std::endl;
-					log_info << "process.isCritical: " << process->isCritical() << std::endl;
-
-					m_criticalCrash |= process->isCritical();
-					m_applicationCrashed = true;
-				} else if (last_responsive_check == 0) {
-					detectedUnresponsive |= process->isUnResponsive();
-				}
-			}
+			if (!hangs.empty())
+				reportHangs(hangs);
 
-			this->mtx.unlock();
 			if (unresponsiveMarked && !detectedUnresponsive) {
 				log_info << "Unresponsive window not detected anymore " << std::endl;
-				Util::updateAppState(Util::AppState::Responsive);
+				this->appState.update(Util::AppState::Responsive);
 				unresponsiveMarked = false;
 			} else if (!unresponsiveMarked && detectedUnresponsive) {
 				log_info << "Unresponsive window detected " << std::endl;
-				Util::updateAppState(Util::AppState::Unresponsive);
+				this->appState.update(Util::AppState::Unresponsive);
 				unresponsiveMarked = true;
 			}
+			this->appState.persistIfDue(now);
+			wait = this->appState.timeUntilDue(now, wait);
 		}
 		if (m_applicationCrashed)
 			break;
+		due = std::chrono::steady_clock::now() + wait;
+		if (this->monitor->wait_or_stop(wait))
+			break;
+	}
+
+	if (this->sampler) {
+		this->sampler->send_stop();
+		this->sampler->worker->join();
 	}
 
 	if (m_applicationCrashed && !m_criticalCrash) {
 		log_info << "Non critical crash detected. save it to app state file" << std::endl;
-		Util::updateAppState(Util::AppState::NoncriticallyDead);
+		this->appState.update(Util::AppState::NoncriticallyDead);
 	}
+	this->appState.flush();
 
-	this->watcher->send_stop();
+	stop();
 #ifdef __APPLE__
 	if (m_applicationCrashed) {
 		std::vector<char> buffer;
 		buffer.push_back('-1');
-		this->socket->write(false, buffer);
+		this->socket->write(false, buffer, this->session);
 	}
 #endif
 	log_info << "End monitoring" << std::endl;
 }
 
+std::vector<std::unique_ptr<Process>>::iterator ProcessManager::findProcess(int32_t PID)
+{
+	return std::find_if(this->processes.begin(), this->processes.end(), [&PID](std::unique_ptr<Process> &p) { return p->getPID() == PID; });
+}
+
+void ProcessManager::scheduleProcessChecks(int32_t PID)
+{
+	// Spread the checks of different processes so they do not all land on the same tick
+	auto jitter = [PID](uint32_t period) {
+		const uint32_t spread = std::max<uint32_t>(period / 4, 1);
+		return std::chrono::milliseconds((static_cast<uint32_t>(PID) * 2654435761u) % spread);
+	};
+	const Options &options = Options::get();
+
+	// A process registered again gets one set of checks, the tasks are keyed by its pid
+	this->scheduler.cancel(static_cast<uint64_t>(PID));
+
+	// Every task is dropped once its process is gone from the list
+	const uint32_t liveness = options.livenessPeriodMs;
+	this->scheduler.schedule(jitter(liveness), std::chrono::milliseconds(liveness), [this, PID]() {
+		auto it = findProcess(PID);
+		if (it == this->processes.end())
+			return false;
+
+		auto &process = *it;
+		// A reported crash is being handled already
+		if (process->hasCrashReport())
+			return false;
+		if (process->isConnected() || process->isAlive())
+			return true;
+
+		if (process->isDiscovered()) {
+			log_info << "discovered process exited, pid: " << PID << std::endl;
+			if (this->discovery)
+				this->discovery->unwatch(PID);
+			this->processes.erase(it);
+			monitoredProcesses().add(-1);
+			return false;
+		}
+
+		static MetricCounter &crashes = Metrics::getInstance()->counter("crash_handler_crashes_detected_total", "Registered processes found dead");
+		crashes.add();
+		trace_instant("crash detected", [PID] { return "pid " + std::to_string(PID); });
+
+		// Log information about the process that just crashed
+		log_info << "process died" << std::endl;
+		log_info << "process.pid: " << PID << std::endl;
+		log_info << "process.isCritical: " << process->isCritical() << std::endl;
+
+		m_criticalCrash |= process->isCritical();
+		m_applicationCrashed = true;
+		return false;
+	}, PID);
+
+	const uint32_t responsiveness = options.responsivenessPeriodMs;
+	this->scheduler.schedule(std::chrono::milliseconds(responsiveness) + jitter(responsiveness), std::chrono::milliseconds(responsiveness), [this, PID]() {
+		auto it = findProcess(PID);
+		if (it == this->processes.end() || !(*it)->isAlive()) {
+			this->unresponsiveProcesses.erase(PID);
+			return it != this->processes.end();
+		}
+
+		if ((*it)->isUnResponsive()) {
+			static MetricCounter &unresponsive = Metrics::getInstance()->counter("crash_handler_unresponsive_checks_total", "Responsiveness checks that found a hung window");
+			unresponsive.add();
+			const bool snapshots = Options::get().hangSnapshots && !this->hangSnapshotsUnavailable;
+			if (this->unresponsiveProcesses.insert(PID).second && (snapshots || Options::get().threadActivity)) {
+				HangReport hang = {PID, {}};
+				auto activity = this->threadActivity.find(PID);
+				if (activity != this->threadActivity.end())
+					hang.threads = activity->second;
+				this->pendingHangReports.push_back(hang);
+			}
+		} else
+			this->unresponsiveProcesses.erase(PID);
+		return true;
+	}, PID);
+
+	// Threads are sampled all along, a hang report then says how long each one has been stuck
+	const uint32_t activity = options.threadActivityPeriodMs;
+	std::unique_ptr<ThreadMonitor> threadMonitor = options.threadActivity ? ThreadMonitor::create(PID) : nullptr;
+	if (threadMonitor) {
+		this->threadMonitors[PID] = std::move(threadMonitor);
+		this->scheduler.schedule(jitter(activity), std::chrono::milliseconds(activity), [this, PID]() {
+			auto it = findProcess(PID);
+			auto monitor = this->threadMonitors.find(PID);
+			if (it != this->processes.end() && (*it)->isAlive() && monitor != this->threadMonitors.end() && monitor->second->sample(this->threadActivity[PID]))
+				return true;
+
+			this->threadMonitors.erase(PID);
+			this->threadActivity.erase(PID);
+			return false;
+		}, PID);
+	}
+
+	const uint32_t telemetry = options.telemetryPeriodMs;
+	this->scheduler.schedule(jitter(telemetry), std::chrono::milliseconds(telemetry), [this, PID]() {
+		auto it = findProcess(PID);
+		if (it == this->processes.end())
+			return false;
+
+		if ((*it)->isAlive())
+			(*it)->sampleTelemetry();
+		return true;
+	}, PID);
+
+	if (this->monitor)
+		this->monitor->wake();
+}
+
 void ProcessManager::startMonitoring()
 {
+	// Started once, and never after the processes were handed over to the next instance, which stops it
+	const std::lock_guard<std::mutex> lock(this->mtx);
+	if (this->monitor || this->handedOver || this->stopped)
+		return;
+
+	const std::chrono::milliseconds period(Options::get().responsivenessPeriodMs);
+
+	// Ticks count from now on, the time since the manager was created is not replayed
+	this->scheduler.anchor(std::chrono::steady_clock::now());
+
+	// The window index is shared by every process, it is rebuilt once per responsiveness period
+	this->scheduler.schedule(period, period, []() {
+		WindowIndex::getInstance()->refresh();
+		return true;
+	});
+
+	// Processes that could not be opened are reported once, a while after start
+	this->scheduler.schedule(std::chrono::milliseconds(Options::get().validationDelayMs), std::chrono::milliseconds(0), [this]() {
+		for (auto &process : this->processes) {
+			if (process->isValid())
+				continue;
+
+			log_info << "process handle not valid" << std::endl;
+			log_info << "process.pid: " << process->getPID() << std::endl;
+			log_info << "process.isCritical: " << process->isCritical() << std::endl;
+
+			m_criticalCrash |= process->isCritical();
+			m_applicationCrashed = true;
+		}
+		return false;
+	});
+
 	this->monitor = new ThreadData();
 	this->monitor->should_stop = false;
 
@@ -197,11 +502,14 @@ void ProcessManager::startMonitoring()
 
 void ProcessManager::stopMonitoring()
 {
+	// A handover and the crash of a critical process may stop it from two threads at once
+	const std::lock_guard<std::mutex> lock(this->monitorMtx);
+	if (!this->monitor || !this->monitor->worker->joinable())
+		return;
+
 	log_info << "stop monitoring" << std::endl;
 	this->monitor->send_stop();
-
-	if (this->monitor->worker->joinable())
-		this->monitor->worker->join();
+	this->monitor->worker->join();
 }
 
 size_t ProcessManager::registerProcess(bool isCritical, uint32_t PID)
@@ -210,36 +518,209 @@ size_t ProcessManager::registerProcess(bool isCritical, uint32_t PID)
 	log_info << "pid " << PID << std::endl;
 	log_info << "isCritical " << isCritical << std::endl;
 
+	static MetricCounter &registrations = Metrics::getInstance()->counter("crash_handler_registrations_total", "Processes registered by the application");
+	registrations.add();
+
 	const std::lock_guard<std::mutex> lock(this->mtx);
 
 	auto it = std::find_if(this->processes.begin(), this->processes.end(), [&PID](std::unique_ptr<Process> &p) { return p->getPID() == PID; });
 	if (it == this->processes.end()) {
 		this->processes.push_back(Process::create(PID, isCritical));
+		monitoredProcesses().add(1);
+		scheduleProcessChecks(PID);
+		if (!Options::get().freezeCgroup.empty() && !this->freezerUnavailable)
+			groupProcess(PID);
 	}
+	if (isCritical && this->discovery)
+		this->discovery->watch(PID);
 	log_info << "Processes size: " << this->processes.size() << std::endl;
 	return this->processes.size();
 }
 
 void ProcessManager::unregisterProcess(uint32_t PID)
 {
-	const std::lock_guard<std::mutex> lock(this->mtx);
+	bool critical = false;
+	{
+		const std::lock_guard<std::mutex> lock(this->mtx);
 
-	auto it = std::find_if(this->processes.begin(), this->processes.end(), [&PID](std::unique_ptr<Process> &p) { return p->getPID() == PID; });
+		auto it = std::find_if(this->processes.begin(), this->processes.end(), [&PID](std::unique_ptr<Process> &p) { return p->getPID() == PID; });
 
-	if (it == this->processes.end())
-		return;
+		if (it == this->processes.end())
+			return;
 
-	log_info << "unregister process" << std::endl;
-	log_info << "pid " << PID << std::endl;
-	log_info << "isCritical " << (*it)->isCritical() << std::endl;
+		static MetricCounter &unregistrations =
+			Metrics::getInstance()->counter("crash_handler_unregistrations_total", "Processes unregistered by the application");
+		unregistrations.add();
+		log_info << "unregister process" << std::endl;
+		log_info << "pid " << PID << std::endl;
+		log_info << "isCritical " << (*it)->isCritical() << std::endl;
 
-	if ((*it)->isCritical()) {
-		this->watcher->send_stop();
+		if (this->discovery)
+			this->discovery->unwatch(PID);
+		if (this->crashContexts)
+			this->crashContexts->detach(PID);
+		if (this->freezer)
+			this->freezer->remove(PID);
+		this->unresponsiveProcesses.erase(PID);
+
+		// Set under mtx, so no monitor is started after this one is stopped
+		critical = (*it)->isCritical();
+		if (critical)
+			stop();
+
+		this->processes.erase(it);
+		monitoredProcesses().add(-1);
+	}
+
+	// The monitor may be waiting on the tracer, which takes mtx to report a crash, so it is joined without holding mtx
+	if (critical) {
 		this->stopMonitoring();
 		this->sendExitMessage(false);
 	}
+}
+
+void ProcessManager::registerConnection(bool isCritical)
+{
+	int pidfd = -1;
+	const int connection = this->socket->takeConnection(pidfd);
+	if (connection < 0) {
+		log_info << "register connection is not supported on this platform" << std::endl;
+		return;
+	}
+
+	if (!this->connections) {
+		this->connections = ConnectionWatcher::create([this](int32_t pid, ConnectionWatcher::Close reason) {
+			LogScope scope(this->logOutput);
+			connectionClosed(pid, reason);
+		});
+	}
+	const int32_t PID = this->connections ? this->connections->watch(connection, pidfd) : 0;
+	if (PID <= 0) {
+		log_error << "Failed to watch the connection of a registering process" << std::endl;
+		return;
+	}
+
+	size_t size = registerProcess(isCritical, PID);
+	if (isCritical)
+		interceptCrashes(PID);
+	{
+		const std::lock_guard<std::mutex> lock(this->mtx);
+		auto it = findProcess(PID);
+		if (it != this->processes.end())
+			(*it)->markConnected(true);
+	}
+	if (size == 1)
+		startMonitoring();
+}
 
+void ProcessManager::crashWithCode(uint32_t PID, uint32_t code, uint64_t address)
+{
+	// Sent from the signal or exception handler of the crashing process, which is still dying
+	const auto received = std::chrono::steady_clock::now();
+	const std::lock_guard<std::mutex> lock(this->mtx);
+	auto it = findProcess(PID);
+	if (it == this->processes.end() || (*it)->isDiscovered()) {
+		log_info << "crash reported by a process that is not registered, pid: " << PID << std::endl;
+		return;
+	}
+
+	auto &process = *it;
+	if (process->hasCrashReport())
+		return;
+	process->markCrashReported(code, address, received);
+
+	static MetricCounter &reports = Metrics::getInstance()->counter("crash_handler_crash_reports_total", "Crashes reported by the crashing process");
+	reports.add();
+	trace_instant("crash reported", [PID, code] { return "pid " + std::to_string(PID) + " code " + formatHex(code); });
+
+	log_info << "process reported a crash" << std::endl;
+	log_info << "process.pid: " << PID << std::endl;
+	log_info << "process.isCritical: " << process->isCritical() << std::endl;
+	log_info << "process.crashCode: " << formatHex(code) << std::endl;
+	log_info << "process.crashAddress: " << formatHex(address) << std::endl;
+
+	m_criticalCrash |= process->isCritical();
+	m_applicationCrashed = true;
+	if (this->monitor)
+		this->monitor->wake();
+}
+
+void ProcessManager::connectionClosed(int32_t PID, ConnectionWatcher::Close reason)
+{
+	if (reason == ConnectionWatcher::Close::Unregistered) {
+		unregisterProcess(PID);
+		if (this->interceptor)
+			this->interceptor->detach(PID);
+		return;
+	}
+
+	const std::lock_guard<std::mutex> lock(this->mtx);
+	auto it = findProcess(PID);
+	if (it == this->processes.end() || !(*it)->isConnected())
+		return;
+
+	auto &process = *it;
+	if (process->hasCrashReport())
+		return;
+	if (reason == ConnectionWatcher::Close::Detached) {
+		// The pid is polled again like a process registered without its connection
+		log_info << "process closed its connection, pid: " << PID << std::endl;
+		process->markConnected(false);
+		return;
+	}
+
+	static MetricCounter &crashes = Metrics::getInstance()->counter("crash_handler_crashes_detected_total", "Registered processes found dead");
+	crashes.add();
+	trace_instant("crash detected", [PID] { return "pid " + std::to_string(PID); });
+
+	log_info << "process died" << std::endl;
+	log_info << "process.pid: " << PID << std::endl;
+	log_info << "process.isCritical: " << process->isCritical() << std::endl;
+
+	m_criticalCrash |= process->isCritical();
+	m_applicationCrashed = true;
+	if (this->monitor)
+		this->monitor->wake();
+}
+
+void ProcessManager::registerDiscoveredProcess(int32_t parentPID, int32_t PID)
+{
+	const std::lock_guard<std::mutex> lock(this->mtx);
+	if (!this->discovery)
+		return;
+
+	auto it = std::find_if(this->processes.begin(), this->processes.end(), [&PID](std::unique_ptr<Process> &p) { return p->getPID() == PID; });
+	if (it == this->processes.end()) {
+		log_info << "discovered process " << PID << ", parent " << parentPID << std::endl;
+		static MetricCounter &discovered = Metrics::getInstance()->counter("crash_handler_discovered_processes_total", "Child processes found by discovery");
+		discovered.add();
+		this->processes.push_back(Process::create(PID, false));
+		this->processes.back()->markDiscovered();
+		monitoredProcesses().add(1);
+		scheduleProcessChecks(PID);
+	}
+
+	// Descendants of a watched process are watched too, registered or not
+	this->discovery->watch(PID);
+}
+
+void ProcessManager::unregisterDiscoveredProcess(int32_t PID, int32_t exitCode, int32_t termSignal)
+{
+	const std::lock_guard<std::mutex> lock(this->mtx);
+	if (!this->discovery)
+		return;
+
+	auto it = std::find_if(this->processes.begin(), this->processes.end(), [&PID](std::unique_ptr<Process> &p) { return p->getPID() == PID; });
+	this->discovery->unwatch(PID);
+	if (it == this->processes.end() || !(*it)->isDiscovered())
+		return;
+
+	if (termSignal)
+		log_info << "discovered process " << PID << " killed by signal " << termSignal << std::endl;
+	else
+		log_info << "discovered process " << PID << " exited with code " << (exitCode >> 8) << std::endl;
 	this->processes.erase(it);
+	monitoredProcesses().add(-1);
 }
 
 void ProcessManager::registerProcessMemoryDump(uint32_t PID, const std::wstring &eventName_Start, const std::wstring &eventName_Fail,
@@ -255,14 +736,500 @@ void ProcessManager::registerProcessMemoryDump(uint32_t PID, const std::wstring
 
 	log_info << "register for memory dump" << std::endl;
 	(*it)->startMemoryDumpMonitoring(eventName_Start, eventName_Fail, eventName_Success, dumpPath, dumpName);
+	(*it)->markBound();
+}
+
+void ProcessManager::registerProcessHeartbeat(uint32_t PID, uint32_t deadline_ms)
+{
+	const std::lock_guard<std::mutex> lock(this->mtx);
+
+	log_info << "requested heartbeat monitoring for pid = " << PID << std::endl;
+	auto it = std::find_if(this->processes.begin(), this->processes.end(), [&PID](std::unique_ptr<Process> &p) { return p->getPID() == PID; });
+
+	int32_t slot = -1;
+	int descriptor = -1;
+	if (it == this->processes.end() || !(*it)->startHeartbeatMonitoring(deadline_ms, slot, descriptor)) {
+		slot = -1;
+		descriptor = -1;
+	} else {
+		(*it)->markBound();
+	}
+
+	// The reply carries the slot index, and the shared segment as ancillary data
+	std::vector<char> buffer(sizeof(int32_t));
+	memcpy(buffer.data(), &slot, sizeof(int32_t));
+	std::vector<int> descriptors;
+	if (descriptor >= 0)
+		descriptors.push_back(descriptor);
+	if (!this->socket->reply(buffer, descriptors))
+		log_info << "Failed to reply to heartbeat registration" << std::endl;
+}
+
+void ProcessManager::registerProcessCrashContext(uint32_t PID)
+{
+	const std::lock_guard<std::mutex> lock(this->mtx);
+
+	log_info << "requested crash context for pid = " << PID << std::endl;
+	auto it = findProcess(PID);
+	if (it != this->processes.end() && !this->crashContexts) {
+		this->crashContexts = CrashContextChannel::create([this](int32_t pid, const CrashContext &context) {
+			LogScope scope(this->logOutput);
+			crashContextReported(pid, context);
+		});
+	}
+
+	int32_t status = -1;
+	int page = -1;
+	int event = -1;
+	if (it != this->processes.end() && this->crashContexts && this->crashContexts->attach(PID, page, event)) {
+		(*it)->markBound();
+		status = 0;
+	}
+
+	// The reply carries the status, and the page and its eventfd as ancillary data
+	std::vector<char> buffer(sizeof(int32_t));
+	memcpy(buffer.data(), &status, sizeof(int32_t));
+	std::vector<int> descriptors;
+	if (status == 0)
+		descriptors = {page, event};
+	if (!this->socket->reply(buffer, descriptors))
+		log_info << "Failed to reply to crash context registration" << std::endl;
+}
+
+void ProcessManager::crashContextReported(int32_t PID, const CrashContext &context)
+{
+	log_info << "crash context of pid " << PID << ": thread " << context.tid << ", signal " << context.signal << ", code " << context.code << ", ip "
+		 << formatHex(context.instruction_pointer) << ", sp " << formatHex(context.stack_pointer) << std::endl;
+
+	std::string registers;
+	for (uint32_t i = 0; i < context.register_count; i++)
+		registers += (i ? " " : "") + formatHex(context.registers[i]);
+	if (!registers.empty())
+		log_info << "crash context registers: " << registers << std::endl;
+
+	crashWithCode(PID, static_cast<uint32_t>(context.signal), context.address);
+}
+
+CrashInterceptor *ProcessManager::getInterceptor()
+{
+	const std::lock_guard<std::mutex> lock(this->mtx);
+	if (!this->interceptor) {
+		this->interceptor = CrashInterceptor::create([this](int32_t pid, const CrashSnapshot &snapshot) {
+			LogScope scope(this->logOutput);
+			crashIntercepted(pid, snapshot);
+		});
+	}
+	return this->interceptor.get();
+}
+
+void ProcessManager::interceptCrashes(uint32_t PID)
+{
+	// Not under mtx, the tracer thread takes it to report a crash while it serves requests
+	if (!Options::get().interceptCrashes || this->interceptionUnavailable)
+		return;
+
+	CrashInterceptor *interceptor = getInterceptor();
+	if (!interceptor) {
+		log_info << "Crash interception is not supported on this platform" << std::endl;
+		this->interceptionUnavailable = true;
+		return;
+	}
+	if (!interceptor->attach(PID))
+		log_info << "Crashes of pid " << PID << " are not intercepted, ptrace may be restricted by kernel.yama.ptrace_scope" << std::endl;
+}
+
+void ProcessManager::crashIntercepted(int32_t PID, const CrashSnapshot &snapshot)
+{
+	TraceSpan span("crashIntercepted", [PID] { return "pid " + std::to_string(PID); });
+	// The process is held at the faulting instruction until this returns
+	saveMemoryDump(PID, &snapshot);
+	writeCrashSnapshot(PID, snapshot, "crash");
+	crashContextReported(PID, snapshot.context);
+}
+
+void ProcessManager::groupProcess(int32_t PID)
+{
+	if (!this->freezer) {
+		this->freezer = ProcessFreezer::create(Options::get().freezeCgroup);
+		if (!this->freezer) {
+			log_info << "Registered processes are not grouped, they are captured one by one" << std::endl;
+			this->freezerUnavailable = true;
+			return;
+		}
+	}
+	this->freezer->add(PID);
+}
+
+bool ProcessManager::saveMemoryDump(int32_t PID, const CrashSnapshot *snapshot)
+{
+	std::wstring dumpPath;
+	std::wstring dumpName;
+	{
+		const std::lock_guard<std::mutex> lock(this->mtx);
+		auto it = findProcess(PID);
+		if (it == this->processes.end() || !(*it)->getMemoryDumpRequest(dumpPath, dumpName))
+			return false;
+	}
+
+	TraceSpan span("saveMemoryDump", [PID] { return "pid " + std::to_string(PID); });
+	return Util::saveMemoryDump(static_cast<uint32_t>(PID), dumpPath, dumpName, snapshot);
+}
+
+void ProcessManager::captureFrozenGroup()
+{
+	TraceSpan span("captureFrozenGroup");
+	static MetricHistogram &freezing = Metrics::getInstance()->histogram("crash_handler_freeze_seconds", "Time for the process group to freeze", 1e-6);
+	static MetricHistogram &frozenFor = Metrics::getInstance()->histogram("crash_handler_frozen_seconds", "Time the process group stays frozen while captured", 1e-6);
+	const auto started = std::chrono::steady_clock::now();
+	if (!this->freezer->freeze(std::chrono::milliseconds(FREEZE_TIMEOUT_MS)))
+		log_info << "Process group did not freeze in time, members are captured as they are" << std::endl;
+	const auto frozen = std::chrono::steady_clock::now();
+
+	// Members forked by registered processes are in the group too
+	const std::vector<int32_t> members = this->freezer->members();
+	std::vector<CrashSnapshot> snapshots(members.size());
+	std::vector<char> captured(members.size(), false);
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < members.size(); i++) {
+		workers.push_back(std::thread([this, &members, &snapshots, &captured, i]() {
+			TraceSpan span("capture", [&members, i] { return "pid " + std::to_string(members[i]); });
+			captured[i] = this->freezer->capture(members[i], snapshots[i]);
+			saveMemoryDump(members[i]);
+		}));
+	}
+	for (auto &worker : workers)
+		worker.join();
+	this->freezer->thaw();
+
+	const auto freezeTime = std::chrono::duration_cast<std::chrono::microseconds>(frozen - started);
+	const auto frozenTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - frozen);
+	freezing.record(freezeTime.count());
+	frozenFor.record(frozenTime.count());
+	log_info << "Process group frozen in " << freezeTime.count() << " us, " << members.size() << " members captured in " << frozenTime.count() << " us"
+		 << std::endl;
+
+	// Files are written once the group runs again
+	for (size_t i = 0; i < members.size(); i++) {
+		if (captured[i])
+			writeCrashSnapshot(members[i], snapshots[i], "frozen");
+		else
+			log_info << "Failed to capture pid " << members[i] << std::endl;
+	}
+}
+
+void ProcessManager::reportHangs(const std::vector<HangReport> &hangs)
+{
+	if (this->reportPath.empty())
+		return;
+
+	const bool snapshots = Options::get().hangSnapshots && !this->hangSnapshotsUnavailable;
+	CrashInterceptor *interceptor = snapshots ? getInterceptor() : nullptr;
+	if (snapshots && !interceptor) {
+		log_info << "Hang snapshots are not supported on this platform" << std::endl;
+		this->hangSnapshotsUnavailable = true;
+	}
+
+	static MetricHistogram &duration = Metrics::getInstance()->histogram("crash_handler_hang_snapshot_seconds", "Time to hold and write a hung process", 1e-6);
+	const auto now = std::chrono::steady_clock::now();
+	const std::chrono::seconds interval(Options::get().hangSnapshotIntervalS);
+	for (const HangReport &hang : hangs) {
+		const int32_t PID = hang.pid;
+		auto last = this->lastHangSnapshots.find(PID);
+		if (last != this->lastHangSnapshots.end() && now - last->second < interval)
+			continue;
+		this->lastHangSnapshots[PID] = now;
+
+		const std::string stem = std::string(this->reportPath.begin(), this->reportPath.end()) + ".hang-" + std::to_string(PID) + "-" + std::to_string(time(nullptr));
+		if (!hang.threads.empty())
+			writeThreadActivity(PID, hang.threads, stem + ".threads.json");
+		if (!interceptor)
+			continue;
+
+		{
+			TraceSpan span("snapshotHang", [PID] { return "pid " + std::to_string(PID); });
+			MetricTimer timer(duration);
+			if (interceptor->snapshot(PID, stem + ".dmp"))
+				log_info << "Hang snapshot of pid " << PID << " written to " << stem << ".dmp" << std::endl;
+			else
+				log_info << "Failed to take a hang snapshot of pid " << PID << std::endl;
+		}
+
+		// One snapshot may land on a benign frame, the profile then shows where the time goes
+		if (Options::get().hangProfileMs) {
+			HangProfile profile;
+			profile.path = stem + ".folded";
+			profile.next = now;
+			profile.end = now + std::chrono::milliseconds(Options::get().hangProfileMs);
+			startHangProfile(PID, profile);
+		}
+	}
+}
+
+void ProcessManager::startHangProfile(int32_t PID, const HangProfile &profile)
+{
+	{
+		const std::lock_guard<std::mutex> lock(this->profileMtx);
+		this->pendingHangProfiles.emplace_back(PID, profile);
+	}
+	if (this->sampler) {
+		this->sampler->wake();
+		return;
+	}
+	this->sampler = new ThreadData();
+	this->sampler->should_stop = false;
+	this->sampler->worker = new std::thread(&ProcessManager::sampler_fnc, this);
+}
+
+void ProcessManager::sampler_fnc()
+{
+	LogScope scope(this->logOutput);
+	Tracer::getInstance()->setThreadName("sampler");
+	std::chrono::milliseconds wait(0);
+	while (!this->sampler->wait_or_stop(wait)) {
+		{
+			const std::lock_guard<std::mutex> lock(this->profileMtx);
+			for (const auto &pending : this->pendingHangProfiles) {
+				// A process found unresponsive again while profiled goes on with the samples it has
+				HangProfile &profile = this->hangProfiles[pending.first];
+				profile.path = pending.second.path;
+				profile.next = pending.second.next;
+				profile.end = pending.second.end;
+			}
+			this->pendingHangProfiles.clear();
+		}
+		wait = sampleHangs();
+	}
+
+	// A profile cut short by the end of monitoring still shows where the time went
+	for (const auto &profile : this->hangProfiles)
+		writeHangProfile(profile.first, profile.second);
+	this->hangProfiles.clear();
+}
+
+void ProcessManager::writeThreadActivity(int32_t PID, const std::vector<ThreadActivity> &threads, const std::string &path)
+{
+	// The main thread comes first, then the threads stuck the longest, spinning ones before blocked ones and idle workers last
+	std::vector<ThreadActivity> ordered = threads;
+	std::stable_sort(ordered.begin(), ordered.end(), [PID](const ThreadActivity &a, const ThreadActivity &b) {
+		auto rank = [PID](const ThreadActivity &thread) {
+			if (thread.tid == PID)
+				return 0;
+			switch (thread.state) {
+			case ThreadActivity::Spinning:
+				return 1;
+			case ThreadActivity::Blocked:
+				return 2;
+			case ThreadActivity::Idle:
+				return 3;
+			default:
+				return 4;
+			}
+		};
+		return rank(a) != rank(b) ? rank(a) < rank(b) : a.stuckMs > b.stuckMs;
+	});
+
+	std::ofstream report(path, std::ios::trunc | std::ios::out);
+	report << "{\"pid\":" << PID << ",\"threads\":[";
+	for (size_t i = 0; i < ordered.size(); i++) {
+		const ThreadActivity &thread = ordered[i];
+		report << (i ? "," : "") << "{\"tid\":" << thread.tid << ",\"name\":\"" << escapeJson(thread.name) << "\",\"state\":\""
+		       << ThreadMonitor::stateName(thread.state) << "\",\"kernel_state\":\"" << escapeJson(std::string(1, thread.kernelState))
+		       << "\",\"wchan\":\"" << escapeJson(thread.wchan) << "\",\"cpu\":" << std::fixed << std::setprecision(3) << thread.cpu
+		       << ",\"stuck_ms\":" << thread.stuckMs << "}";
+	}
+	report << "]}" << std::endl;
+	report.close();
+	if (report.fail()) {
+		log_info << "Failed to write " << path << std::endl;
+		return;
+	}
+
+	// Only the main thread, spinning ones and ones blocked in a known wait other than an idle one are named in the log
+	for (const ThreadActivity &thread : ordered) {
+		if (thread.tid != PID && thread.state != ThreadActivity::Spinning && (thread.state != ThreadActivity::Blocked || thread.wchan.empty()))
+			continue;
+		log_info << "Unresponsive pid " << PID << " thread " << thread.tid << " (" << thread.name << ") " << ThreadMonitor::stateName(thread.state)
+			 << (thread.wchan.empty() ? "" : " in " + thread.wchan) << (thread.stuckMs ? " for " + std::to_string(thread.stuckMs) + " ms" : "") << std::endl;
+	}
+	log_info << "Thread activity of pid " << PID << " written to " << path << std::endl;
+}
+
+std::chrono::milliseconds ProcessManager::sampleHangs()
+{
+	CrashInterceptor *interceptor = getInterceptor();
+	const std::chrono::milliseconds period(std::max<uint32_t>(Options::get().hangProfilePeriodMs, 1));
+	std::chrono::milliseconds wait(MONITOR_MAX_SLEEP_MS);
+	for (auto it = this->hangProfiles.begin(); it != this->hangProfiles.end();) {
+		HangProfile &profile = it->second;
+		const auto now = std::chrono::steady_clock::now();
+		if (now >= profile.next) {
+			std::vector<ThreadStack> stacks;
+			const bool sampled = interceptor && interceptor->sample(it->first, stacks);
+			if (sampled) {
+				profile.samples++;
+				for (const ThreadStack &stack : stacks) {
+					// Folded stacks, outermost frame first under the thread name
+					std::string folded = stack.name.empty() ? std::to_string(stack.tid) : stack.name;
+					std::replace(folded.begin(), folded.end(), ' ', '_');
+					std::replace(folded.begin(), folded.end(), ';', '_');
+					for (auto frame = stack.frames.rbegin(); frame != stack.frames.rend(); ++frame)
+						folded += ";" + *frame;
+					profile.folded[folded]++;
+				}
+			}
+
+			// A late wakeup does not make up for the samples it missed
+			profile.next = std::max(profile.next + period, now);
+			if (!sampled || profile.next >= profile.end) {
+				writeHangProfile(it->first, profile);
+				it = this->hangProfiles.erase(it);
+				continue;
+			}
+		}
+		wait = std::min(wait, std::chrono::ceil<std::chrono::milliseconds>(profile.next - now));
+		++it;
+	}
+	return wait;
+}
+
+void ProcessManager::writeHangProfile(int32_t PID, const HangProfile &profile)
+{
+	if (!profile.samples) {
+		log_info << "No stack samples of pid " << PID << std::endl;
+		return;
+	}
+
+	std::ofstream file(profile.path, std::ios::trunc | std::ios::out);
+	for (const auto &entry : profile.folded)
+		file << entry.first << " " << entry.second << "\n";
+	file.close();
+	if (file.fail()) {
+		log_info << "Failed to write " << profile.path << std::endl;
+		return;
+	}
+	log_info << "Hang profile of pid " << PID << ", " << profile.samples << " samples written to " << profile.path << std::endl;
+}
+
+void ProcessManager::writeCrashSnapshot(int32_t PID, const CrashSnapshot &snapshot, const std::string &kind)
+{
+	if (this->reportPath.empty())
+		return;
+
+	std::ofstream report;
+	const std::string suffix = "." + kind + "-" + std::to_string(PID) + ".json";
+#if defined(WIN32)
+	report.open(this->reportPath + std::wstring(suffix.begin(), suffix.end()), std::ios::trunc | std::ios::out);
+#else
+	report.open(std::string(this->reportPath.begin(), this->reportPath.end()) + suffix, std::ios::trunc | std::ios::out);
+#endif
+	if (!report.is_open()) {
+		log_info << "Failed to open crash snapshot" << std::endl;
+		return;
+	}
+
+	auto writeRegisters = [&report](const uint64_t *registers, uint32_t count) {
+		report << "[";
+		for (uint32_t i = 0; i < count; i++)
+			report << (i ? "," : "") << "\"" << formatHex(registers[i]) << "\"";
+		report << "]";
+	};
+
+	const CrashContext &context = snapshot.context;
+	report << "{\"pid\":" << PID << ",\"tid\":" << context.tid << ",\"signal\":" << context.signal << ",\"code\":" << context.code << ",\"address\":\""
+	       << formatHex(context.address) << "\",\"ip\":\"" << formatHex(context.instruction_pointer) << "\",\"sp\":\"" << formatHex(context.stack_pointer)
+	       << "\",\"registers\":";
+	writeRegisters(context.registers, context.register_count);
+	report << ",\"threads\":[";
+	for (size_t i = 0; i < snapshot.threads.size(); i++) {
+		report << (i ? "," : "") << "{\"tid\":" << snapshot.threads[i].tid << ",\"ip\":\"" << formatHex(snapshot.threads[i].instruction_pointer) << "\",\"sp\":\""
+		       << formatHex(snapshot.threads[i].stack_pointer) << "\",\"registers\":";
+		writeRegisters(snapshot.threads[i].registers, snapshot.threads[i].register_count);
+		report << "}";
+	}
+	report << "],\"stack\":{\"address\":\"" << formatHex(snapshot.stack_address) << "\",\"bytes\":\"";
+	static const char digits[] = "0123456789abcdef";
+	for (uint8_t byte : snapshot.stack)
+		report << digits[byte >> 4] << digits[byte & 0xf];
+	report << "\"}}\n";
+	log_info << "Snapshot of pid " << PID << " written to " << std::string(this->reportPath.begin(), this->reportPath.end()) << suffix << std::endl;
+}
+
+bool ProcessManager::handOver(std::vector<char> &state)
+{
+	{
+		const std::lock_guard<std::mutex> lock(this->mtx);
+		if (m_applicationCrashed || this->stopped)
+			return false;
+
+		// Discovered processes are found again by the next instance. Only pids are passed on, a process also
+		// registered with its connection or for a heartbeat, a dump or a crash context keeps this handler.
+		std::vector<Process *> registered;
+		for (auto &process : this->processes) {
+			if (process->isDiscovered())
+				continue;
+			if (process->isConnected() || process->isBound()) {
+				log_info << "Refusing the handover, pid " << process->getPID() << " has registrations that stay with this handler" << std::endl;
+				return false;
+			}
+			registered.push_back(process.get());
+		}
+
+		state.resize(sizeof(uint32_t));
+		const uint32_t count = static_cast<uint32_t>(registered.size());
+		memcpy(state.data(), &count, sizeof(count));
+		for (Process *process : registered) {
+			const uint32_t pid = static_cast<uint32_t>(process->getPID());
+			state.insert(state.end(), reinterpret_cast<const char *>(&pid), reinterpret_cast<const char *>(&pid) + sizeof(pid));
+			state.push_back(process->isCritical());
+		}
+		this->handedOver = true;
+	}
+
+	// No monitor starts once handedOver is set, the one running if any is stopped here
+	stop();
+	stopMonitoring();
+	return true;
+}
+
+void ProcessManager::adoptProcesses(const std::vector<char> &state)
+{
+	if (state.size() < sizeof(uint32_t))
+		return;
+
+	Message msg(state);
+	const uint32_t count = msg.readUInt32();
+	log_info << "Adopting " << count << " processes from the previous crash handler" << std::endl;
+	for (uint32_t i = 0; i < count; i++) {
+		const uint32_t pid = msg.readUInt32();
+		const bool isCritical = msg.readBool();
+		const size_t size = registerProcess(isCritical, pid);
+		if (isCritical)
+			interceptCrashes(pid);
+		if (size == 1)
+			startMonitoring();
+	}
 }
 
 void ProcessManager::handleCrash(std::wstring path)
 {
+	static MetricHistogram &handling = Metrics::getInstance()->histogram("crash_handler_crash_handling_seconds", "Time from handling a crash to terminating the application", 1e-6);
+	MetricTimer timer(handling);
+	TraceSpan span("handleCrash");
+	// The time a reported crash saves is the time the process takes to die, which polling would have waited for
+	static MetricHistogram &reportLead = Metrics::getInstance()->histogram("crash_handler_crash_report_to_handling_seconds", "Time from a crash report to handling the crash", 1e-6);
+	static MetricCounter &aheadOfExit = Metrics::getInstance()->counter("crash_handler_crash_reports_ahead_of_exit_total", "Reported crashes handled while the process was still alive");
+	const auto now = std::chrono::steady_clock::now();
 	log_info << "Handling crash - processes state: " << std::endl;
 	for (auto &process : this->processes) {
 		log_info << "----" << std::endl;
-		if (process->isAlive()) {
+		if (process->hasCrashReport()) {
+			const auto lead = std::chrono::duration_cast<std::chrono::microseconds>(now - process->getCrashReportedAt());
+			reportLead.record(lead.count());
+			if (process->isAlive())
+				aheadOfExit.add();
+			log_info << "process.pid: " << process->getPID() << " (reported crash " << formatHex(process->getCrashCode()) << " at "
+				 << formatHex(process->getCrashAddress()) << ", " << lead.count() << " us ago)" << std::endl;
+		} else if (process->isAlive()) {
 			log_info << "process.pid: " << process->getPID() << std::endl;
 		} else {
 			log_info << "process.pid: " << process->getPID() << " (not alive)" << std::endl;
@@ -272,6 +1239,10 @@ void ProcessManager::handleCrash(std::wstring path)
 		log_info << "process.isCritical: " << process->isCritical() << std::endl;
 	}
 	log_info << "----" << std::endl;
+	// Captured before anything is terminated, every member as it was at the same instant
+	if (m_criticalCrash && this->freezer)
+		captureFrozenGroup();
+	writeTelemetryReport();
 
 	bool shouldRestart = false;
 	if (m_criticalCrash) {
@@ -281,6 +1252,7 @@ void ProcessManager::handleCrash(std::wstring path)
 		terminateNonCritical();
 		// Blocking operation that will return once the user
 		// decides to terminate the application
+		TraceSpan window("runTerminateWindow");
 		Util::runTerminateWindow(shouldRestart);
 		log_info << "Send exit message" << std::endl;
 		this->sendExitMessage(true);
@@ -290,36 +1262,119 @@ void ProcessManager::handleCrash(std::wstring path)
 		Util::restartApp(path);
 }
 
+void ProcessManager::writeTelemetryReport(void)
+{
+	TraceSpan span("writeTelemetryReport");
+	if (this->reportPath.empty())
+		return;
+
+	std::ofstream report;
+#if defined(WIN32)
+	report.open(this->reportPath + L".telemetry.json", std::ios::trunc | std::ios::out);
+#else
+	report.open(std::string(this->reportPath.begin(), this->reportPath.end()) + ".telemetry.json", std::ios::trunc | std::ios::out);
+#endif
+	if (!report.is_open()) {
+		log_info << "Failed to open telemetry report" << std::endl;
+		return;
+	}
+
+	report << "[";
+	for (size_t i = 0; i < this->processes.size(); i++) {
+		auto &process = this->processes[i];
+		std::vector<TelemetrySample> samples = process->getTelemetry();
+		if (!samples.empty()) {
+			const TelemetrySample &last = samples.back();
+			log_info << "process.pid: " << process->getPID() << " last sample rss " << last.rss_bytes << ", threads " << last.threads
+				 << ", fds " << last.open_fds << ", cpu ms " << last.cpu_time_ms << std::endl;
+		}
+
+		report << (i ? "," : "") << "{\"pid\":" << process->getPID() << ",\"critical\":" << (process->isCritical() ? "true" : "false")
+		       << ",\"alive\":" << (process->isAlive() ? "true" : "false");
+		if (process->hasCrashReport())
+			report << ",\"crashCode\":" << process->getCrashCode() << ",\"crashAddress\":" << process->getCrashAddress();
+		report << ",\"samples\":";
+		TelemetryRing::writeJson(report, samples);
+		report << "}";
+	}
+	report << "]\n";
+}
+
 void ProcessManager::sendExitMessage(bool appCrashed)
 {
 	std::vector<char> buffer;
 	buffer.push_back(appCrashed);
 
-	if (this->socket->write(true, buffer) <= 0)
+	if (this->socket->write(true, buffer, this->session) <= 0)
 		log_info << "Failed to send exit message" << std::endl;
 }
 
 void ProcessManager::terminateAll(void)
 {
+	std::vector<Process *> targets;
+	for (auto &process : this->processes)
+		targets.push_back(process.get());
 
-	std::vector<std::thread> workers;
+	terminateProcesses(targets);
+}
 
-	// What if the head process is busy? Do we really want the other processes to keep running?
-	// Instead, seperate these out into workers so that non-busy processes are killed asap
+void ProcessManager::terminateNonCritical(void)
+{
+	std::vector<Process *> targets;
 	for (auto &process : this->processes) {
-		workers.push_back(std::thread([](Process *ptr) { ptr->terminate(); }, process.get()));
+		if (!process->isCritical())
+			targets.push_back(process.get());
 	}
 
-	for (auto &itr : workers) {
-		if (itr.joinable())
-			itr.join();
-	}
+	terminateProcesses(targets);
 }
 
-void ProcessManager::terminateNonCritical(void)
+void ProcessManager::terminateProcesses(const std::vector<Process *> &targets)
 {
-	for (auto &process : this->processes) {
-		if (!process->isCritical())
-			process->terminate();
+	TraceSpan span("terminateProcesses");
+	std::unique_ptr<TerminationEngine> engine = TerminationEngine::create();
+	if (!engine) {
+		std::vector<std::thread> workers;
+
+		// What if the head process is busy? Do we really want the other processes to keep running?
+		// Instead, seperate these out into workers so that non-busy processes are killed asap
+		for (Process *process : targets) {
+			workers.push_back(std::thread(
+				[](Process *ptr) {
+					TraceSpan span("terminate", [&ptr] { return "pid " + std::to_string(ptr->getPID()); });
+					ptr->terminate();
+				},
+				process));
+		}
+
+		for (auto &itr : workers) {
+			if (itr.joinable())
+				itr.join();
+		}
+		return;
 	}
-}
\ No newline at end of file
+
+	// Everyone gets the chance to finalize (recordings in particular) before stragglers are killed
+	std::vector<int32_t> pids;
+	for (Process *process : targets)
+		pids.push_back(process->getPID());
+
+	static MetricHistogram &latency = Metrics::getInstance()->histogram("crash_handler_termination_seconds", "Time for a process to exit once asked to", 1e-6);
+	static MetricCounter &killed = Metrics::getInstance()->counter("crash_handler_terminations_killed_total", "Processes killed after the termination deadline");
+	const std::chrono::milliseconds deadline(Options::get().terminateDeadlineMs);
+	Tracer *tracer = Tracer::getInstance();
+	const uint64_t started = tracer->isEnabled() ? tracer->now() : 0;
+	for (const TerminationResult &result : engine->terminate(pids, deadline)) {
+		// The engine waits for every process in one loop, each exit is drawn as its own span
+		if (started && result.exited)
+			tracer->record("process exit", "pid " + std::to_string(result.pid) + (result.killed ? " killed" : ""), 'X', started, tracer->ticks(result.latency));
+		if (result.killed)
+			killed.add();
+		if (result.exited) {
+			latency.record(std::chrono::duration_cast<std::chrono::microseconds>(result.latency).count());
+			log_info << "Terminated pid : " << result.pid << " in " << result.latency.count() << " ms" << (result.killed ? " after kill" : "") << std::endl;
+		} else {
+			log_error << "Failed to terminate pid : " << result.pid << std::endl;
+		}
+	}
+}
@@ -16,6 +16,8 @@
 
 ******************************************************************************/
 
+#pragma once
+
 #include <mutex>
 #include <thread>
 #include <atomic>
@@ -25,47 +27,164 @@
 #include "process.hpp"
 #include "logger.hpp"
 #include "util.hpp"
+#include "discovery.hpp"
+#include "timer-wheel.hpp"
+#include "app-state.hpp"
+#include "connection-watcher.hpp"
+#include "crash-context.hpp"
+#include "crash-interceptor.hpp"
+#include "process-freezer.hpp"
+#include "thread-monitor.hpp"
+
+#include <map>
+#include <set>
+
+// Stack samples of a process found unresponsive, counted by folded stack
+struct HangProfile {
+	std::string path;
+	std::chrono::steady_clock::time_point next;
+	std::chrono::steady_clock::time_point end;
+	uint32_t samples = 0;
+	std::map<std::string, uint32_t> folded;
+};
+
+// A process newly found unresponsive, with its threads as last sampled
+struct HangReport {
+	int32_t pid = 0;
+	std::vector<ThreadActivity> threads;
+};
 
 struct ThreadData {
 	std::thread *worker = nullptr;
 
 	bool should_stop = false;
+	bool woken = false;
 	std::condition_variable_any stop_event;
 	std::recursive_mutex stop_mutex;
 	void send_stop();
-	bool wait_or_stop();
+	void wake();
+	bool wait_or_stop(std::chrono::milliseconds timeout = std::chrono::milliseconds(50));
 };
 
 class ProcessManager {
 public:
-	ProcessManager();
+	ProcessManager(const std::wstring &cachePath);
 	~ProcessManager();
 
+	// Owns the socket and dispatches its messages until the application is gone
 	void runWatcher();
 	bool m_applicationCrashed;
 	bool m_criticalCrash;
 
+	// Serves one session of a multi-session handler, whose messages are dispatched by the session manager
+	void attachSession(std::shared_ptr<Socket> socket, const std::string &session, LogOutput *logOutput, const std::wstring &reportPath);
+	void detachSession();
+	void handleMessage(const std::vector<char> &buffer);
+	bool isStopped() const { return stopped; }
+
+	// Stops monitoring and passes the registered processes on to the instance taking over, unless a crash is being handled
+	// or a process holds a connection, heartbeat, memory dump or crash context registration
+	bool handOver(std::vector<char> &state);
+	void adoptProcesses(const std::vector<char> &state);
+
 	void handleCrash(std::wstring path);
 	void sendExitMessage(bool appCrashed);
 
 private:
 	ThreadData *watcher = nullptr;
 	ThreadData *monitor = nullptr;
+	// Takes the stack samples of hang profiles, each can wait on the tracer. Started by the monitor and stopped with it.
+	ThreadData *sampler = nullptr;
 	std::vector<std::unique_ptr<Process>> processes;
 	std::mutex mtx;
-	std::unique_ptr<Socket> socket;
+	// Serializes stopping the monitor, which is created under mtx
+	std::mutex monitorMtx;
+	std::shared_ptr<Socket> socket;
+	std::unique_ptr<ProcessDiscovery> discovery;
+	std::unique_ptr<ConnectionWatcher> connections;
+	std::unique_ptr<CrashContextChannel> crashContexts;
+	std::unique_ptr<CrashInterceptor> interceptor;
+	std::unique_ptr<ProcessFreezer> freezer;
+
+	std::wstring cachePath;
+	std::wstring reportPath;
+	// Name of the session served, empty when the handler serves a single application
+	std::string session;
+	// Log of the session, null for the process log. The monitor thread and every callback of the discovery, connection,
+	// crash context and interceptor threads open a LogScope on it, so all of the manager logs to its session.
+	LogOutput *logOutput = nullptr;
+	std::atomic<bool> stopped;
+	// The socket path then belongs to the next instance
+	std::atomic<bool> handedOver;
+	// Features found unavailable, left off for this manager while other sessions keep their options
+	std::atomic<bool> interceptionUnavailable;
+	// Guarded by mtx
+	bool freezerUnavailable = false;
+	// Only used by the monitor thread
+	bool hangSnapshotsUnavailable = false;
+	// Only used by the monitor thread
+	AppStateStore appState;
+
+	// Monitoring tasks, guarded by mtx
+	TimerWheel scheduler;
+	std::set<int32_t> unresponsiveProcesses;
+	std::vector<HangReport> pendingHangReports;
+	std::map<int32_t, std::unique_ptr<ThreadMonitor>> threadMonitors;
+	std::map<int32_t, std::vector<ThreadActivity>> threadActivity;
+	// Only used by the monitor thread
+	std::map<int32_t, std::chrono::steady_clock::time_point> lastHangSnapshots;
+	// Profiles started by the monitor, until the sampler thread takes them
+	std::mutex profileMtx;
+	std::vector<std::pair<int32_t, HangProfile>> pendingHangProfiles;
+	// Only used by the sampler thread
+	std::map<int32_t, HangProfile> hangProfiles;
 
 	void watcher_fnc();
 	void monitor_fnc();
+	void sampler_fnc();
+	void stop();
+
+	void startDiscovery();
+	void stopDiscovery();
 
 	void startMonitoring();
 	void stopMonitoring();
+	void scheduleProcessChecks(int32_t PID);
+	std::vector<std::unique_ptr<Process>>::iterator findProcess(int32_t PID);
 
 	size_t registerProcess(bool isCritical, uint32_t PID);
 	void unregisterProcess(uint32_t PID);
+	void registerConnection(bool isCritical);
+	void crashWithCode(uint32_t PID, uint32_t code, uint64_t address);
+	void connectionClosed(int32_t PID, ConnectionWatcher::Close reason);
+	void registerDiscoveredProcess(int32_t parentPID, int32_t PID);
+	void unregisterDiscoveredProcess(int32_t PID, int32_t exitCode, int32_t termSignal);
 	void registerProcessMemoryDump(uint32_t PID, const std::wstring &eventName_Start, const std::wstring &eventName_Fail,
 				       const std::wstring &eventName_Success, const std::wstring &dumpPath, const std::wstring &dumpName);
+	void registerProcessHeartbeat(uint32_t PID, uint32_t deadline_ms);
+	void registerProcessCrashContext(uint32_t PID);
+	void crashContextReported(int32_t PID, const CrashContext &context);
+	// Created on first use, nullptr on platforms without process tracing
+	CrashInterceptor *getInterceptor();
+	void interceptCrashes(uint32_t PID);
+	void crashIntercepted(int32_t PID, const CrashSnapshot &snapshot);
+	// Written as <log>.<kind>-<pid>.json
+	void writeCrashSnapshot(int32_t PID, const CrashSnapshot &snapshot, const std::string &kind);
+	void groupProcess(int32_t PID);
+	// Writes the dump the process registered for, where the handler writes it itself
+	bool saveMemoryDump(int32_t PID, const CrashSnapshot *snapshot = nullptr);
+	void captureFrozenGroup();
+	// Written as <log>.hang-<pid>-<time>.threads.json and .dmp, and the profile then started as <log>.hang-<pid>-<time>.folded
+	void reportHangs(const std::vector<HangReport> &hangs);
+	void writeThreadActivity(int32_t PID, const std::vector<ThreadActivity> &threads, const std::string &path);
+	void startHangProfile(int32_t PID, const HangProfile &profile);
+	// Returns the time until the next sample is due
+	std::chrono::milliseconds sampleHangs();
+	void writeHangProfile(int32_t PID, const HangProfile &profile);
+
+	void writeTelemetryReport(void);
 
 	void terminateAll(void);
 	void terminateNonCritical(void);
+	void terminateProcesses(const std::vector<Process *> &targets);
 };
\ No newline at end of file
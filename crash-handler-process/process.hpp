@@ -16,8 +16,12 @@
 
 ******************************************************************************/
 
+#pragma once
+
 #include <thread>
 #include <mutex>
+#include <chrono>
+#include "telemetry.hpp"
 #ifdef WIN32
 #include <windows.h>
 #include <psapi.h>
@@ -39,6 +43,19 @@ protected:
 	bool alive = false;
 	bool recievedDmpEvent = false;
 
+	bool discovered = false;
+	bool connected = false;
+	bool bound = false;
+
+	bool crashReported = false;
+	uint32_t crashCode = 0;
+	uint64_t crashAddress = 0;
+	std::chrono::steady_clock::time_point crashReportedAt;
+
+	std::unique_ptr<TelemetrySampler> sampler;
+	bool samplerCreated = false;
+	TelemetryRing telemetry;
+
 public:
 	virtual int32_t getPID(void) = 0;
 	virtual bool isValid(void) = 0;
@@ -47,7 +64,46 @@ public:
 	virtual bool isUnResponsive(void) = 0;
 	virtual void terminate(void) = 0;
 
+public:
+	// Discovered processes were not registered by the application, their exit is not a crash
+	void markDiscovered() { discovered = true; }
+	bool isDiscovered() const { return discovered; }
+	// The exit of a process registered with its connection is reported by the connection watcher, its pid is not polled
+	void markConnected(bool state) { connected = state; }
+	bool isConnected() const { return connected; }
+	// Registered for a heartbeat slot, a memory dump or a crash context page, which live in this handler and are not handed over
+	void markBound() { bound = true; }
+	bool isBound() const { return bound; }
+	// Set when the process reported its own crash with CRASHWITHCODE, usually before it is gone
+	void markCrashReported(uint32_t code, uint64_t address, std::chrono::steady_clock::time_point at)
+	{
+		crashReported = true;
+		crashCode = code;
+		crashAddress = address;
+		crashReportedAt = at;
+	}
+	bool hasCrashReport() const { return crashReported; }
+	uint32_t getCrashCode() const { return crashCode; }
+	uint64_t getCrashAddress() const { return crashAddress; }
+	std::chrono::steady_clock::time_point getCrashReportedAt() const { return crashReportedAt; }
+
+	void sampleTelemetry()
+	{
+		if (!samplerCreated) {
+			sampler = TelemetrySampler::create(getPID());
+			samplerCreated = true;
+		}
+		TelemetrySample sample;
+		if (sampler && sampler->sample(sample))
+			telemetry.push(sample);
+	}
+	std::vector<TelemetrySample> getTelemetry() const { return telemetry.snapshot(); }
+
 public:
 	virtual void startMemoryDumpMonitoring(const std::wstring &eventName_Start, const std::wstring &eventName_Fail, const std::wstring &eventName_Success,
 					       const std::wstring &dumpPath, const std::wstring &dumpName) = 0;
+	// Where the crash handler writes the dump itself instead of signalling the process, false when none was requested
+	virtual bool getMemoryDumpRequest(std::wstring &dumpPath, std::wstring &dumpName) { return false; }
+	// Fills the shared heartbeat slot index and segment descriptor the process has to use
+	virtual bool startHeartbeatMonitoring(uint32_t deadline_ms, int32_t &slot, int &descriptor) = 0;
 };
@@ -0,0 +1,175 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "session-manager.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(WIN32)
+const std::wstring session_log_name = L"\\crash-handler.log";
+#else // for __APPLE__ and other
+const std::wstring session_log_name = L"/crash-handler.log";
+#endif
+
+namespace {
+
+template<typename T> void writeString(std::vector<char> &buffer, const T &value)
+{
+	// Same layout Message reads: byte size including the terminator, then the characters
+	const uint32_t size = static_cast<uint32_t>((value.size() + 1) * sizeof(typename T::value_type));
+	const size_t offset = buffer.size();
+	buffer.resize(offset + sizeof(uint32_t) + size, 0);
+	memcpy(&buffer[offset], &size, sizeof(uint32_t));
+	memcpy(&buffer[offset + sizeof(uint32_t)], value.data(), size - sizeof(typename T::value_type));
+}
+
+} // namespace
+
+SessionManager::~SessionManager()
+{
+	this->sessions.clear();
+	if (this->socket)
+		this->socket->disconnect();
+}
+
+bool SessionManager::forwardSession(const std::string &name, const std::wstring &cachePath, const std::wstring &appPath)
+{
+	std::vector<char> buffer;
+	buffer.push_back(static_cast<char>(Action::OPENSESSION));
+	writeString(buffer, name);
+	writeString(buffer, cachePath);
+	writeString(buffer, appPath);
+
+	return Socket::forward(buffer) == static_cast<int>(buffer.size());
+}
+
+Session *SessionManager::findSession(const std::string &name)
+{
+	auto it = std::find_if(this->sessions.begin(), this->sessions.end(), [&name](std::unique_ptr<Session> &s) { return s->name == name; });
+	return it == this->sessions.end() ? nullptr : it->get();
+}
+
+bool SessionManager::openSession(const std::string &name, const std::wstring &cachePath, const std::wstring &appPath)
+{
+	if (findSession(name)) {
+		log_info << "Session " << name << " is already open" << std::endl;
+		return false;
+	}
+
+	if (!this->socket) {
+		this->socket = Socket::create();
+		if (this->socket->initialization_failed) {
+			this->socket.reset();
+			return false;
+		}
+	}
+
+	auto session = std::make_unique<Session>();
+	session->name = name;
+	session->appPath = appPath;
+
+	// The session that started the handler already logs to the process log
+	const std::wstring logPath = cachePath + session_log_name;
+	if (logPath != log_output_path)
+		session->log = logging_open(logPath);
+
+	session->manager = std::make_unique<ProcessManager>(cachePath);
+	session->manager->attachSession(this->socket, name, session->log.get(), logPath);
+
+	log_info << "Session " << name << " opened" << std::endl;
+	{
+		LogScope scope(session->log.get());
+		log_info << "=== Started session " << name << " ===" << std::endl;
+	}
+
+	this->sessions.push_back(std::move(session));
+	return true;
+}
+
+void SessionManager::run()
+{
+	log_info << "Start sessions" << std::endl;
+	while (this->socket && !this->sessions.empty()) {
+		std::vector<char> buffer = this->socket->read();
+		if (buffer.size())
+			dispatch(buffer);
+
+		finishSessions();
+	}
+	log_info << "End sessions" << std::endl;
+}
+
+void SessionManager::dispatch(const std::vector<char> &buffer)
+{
+	Message msg(buffer);
+	switch (static_cast<Action>(msg.readUInt8())) {
+	case Action::OPENSESSION: {
+		const std::string name = msg.readString();
+		const std::wstring cachePath = msg.readWstring();
+		const std::wstring appPath = msg.readWstring();
+		openSession(name, cachePath, appPath);
+		break;
+	}
+	case Action::SESSIONMESSAGE: {
+		const std::string name = msg.readString();
+		Session *session = findSession(name);
+		if (!session || session->finisher) {
+			log_info << "Message for unknown session " << name << std::endl;
+			break;
+		}
+
+		LogScope scope(session->log.get());
+		session->manager->handleMessage(msg.readRemaining());
+		break;
+	}
+	default:
+		log_info << "Message without session ignored" << std::endl;
+		break;
+	}
+}
+
+void SessionManager::finishSessions()
+{
+	for (auto it = this->sessions.begin(); it != this->sessions.end();) {
+		Session *session = it->get();
+
+		// Crash handling can block on the user, other sessions are served meanwhile
+		if (!session->finisher && session->manager->isStopped()) {
+			session->finisher = new std::thread([session]() {
+				LogScope scope(session->log.get());
+				Tracer::getInstance()->setThreadName("session " + session->name);
+				session->manager->detachSession();
+				if (session->manager->m_applicationCrashed)
+					session->manager->handleCrash(session->appPath);
+				log_info << "=== Finished session " << session->name << " ===" << std::endl;
+				session->finished = true;
+			});
+		}
+
+		if (session->finisher && session->finished) {
+			session->finisher->join();
+			delete session->finisher;
+			log_info << "Session " << session->name << " closed" << std::endl;
+			it = this->sessions.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
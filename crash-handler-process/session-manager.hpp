@@ -0,0 +1,58 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef SESSION_MANAGER_H
+#define SESSION_MANAGER_H
+
+#include "process-manager.hpp"
+
+// One application instance served by a multi-session crash handler
+struct Session {
+	std::string name;
+	std::wstring appPath;
+	// Not set when the session logs to the process log
+	std::unique_ptr<LogOutput> log;
+	std::unique_ptr<ProcessManager> manager;
+	std::thread *finisher = nullptr;
+	std::atomic<bool> finished{false};
+};
+
+// Serves several application instances from one listening socket. Every
+// session has its own process manager, app state file and log, messages
+// reach it wrapped in an Action::SESSIONMESSAGE envelope naming it.
+class SessionManager {
+public:
+	~SessionManager();
+
+	// Hands the session to a crash handler already serving the ipc path, false when there is none
+	static bool forwardSession(const std::string &name, const std::wstring &cachePath, const std::wstring &appPath);
+
+	bool openSession(const std::string &name, const std::wstring &cachePath, const std::wstring &appPath);
+	// Dispatches messages until the last session is finished
+	void run();
+
+private:
+	std::shared_ptr<Socket> socket;
+	std::vector<std::unique_ptr<Session>> sessions;
+
+	Session *findSession(const std::string &name);
+	void dispatch(const std::vector<char> &buffer);
+	void finishSessions();
+};
+
+#endif
@@ -33,9 +33,23 @@ public:
 	static std::unique_ptr<Socket> create();
 
 	virtual std::vector<char> read() = 0;
-	virtual int write(bool exit, std::vector<char> buffer) = 0;
+	// The exit message goes to exit-<ipc name> next to the ipc path, exit-<session>-<ipc name> for a session
+	virtual int write(bool exit, std::vector<char> buffer, const std::string &session) = 0;
 	virtual void disconnect() = 0;
+	// Answers the client of the last read message, optionally passing descriptors along
+	virtual bool reply(const std::vector<char> &buffer, const std::vector<int> &descriptors) { return false; }
+	// Keeps the connection of the last read message open past the next read, with the descriptor
+	// it passed or -1. Returns -1 where connections are not kept.
+	virtual int takeConnection(int &descriptor)
+	{
+		descriptor = -1;
+		return -1;
+	}
+	// Makes a read waiting for a client return at once, so a crash is not handled up to one poll late
+	virtual void interrupt() {}
 	static void set_ipc_path(const std::wstring &);
+	// Delivers a message to the crash handler already serving the ipc path, 0 when none does
+	static int forward(const std::vector<char> &buffer);
 	bool initialization_failed = false;
 };
 
@@ -0,0 +1,69 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "telemetry.hpp"
+
+void TelemetryRing::push(const TelemetrySample &sample)
+{
+	const uint64_t index = head.load(std::memory_order_relaxed);
+	Slot &slot = slots[index % TELEMETRY_SAMPLES];
+
+	// Odd sequence marks the slot as being written
+	const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+	slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.sample = sample;
+	slot.sequence.store(sequence + 2, std::memory_order_release);
+
+	head.store(index + 1, std::memory_order_release);
+}
+
+std::vector<TelemetrySample> TelemetryRing::snapshot() const
+{
+	std::vector<TelemetrySample> samples;
+	const uint64_t end = head.load(std::memory_order_acquire);
+	const uint64_t begin = end > TELEMETRY_SAMPLES ? end - TELEMETRY_SAMPLES : 0;
+	samples.reserve(end - begin);
+
+	for (uint64_t index = begin; index < end; index++) {
+		const Slot &slot = slots[index % TELEMETRY_SAMPLES];
+		const uint32_t before = slot.sequence.load(std::memory_order_acquire);
+		if (before & 1)
+			continue;
+
+		TelemetrySample sample = slot.sample;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != before)
+			continue;
+
+		samples.push_back(sample);
+	}
+	return samples;
+}
+
+void TelemetryRing::writeJson(std::ostream &out, const std::vector<TelemetrySample> &samples)
+{
+	out << "[";
+	for (size_t i = 0; i < samples.size(); i++) {
+		const TelemetrySample &s = samples[i];
+		out << (i ? "," : "") << "{\"timestamp_ms\":" << s.timestamp_ms << ",\"cpu_time_ms\":" << s.cpu_time_ms << ",\"rss_bytes\":" << s.rss_bytes
+		    << ",\"threads\":" << s.threads << ",\"open_fds\":" << s.open_fds << ",\"read_bytes\":" << s.read_bytes
+		    << ",\"write_bytes\":" << s.write_bytes << "}";
+	}
+	out << "]";
+}
@@ -0,0 +1,69 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+// With the default one second period, the last minute is kept for the crash report
+#define TELEMETRY_SAMPLES 60
+
+struct TelemetrySample {
+	uint64_t timestamp_ms = 0;
+	uint64_t cpu_time_ms = 0;
+	uint64_t rss_bytes = 0;
+	uint32_t threads = 0;
+	uint32_t open_fds = 0;
+	uint64_t read_bytes = 0;
+	uint64_t write_bytes = 0;
+};
+
+class TelemetrySampler {
+public:
+	// Returns nullptr on platforms without a sampler
+	static std::unique_ptr<TelemetrySampler> create(int32_t pid);
+
+	virtual ~TelemetrySampler(){};
+	virtual bool sample(TelemetrySample &sample) = 0;
+};
+
+// Single writer ring. Every slot is guarded by a sequence counter so readers
+// never block the monitor thread and skip a slot that is being overwritten.
+class TelemetryRing {
+public:
+	void push(const TelemetrySample &sample);
+	std::vector<TelemetrySample> snapshot() const;
+
+	static void writeJson(std::ostream &out, const std::vector<TelemetrySample> &samples);
+
+private:
+	struct Slot {
+		std::atomic<uint32_t> sequence{0};
+		TelemetrySample sample;
+	};
+
+	Slot slots[TELEMETRY_SAMPLES];
+	std::atomic<uint64_t> head{0};
+};
+
+#endif
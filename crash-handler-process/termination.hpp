@@ -0,0 +1,45 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef TERMINATION_H
+#define TERMINATION_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct TerminationResult {
+	int32_t pid = 0;
+	bool exited = false;
+	bool killed = false; // the deadline passed and the process was escalated to a kill
+	std::chrono::milliseconds latency{0};
+};
+
+// Asks all processes to exit at once and waits for them together, so the
+// whole shutdown takes as long as the slowest process.
+class TerminationEngine {
+public:
+	// Returns nullptr where processes are terminated one by one
+	static std::unique_ptr<TerminationEngine> create();
+
+	virtual ~TerminationEngine(){};
+	virtual std::vector<TerminationResult> terminate(const std::vector<int32_t> &pids, std::chrono::milliseconds deadline) = 0;
+};
+
+#endif
@@ -0,0 +1,82 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../timer-wheel.hpp"
+
+#include <iostream>
+
+#define CHECK(condition)                                                                       \
+	do {                                                                                   \
+		if (!(condition)) {                                                            \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": " << #condition << std::endl; \
+			return 1;                                                              \
+		}                                                                              \
+	} while (0)
+
+using std::chrono::milliseconds;
+
+int main()
+{
+	const auto start = std::chrono::steady_clock::now();
+	TimerWheel wheel(milliseconds(10));
+	wheel.reset(start);
+
+	int liveness = 0, telemetry = 0, validation = 0;
+	wheel.schedule(milliseconds(0), milliseconds(50), [&liveness]() { return ++liveness > 0; });
+	wheel.schedule(milliseconds(0), milliseconds(1000), [&telemetry]() { return ++telemetry > 0; });
+	wheel.schedule(milliseconds(7000), milliseconds(0), [&validation]() { return ++validation > 0; });
+
+	// A late advance runs each task once instead of once per missed period
+	wheel.advance(start + milliseconds(8000));
+	CHECK(liveness == 1);
+	CHECK(telemetry == 1);
+	CHECK(validation == 1);
+
+	// The periods keep their phase after the skip, both were first due at the first tick
+	wheel.advance(start + milliseconds(8010));
+	CHECK(liveness == 2);
+	CHECK(telemetry == 2);
+	wheel.advance(start + milliseconds(8050));
+	CHECK(liveness == 2);
+	wheel.advance(start + milliseconds(8060));
+	CHECK(liveness == 3);
+
+	// Time before an anchor is not replayed and delays count from it
+	TimerWheel anchored(milliseconds(10));
+	anchored.reset(start);
+	int runs = 0;
+	anchored.schedule(milliseconds(100), milliseconds(0), [&runs]() { return ++runs > 0; });
+	anchored.anchor(start + milliseconds(5000));
+	anchored.advance(start + milliseconds(5050));
+	CHECK(runs == 0);
+	anchored.advance(start + milliseconds(5100));
+	CHECK(runs == 1);
+
+	// Cancelled tasks of a key do not run, other keys are kept
+	TimerWheel keyed(milliseconds(10));
+	keyed.reset(start);
+	int first = 0, second = 0;
+	keyed.schedule(milliseconds(10), milliseconds(10), [&first]() { return ++first > 0; }, 42);
+	keyed.schedule(milliseconds(5000), milliseconds(10), [&first]() { return ++first > 0; }, 42);
+	keyed.schedule(milliseconds(10), milliseconds(10), [&second]() { return ++second > 0; }, 43);
+	keyed.cancel(42);
+	keyed.advance(start + milliseconds(6000));
+	CHECK(first == 0);
+	CHECK(second == 1);
+	return 0;
+}
@@ -0,0 +1,81 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "../window-index.hpp"
+
+#include <iostream>
+
+#define CHECK(condition)                                                                       \
+	do {                                                                                   \
+		if (!(condition)) {                                                            \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": " << #condition << std::endl; \
+			return 1;                                                              \
+		}                                                                              \
+	} while (0)
+
+// The index is linked without a platform, windows come from the fake source only
+std::unique_ptr<WindowSource> WindowSource::create()
+{
+	return nullptr;
+}
+
+class FakeWindowSource : public WindowSource {
+public:
+	FakeWindowSource(std::unordered_map<int32_t, uintptr_t> &windows, int &enumerations) : windows(windows), enumerations(enumerations) {}
+
+	virtual void enumerate(const std::function<void(int32_t pid, uintptr_t window)> &visit) override
+	{
+		enumerations++;
+		for (const auto &entry : windows)
+			visit(entry.first, entry.second);
+	}
+
+private:
+	std::unordered_map<int32_t, uintptr_t> &windows;
+	int &enumerations;
+};
+
+int main()
+{
+	std::unordered_map<int32_t, uintptr_t> windows = {{100, 0x1000}};
+	int enumerations = 0;
+	WindowIndex *index = WindowIndex::getInstance();
+	index->setSource(std::make_unique<FakeWindowSource>(windows, enumerations));
+
+	index->refresh();
+	CHECK(enumerations == 1);
+	CHECK(index->find(100) == 0x1000);
+	CHECK(enumerations == 1);
+
+	// A miss right after a refresh does not enumerate again
+	windows[200] = 0x2000;
+	CHECK(index->find(200) == 0);
+	CHECK(enumerations == 1);
+
+	// A window newer than the index is found once the last refresh is old enough
+	index->setSource(std::make_unique<FakeWindowSource>(windows, enumerations));
+	CHECK(index->find(200) == 0x2000);
+	CHECK(enumerations == 2);
+	CHECK(index->find(100) == 0x1000);
+	CHECK(index->find(300) == 0);
+	CHECK(enumerations == 2);
+
+	index->setSource(nullptr);
+	CHECK(index->find(100) == 0);
+	return 0;
+}
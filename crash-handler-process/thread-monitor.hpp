@@ -0,0 +1,74 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef THREAD_MONITOR_H
+#define THREAD_MONITOR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ThreadActivity {
+	enum State { Progressing, Blocked, Spinning, Idle };
+
+	int32_t tid = 0;
+	std::string name;
+	State state = Progressing;
+	// Scheduling state the kernel reports, such as R, S or D
+	char kernelState = 0;
+	// Kernel function a blocked or idle thread waits in, empty when it can not be read
+	std::string wchan;
+	// Share of one CPU the thread ran since the previous sample
+	double cpu = 0;
+	// How long the thread has been blocked, idle or spinning, 0 while it progresses
+	uint64_t stuckMs = 0;
+};
+
+// Classifies the threads of a process from the run time the kernel accounts
+// to each of them between two samples, without stopping the process. A thread
+// that did not run while sleeping is blocked, one that ran the whole time is
+// spinning. A worker asleep in a wait it takes between jobs, such as a futex
+// or epoll, is idle instead: it is the main or a busy thread stuck for as long
+// as the process is unresponsive that points at the hang.
+class ThreadMonitor {
+public:
+	// Returns nullptr on platforms without per-thread statistics
+	static std::unique_ptr<ThreadMonitor> create(int32_t pid);
+
+	virtual ~ThreadMonitor(){};
+
+	// Every thread is progressing in the first sample, the state needs the run time of the previous one
+	virtual bool sample(std::vector<ThreadActivity> &threads) = 0;
+
+	static const char *stateName(ThreadActivity::State state)
+	{
+		switch (state) {
+		case ThreadActivity::Blocked:
+			return "blocked";
+		case ThreadActivity::Spinning:
+			return "spinning";
+		case ThreadActivity::Idle:
+			return "idle";
+		default:
+			return "progressing";
+		}
+	}
+};
+
+#endif
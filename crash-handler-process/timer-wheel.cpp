@@ -0,0 +1,145 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "timer-wheel.hpp"
+
+#include <algorithm>
+
+TimerWheel::TimerWheel(std::chrono::milliseconds resolution) : resolution(resolution)
+{
+	reset(std::chrono::steady_clock::now());
+}
+
+void TimerWheel::reset(std::chrono::steady_clock::time_point new_start)
+{
+	start = new_start;
+	current = 0;
+	for (auto &slot : near_wheel)
+		slot.clear();
+	for (auto &slot : far_wheel)
+		slot.clear();
+	overflow.clear();
+}
+
+void TimerWheel::anchor(std::chrono::steady_clock::time_point now)
+{
+	start = now - resolution * current;
+}
+
+uint64_t TimerWheel::toTicks(std::chrono::milliseconds duration) const
+{
+	return (duration.count() + resolution.count() - 1) / resolution.count();
+}
+
+void TimerWheel::schedule(std::chrono::milliseconds delay, std::chrono::milliseconds period, task fn, uint64_t key)
+{
+	Entry entry;
+	entry.due = current + std::max<uint64_t>(toTicks(delay), 1);
+	entry.period = period.count() > 0 ? std::max<uint64_t>(toTicks(period), 1) : 0;
+	entry.key = key;
+	entry.fn = std::move(fn);
+	insert(std::move(entry));
+}
+
+void TimerWheel::cancel(uint64_t key)
+{
+	auto drop = [key](std::vector<Entry> &slot) { slot.erase(std::remove_if(slot.begin(), slot.end(), [key](const Entry &entry) { return entry.key == key; }), slot.end()); };
+	for (auto &slot : near_wheel)
+		drop(slot);
+	for (auto &slot : far_wheel)
+		drop(slot);
+	drop(overflow);
+}
+
+void TimerWheel::insert(Entry &&entry)
+{
+	const uint64_t delta = entry.due - current;
+	if (delta < TIMER_WHEEL_NEAR_SLOTS)
+		near_wheel[entry.due & (TIMER_WHEEL_NEAR_SLOTS - 1)].push_back(std::move(entry));
+	else if (delta < (uint64_t(TIMER_WHEEL_NEAR_SLOTS) << TIMER_WHEEL_FAR_BITS))
+		far_wheel[(entry.due >> TIMER_WHEEL_NEAR_BITS) & (TIMER_WHEEL_FAR_SLOTS - 1)].push_back(std::move(entry));
+	else
+		overflow.push_back(std::move(entry));
+}
+
+void TimerWheel::cascade()
+{
+	// Called when the near wheel wraps: the far slot for this lap moves down
+	std::vector<Entry> lap;
+	lap.swap(far_wheel[(current >> TIMER_WHEEL_NEAR_BITS) & (TIMER_WHEEL_FAR_SLOTS - 1)]);
+	if (((current >> TIMER_WHEEL_NEAR_BITS) & (TIMER_WHEEL_FAR_SLOTS - 1)) == 0) {
+		std::vector<Entry> far;
+		far.swap(overflow);
+		for (auto &entry : far)
+			insert(std::move(entry));
+	}
+	for (auto &entry : lap)
+		insert(std::move(entry));
+}
+
+void TimerWheel::advance(std::chrono::steady_clock::time_point now)
+{
+	const uint64_t target = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() / resolution.count();
+
+	while (current < target) {
+		current++;
+		if ((current & (TIMER_WHEEL_NEAR_SLOTS - 1)) == 0)
+			cascade();
+
+		std::vector<Entry> due;
+		due.swap(near_wheel[current & (TIMER_WHEEL_NEAR_SLOTS - 1)]);
+		for (auto &entry : due) {
+			if (entry.due > current) {
+				insert(std::move(entry));
+				continue;
+			}
+			if (entry.fn() && entry.period) {
+				// A late advance does not run the task again for each period it missed
+				entry.due = current + entry.period;
+				if (entry.due <= target)
+					entry.due += ((target - entry.due) / entry.period + 1) * entry.period;
+				insert(std::move(entry));
+			}
+		}
+	}
+}
+
+std::chrono::milliseconds TimerWheel::timeUntilNext(std::chrono::steady_clock::time_point now, std::chrono::milliseconds limit) const
+{
+	uint64_t next = UINT64_MAX;
+	for (uint64_t tick = current + 1; tick < current + TIMER_WHEEL_NEAR_SLOTS; tick++) {
+		if (!near_wheel[tick & (TIMER_WHEEL_NEAR_SLOTS - 1)].empty()) {
+			next = tick;
+			break;
+		}
+	}
+	// Far entries of the coming lap can be due before a near one
+	for (const auto &slot : far_wheel) {
+		for (const auto &entry : slot)
+			next = std::min(next, entry.due);
+	}
+	for (const auto &entry : overflow)
+		next = std::min(next, entry.due);
+	if (next == UINT64_MAX)
+		return limit;
+
+	const auto due = start + resolution * next;
+	if (due <= now)
+		return std::chrono::milliseconds(0);
+	return std::min(limit, std::chrono::duration_cast<std::chrono::milliseconds>(due - now) + std::chrono::milliseconds(1));
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#define TIMER_WHEEL_NEAR_BITS 8
+#define TIMER_WHEEL_FAR_BITS 6
+#define TIMER_WHEEL_NEAR_SLOTS (1 << TIMER_WHEEL_NEAR_BITS)
+#define TIMER_WHEEL_FAR_SLOTS (1 << TIMER_WHEEL_FAR_BITS)
+
+// Two level hierarchical timer wheel. Tasks due in the same tick run in the
+// same wakeup; far tasks cascade into the near wheel as time advances. A
+// periodic task runs once however late the wheel is advanced, the periods it
+// missed are skipped. Not thread safe, the owner serializes access.
+class TimerWheel {
+public:
+	// Returning false from a task stops it from being rescheduled
+	typedef std::function<bool()> task;
+
+	TimerWheel(std::chrono::milliseconds resolution);
+
+	void reset(std::chrono::steady_clock::time_point start);
+	// Makes now the current tick without dropping tasks, the time since the last advance is not replayed
+	void anchor(std::chrono::steady_clock::time_point now);
+	// Tasks scheduled with a key are dropped together by cancel
+	void schedule(std::chrono::milliseconds delay, std::chrono::milliseconds period, task fn, uint64_t key = 0);
+	void cancel(uint64_t key);
+
+	// Runs every task due at or before now
+	void advance(std::chrono::steady_clock::time_point now);
+
+	// Time left until the earliest task, capped at limit
+	std::chrono::milliseconds timeUntilNext(std::chrono::steady_clock::time_point now, std::chrono::milliseconds limit) const;
+
+private:
+	struct Entry {
+		uint64_t due = 0;
+		uint64_t period = 0;
+		uint64_t key = 0;
+		task fn;
+	};
+
+	std::chrono::milliseconds resolution;
+	std::chrono::steady_clock::time_point start;
+	uint64_t current = 0;
+
+	std::vector<Entry> near_wheel[TIMER_WHEEL_NEAR_SLOTS];
+	std::vector<Entry> far_wheel[TIMER_WHEEL_FAR_SLOTS];
+	std::vector<Entry> overflow;
+
+	uint64_t toTicks(std::chrono::milliseconds duration) const;
+	void insert(Entry &&entry);
+	void cascade();
+};
+
+#endif
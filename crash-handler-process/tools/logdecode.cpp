@@ -0,0 +1,286 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+// Renders a binary crash handler log as the text log would have read,
+// or as one JSON object per record with --json.
+
+#include "../log-format.hpp"
+
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Descriptor {
+	LogLevel level;
+	uint32_t line;
+	std::string file;
+	std::string format;
+	std::string types;
+};
+
+struct Argument {
+	char type;
+	std::string text;
+};
+
+class Reader {
+public:
+	Reader(const std::vector<char> &buffer) : buffer(buffer) {}
+
+	bool atEnd() const { return index >= buffer.size(); }
+	bool failed() const { return error; }
+
+	template<typename T> T read()
+	{
+		T value{};
+		if (index + sizeof(T) > buffer.size()) {
+			error = true;
+			index = buffer.size();
+			return value;
+		}
+		memcpy(&value, &buffer[index], sizeof(T));
+		index += sizeof(T);
+		return value;
+	}
+
+	std::string readString()
+	{
+		const uint32_t size = read<uint32_t>();
+		if (error || index + size > buffer.size()) {
+			error = true;
+			index = buffer.size();
+			return std::string();
+		}
+		std::string value(&buffer[index], size);
+		index += size;
+		return value;
+	}
+
+	bool readMagic()
+	{
+		if (index + LOG_FORMAT_MAGIC_SIZE > buffer.size() || memcmp(&buffer[index], LOG_FORMAT_MAGIC, LOG_FORMAT_MAGIC_SIZE) != 0)
+			return false;
+		index += LOG_FORMAT_MAGIC_SIZE;
+		return true;
+	}
+
+private:
+	const std::vector<char> &buffer;
+	size_t index = 0;
+	bool error = false;
+};
+
+static std::string formatTime(uint64_t time_us)
+{
+	const time_t seconds = static_cast<time_t>(time_us / 1000000);
+	struct tm *buf = localtime(&seconds);
+
+	char mbstr[64] = {0};
+	if (buf)
+		std::strftime(mbstr, sizeof(mbstr), "%Y%m%d:%H%M%S.", buf);
+
+	std::ostringstream ss;
+	ss << mbstr << std::setw(3) << std::setfill('0') << (time_us / 1000) % 1000;
+	return ss.str();
+}
+
+static std::string render(const std::string &format, const std::vector<Argument> &args)
+{
+	std::string text;
+	size_t next = 0;
+	for (size_t i = 0; i < format.size(); i++) {
+		if (format[i] == '{' && i + 1 < format.size() && format[i + 1] == '}') {
+			if (next < args.size())
+				text += args[next++].text;
+			i++;
+		} else if ((format[i] == '{' || format[i] == '}') && i + 1 < format.size() && format[i + 1] == format[i]) {
+			text += format[i];
+			i++;
+		} else {
+			text += format[i];
+		}
+	}
+	return text;
+}
+
+static std::string escapeJson(const std::string &value)
+{
+	std::ostringstream escaped;
+	for (unsigned char c : value) {
+		switch (c) {
+		case '"':
+			escaped << "\\\"";
+			break;
+		case '\\':
+			escaped << "\\\\";
+			break;
+		case '\n':
+			escaped << "\\n";
+			break;
+		case '\r':
+			escaped << "\\r";
+			break;
+		case '\t':
+			escaped << "\\t";
+			break;
+		default:
+			if (c < 0x20)
+				escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+			else
+				escaped << c;
+		}
+	}
+	return escaped.str();
+}
+
+static bool readArguments(Reader &reader, const std::string &types, std::vector<Argument> &args)
+{
+	for (char type : types) {
+		std::ostringstream text;
+		switch (type) {
+		case LOG_ARG_BOOL:
+			text << static_cast<int>(reader.read<uint8_t>());
+			break;
+		case LOG_ARG_CHAR:
+			text << static_cast<char>(reader.read<uint8_t>());
+			break;
+		case LOG_ARG_SIGNED:
+			text << reader.read<int64_t>();
+			break;
+		case LOG_ARG_UNSIGNED:
+			text << reader.read<uint64_t>();
+			break;
+		case LOG_ARG_DOUBLE:
+			text << reader.read<double>();
+			break;
+		case LOG_ARG_STRING:
+			text << reader.readString();
+			break;
+		default:
+			return false;
+		}
+		args.push_back({type, text.str()});
+	}
+	return !reader.failed();
+}
+
+static bool decode(const std::vector<char> &buffer, bool json)
+{
+	Reader reader(buffer);
+	std::unordered_map<uint32_t, Descriptor> descriptors;
+	uint32_t pid = 0;
+
+	while (!reader.atEnd()) {
+		if (reader.readMagic()) {
+			const uint8_t version = reader.read<uint8_t>();
+			if (version != LOG_FORMAT_VERSION) {
+				std::cerr << "Unsupported log format version " << static_cast<int>(version) << std::endl;
+				return false;
+			}
+			pid = reader.read<uint32_t>();
+			descriptors.clear();
+			continue;
+		}
+
+		const uint8_t kind = reader.read<uint8_t>();
+		const uint32_t id = reader.read<uint32_t>();
+		if (kind == LOG_RECORD_DESCRIPTOR) {
+			Descriptor &descriptor = descriptors[id];
+			descriptor.level = static_cast<LogLevel>(reader.read<uint8_t>());
+			descriptor.line = reader.read<uint32_t>();
+			descriptor.file = reader.readString();
+			descriptor.format = reader.readString();
+			descriptor.types = reader.readString();
+		} else if (kind == LOG_RECORD_EVENT) {
+			const uint64_t time_us = reader.read<uint64_t>();
+			auto it = descriptors.find(id);
+			if (it == descriptors.end()) {
+				std::cerr << "Record for undeclared call site " << id << std::endl;
+				return false;
+			}
+
+			std::vector<Argument> args;
+			if (!readArguments(reader, it->second.types, args))
+				break;
+
+			const Descriptor &descriptor = it->second;
+			std::string message = render(descriptor.format, args);
+			if (!json) {
+				std::cout << log_level_prefix(descriptor.level) << ":" << pid << ":" << formatTime(time_us) << ": " << message;
+				continue;
+			}
+
+			while (!message.empty() && message.back() == '\n')
+				message.pop_back();
+			std::cout << "{\"level\":\"" << log_level_prefix(descriptor.level) << "\",\"pid\":" << pid << ",\"time_us\":" << time_us
+				  << ",\"file\":\"" << escapeJson(descriptor.file) << "\",\"line\":" << descriptor.line << ",\"format\":\""
+				  << escapeJson(descriptor.format) << "\",\"args\":[";
+			for (size_t i = 0; i < args.size(); i++) {
+				const bool quoted = args[i].type == LOG_ARG_STRING || args[i].type == LOG_ARG_CHAR;
+				std::cout << (i ? "," : "") << (quoted ? "\"" + escapeJson(args[i].text) + "\"" : args[i].text);
+			}
+			std::cout << "],\"message\":\"" << escapeJson(message) << "\"}\n";
+		} else {
+			std::cerr << "Unknown record kind " << static_cast<int>(kind) << std::endl;
+			return false;
+		}
+	}
+
+	// A handler killed in the middle of a write leaves a truncated last record
+	if (reader.failed())
+		std::cerr << "Log ends with a truncated record" << std::endl;
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	bool json = false;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--json") == 0)
+			json = true;
+		else
+			files.push_back(argv[i]);
+	}
+
+	if (files.empty()) {
+		std::cerr << "Usage: crash-handler-logdecode [--json] crash-handler.log.bin..." << std::endl;
+		return 2;
+	}
+
+	int result = 0;
+	for (const std::string &path : files) {
+		std::ifstream file(path, std::ios::in | std::ios::binary);
+		if (!file.is_open()) {
+			std::cerr << "Failed to open " << path << std::endl;
+			result = 1;
+			continue;
+		}
+
+		std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (!decode(buffer, json))
+			result = 1;
+	}
+	return result;
+}
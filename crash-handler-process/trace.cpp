@@ -0,0 +1,234 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "trace.hpp"
+
+#include <fstream>
+#include <thread>
+#if defined(WIN32)
+#include <intrin.h>
+#include <process.h>
+#define TRACE_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#include <unistd.h>
+#define TRACE_TSC
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+bool invariantTsc()
+{
+#if defined(TRACE_TSC) && defined(WIN32)
+	int registers[4] = {};
+	__cpuid(registers, 0x80000000);
+	if (static_cast<unsigned>(registers[0]) < 0x80000007)
+		return false;
+	__cpuid(registers, 0x80000007);
+	return registers[3] & (1 << 8);
+#elif defined(TRACE_TSC)
+	unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+		return false;
+	return edx & (1 << 8);
+#else
+	return false;
+#endif
+}
+
+uint64_t readTsc()
+{
+#if defined(TRACE_TSC)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+std::string escape(const std::string &value)
+{
+	std::string escaped;
+	for (char c : value) {
+		if (c == '"' || c == '\\')
+			escaped += '\\';
+		if (static_cast<unsigned char>(c) >= 0x20)
+			escaped += c;
+	}
+	return escaped;
+}
+
+} // namespace
+
+Tracer *Tracer::getInstance()
+{
+	static Tracer instance;
+	return &instance;
+}
+
+uint64_t Tracer::steadyTicks() const
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::enable()
+{
+	if (enabled)
+		return;
+
+	useTsc = invariantTsc();
+	if (useTsc) {
+		// The TSC rate is measured against steady_clock once, reading it is then a single instruction
+		const uint64_t steadyStart = steadyTicks();
+		const uint64_t tscStart = readTsc();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		const uint64_t steadyEnd = steadyTicks();
+		const uint64_t tscEnd = readTsc();
+		if (tscEnd > tscStart) {
+			tickUs = static_cast<double>(steadyEnd - steadyStart) / 1000.0 / static_cast<double>(tscEnd - tscStart);
+			origin = tscStart;
+		} else {
+			useTsc = false;
+		}
+	}
+	if (!useTsc) {
+		tickUs = 0.001;
+		origin = steadyTicks();
+	}
+	enabled = true;
+}
+
+uint64_t Tracer::now() const
+{
+	return useTsc ? readTsc() : steadyTicks();
+}
+
+Tracer::ThreadBuffer &Tracer::threadBuffer()
+{
+	thread_local std::shared_ptr<ThreadBuffer> buffer;
+	if (!buffer) {
+		buffer = std::make_shared<ThreadBuffer>();
+		const std::lock_guard<std::mutex> lock(mtx);
+		buffer->tid = nextTid++;
+		buffers.push_back(buffer);
+	}
+	return *buffer;
+}
+
+void Tracer::setThreadName(const std::string &name)
+{
+	if (!isEnabled())
+		return;
+
+	ThreadBuffer &buffer = threadBuffer();
+	const std::lock_guard<std::mutex> lock(buffer.mtx);
+	buffer.name = name;
+}
+
+void Tracer::record(const char *name, const std::string &detail, char phase, uint64_t start, uint64_t duration)
+{
+	ThreadBuffer &buffer = threadBuffer();
+	const std::lock_guard<std::mutex> lock(buffer.mtx);
+
+	TraceEvent event;
+	event.name = name;
+	event.detail = detail;
+	event.phase = phase;
+	event.start = start;
+	event.duration = duration;
+	if (buffer.events.size() < TRACE_BUFFER_EVENTS)
+		buffer.events.push_back(std::move(event));
+	else
+		buffer.events[buffer.next % TRACE_BUFFER_EVENTS] = std::move(event);
+	buffer.next++;
+}
+
+bool Tracer::writeEpisode(const std::wstring &path)
+{
+	if (!isEnabled())
+		return false;
+
+	struct Collected {
+		uint32_t tid;
+		std::string name;
+		std::vector<TraceEvent> events;
+	};
+	std::vector<Collected> collected;
+	size_t count = 0;
+	{
+		const std::lock_guard<std::mutex> lock(mtx);
+		for (auto it = buffers.begin(); it != buffers.end();) {
+			ThreadBuffer &buffer = **it;
+			{
+				const std::lock_guard<std::mutex> bufferLock(buffer.mtx);
+				collected.push_back({buffer.tid, buffer.name, std::move(buffer.events)});
+				buffer.events.clear();
+				buffer.next = 0;
+				count += collected.back().events.size();
+			}
+			// Buffers of threads that are gone are only kept until their events are written
+			if (it->use_count() == 1)
+				it = buffers.erase(it);
+			else
+				++it;
+		}
+	}
+	if (!count)
+		return false;
+
+#if defined(WIN32)
+	const uint32_t pid = static_cast<uint32_t>(_getpid());
+	std::ofstream file(path, std::ios::trunc | std::ios::out);
+#else // for __APPLE__ and other
+	const uint32_t pid = static_cast<uint32_t>(getpid());
+	std::ofstream file(std::string(path.begin(), path.end()), std::ios::trunc | std::ios::out);
+#endif
+	if (!file.is_open())
+		return false;
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	file.setf(std::ios::fixed);
+	file.precision(3);
+	for (const Collected &thread : collected) {
+		if (thread.events.empty())
+			continue;
+		if (!thread.name.empty()) {
+			file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << thread.tid
+			     << ",\"args\":{\"name\":\"" << escape(thread.name) << "\"}}";
+			first = false;
+		}
+		for (const TraceEvent &event : thread.events) {
+			file << (first ? "" : ",") << "\n{\"name\":\"" << escape(event.name) << "\",\"cat\":\"crash-handler\",\"ph\":\"" << event.phase
+			     << "\",\"ts\":" << (event.start > origin ? event.start - origin : 0) * tickUs;
+			if (event.phase == 'X')
+				file << ",\"dur\":" << event.duration * tickUs;
+			else
+				file << ",\"s\":\"t\"";
+			file << ",\"pid\":" << pid << ",\"tid\":" << thread.tid;
+			if (!event.detail.empty())
+				file << ",\"args\":{\"detail\":\"" << escape(event.detail) << "\"}";
+			file << "}";
+			first = false;
+		}
+	}
+	file << "\n]}\n";
+	return true;
+}
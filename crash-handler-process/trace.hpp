@@ -0,0 +1,125 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped spans recorded in per-thread buffers and written as Chrome trace
+// event JSON, which Perfetto and chrome://tracing open. Recording is off
+// unless --trace is given; a disabled span costs one relaxed load.
+//   TraceSpan span("handleCrash");
+//   TraceSpan span("saveMemoryDump", [PID] { return "pid " + std::to_string(PID); });
+// Names must be string literals. A detail, shown as an argument, is passed as
+// a function so it is only built while recording.
+
+// Events kept per thread, older ones are overwritten
+#define TRACE_BUFFER_EVENTS 4096
+
+struct TraceEvent {
+	const char *name = nullptr;
+	std::string detail;
+	char phase = 'X';
+	// In clock ticks, converted when written
+	uint64_t start = 0;
+	uint64_t duration = 0;
+};
+
+class Tracer {
+public:
+	static Tracer *getInstance();
+
+	void enable();
+	bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+	// Timestamps come from the TSC where it is invariant, from steady_clock otherwise
+	uint64_t now() const;
+	uint64_t ticks(std::chrono::microseconds duration) const { return static_cast<uint64_t>(duration.count() / tickUs); }
+
+	void record(const char *name, const std::string &detail, char phase, uint64_t start, uint64_t duration);
+	// Names the calling thread in the trace
+	void setThreadName(const std::string &name);
+
+	// Writes the events recorded since the previous call, does nothing if there are none
+	bool writeEpisode(const std::wstring &path);
+
+private:
+	Tracer() = default;
+
+	struct ThreadBuffer {
+		uint32_t tid = 0;
+		std::string name;
+		std::mutex mtx;
+		std::vector<TraceEvent> events;
+		size_t next = 0;
+	};
+
+	std::atomic<bool> enabled{false};
+	bool useTsc = false;
+	// Microseconds per tick, and the tick at which the trace starts
+	double tickUs = 0.001;
+	uint64_t origin = 0;
+
+	std::mutex mtx;
+	std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+	uint32_t nextTid = 1;
+
+	ThreadBuffer &threadBuffer();
+	uint64_t steadyTicks() const;
+};
+
+class TraceSpan {
+public:
+	TraceSpan(const char *name) : name(name)
+	{
+		if (Tracer::getInstance()->isEnabled())
+			start = Tracer::getInstance()->now();
+	}
+	template<typename Detail> TraceSpan(const char *name, Detail &&describe) : name(name)
+	{
+		if (Tracer::getInstance()->isEnabled()) {
+			detail = describe();
+			start = Tracer::getInstance()->now();
+		}
+	}
+	~TraceSpan()
+	{
+		if (start)
+			Tracer::getInstance()->record(name, detail, 'X', start, Tracer::getInstance()->now() - start);
+	}
+
+private:
+	const char *name;
+	std::string detail;
+	uint64_t start = 0;
+};
+
+template<typename Detail> void trace_instant(const char *name, Detail &&describe)
+{
+	if (Tracer::getInstance()->isEnabled())
+		Tracer::getInstance()->record(name, describe(), 'i', Tracer::getInstance()->now(), 0);
+}
+
+#endif
@@ -19,8 +19,11 @@
 #ifndef UTIL_H
 #define UTIL_H
 
+#include <locale>
 #include <string>
 
+struct CrashSnapshot;
+
 class Util {
 public:
 	static void runTerminateWindow(bool &shouldRestart);
@@ -30,15 +33,22 @@ public:
 	static void restartApp(std::wstring path);
 
 	static bool archiveFile(const std::wstring &fileFullPath, const std::wstring &archiveFullPath, const std::string &nameInsideArchive);
-	static bool saveMemoryDump(uint32_t pid, const std::wstring &dumpPath, const std::wstring &dumpFileName);
+	// snapshot holds the registers read from a held process, where the platform can put them in the dump
+	static bool saveMemoryDump(uint32_t pid, const std::wstring &dumpPath, const std::wstring &dumpFileName, const CrashSnapshot *snapshot = nullptr);
 	static bool uploadToAWS(const std::wstring &wspath, const std::wstring &fileName);
 	static void abortUploadAWS();
-	static void setCachePath(std::wstring path);
 
 	enum class AppState { Responsive, Unresponsive, NoncriticallyDead };
-	static void updateAppState(AppState detected);
+	// Writes a temporary file next to path, syncs it and renames it over path
+	static bool writeFileAtomically(const std::wstring &path, const std::string &content);
 
+	// Only sets the C locale, cheap enough for the start of main
 	static void setupLocale();
+	// Loads the translation catalogs once. Started in the background at launch, dialogs wait for it before showing text.
+	static void loadTranslations();
+	// Locale carrying the catalogs, passed to every translation. The global locale is never changed, streams built on
+	// other threads meanwhile would race with it.
+	static std::locale translations();
 };
 
 #endif
\ No newline at end of file
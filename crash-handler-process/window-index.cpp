@@ -0,0 +1,66 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "window-index.hpp"
+
+WindowIndex *WindowIndex::getInstance()
+{
+	static WindowIndex instance;
+	return &instance;
+}
+
+WindowIndex::WindowIndex()
+{
+	source = WindowSource::create();
+}
+
+void WindowIndex::setSource(std::unique_ptr<WindowSource> new_source)
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	source = std::move(new_source);
+	windows.clear();
+	refreshed = std::chrono::steady_clock::time_point();
+}
+
+void WindowIndex::refresh()
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	rebuild();
+}
+
+void WindowIndex::rebuild()
+{
+	windows.clear();
+	refreshed = std::chrono::steady_clock::now();
+	if (!source)
+		return;
+
+	// Keep the first window found for a pid, as the per process enumeration did
+	source->enumerate([this](int32_t pid, uintptr_t window) { windows.emplace(pid, window); });
+}
+
+uintptr_t WindowIndex::find(int32_t pid)
+{
+	const std::lock_guard<std::mutex> lock(mtx);
+	auto it = windows.find(pid);
+	if (it == windows.end() && std::chrono::steady_clock::now() - refreshed >= std::chrono::milliseconds(WINDOW_INDEX_MISS_REFRESH_MS)) {
+		rebuild();
+		it = windows.find(pid);
+	}
+	return it == windows.end() ? 0 : it->second;
+}
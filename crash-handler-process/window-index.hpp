@@ -0,0 +1,66 @@
+/******************************************************************************
+	Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#ifndef WINDOW_INDEX_H
+#define WINDOW_INDEX_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+class WindowSource {
+public:
+	// Returns the platform source, or nullptr where top level windows are not tracked
+	static std::unique_ptr<WindowSource> create();
+
+	virtual ~WindowSource(){};
+
+	// Calls visit for every unowned top level window with the pid that owns it
+	virtual void enumerate(const std::function<void(int32_t pid, uintptr_t window)> &visit) = 0;
+};
+
+// A window created after the last pass is found by rebuilding the index on a
+// miss, at most once per WINDOW_INDEX_MISS_REFRESH_MS so windowless processes
+// do not bring the desktop wide enumeration back.
+#define WINDOW_INDEX_MISS_REFRESH_MS 1000
+
+// Top level windows keyed by owning pid. Rebuilt once per responsiveness pass
+// so each process lookup is O(1) instead of a desktop wide enumeration.
+class WindowIndex {
+public:
+	static WindowIndex *getInstance();
+
+	void setSource(std::unique_ptr<WindowSource> new_source);
+	void refresh();
+	uintptr_t find(int32_t pid);
+
+private:
+	WindowIndex();
+
+	std::unique_ptr<WindowSource> source;
+	std::unordered_map<int32_t, uintptr_t> windows;
+	std::chrono::steady_clock::time_point refreshed;
+	std::mutex mtx;
+
+	void rebuild();
+};
+
+#endif